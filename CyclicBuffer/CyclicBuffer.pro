@@ -11,12 +11,51 @@ QT       -= gui
 TARGET = CyclicBuffer
 CONFIG   += console
 CONFIG   -= app_bundle
+CONFIG   += c++11
 
 TEMPLATE = app
 
+# shm_open of SharedCyclicBuffer
+unix:!macx:LIBS += -lrt
+
+# Uncomment to collect traffic statistics in every buffer (see 'BufferStatistics')
+#DEFINES += CYCLICBUFFER_STATISTICS
+
+# Uncomment to build coroutine awaitables of AsyncCyclicBuffer (empty with older standard)
+#CONFIG += c++2a
+
 
 SOURCES += main.cpp \
-    cyclicbuffer.cpp
+    cyclicbuffer.cpp \
+    bytesearch.cpp \
+    buffercrc.cpp \
+    bufferstatistics.cpp \
+    spsccyclicbuffer.cpp \
+    mpsccyclicbuffer.cpp \
+    broadcastcyclicbuffer.cpp \
+    packetframer.cpp \
+    persistentcyclicbuffer.cpp \
+    sharedcyclicbuffer.cpp \
+    buffernotifier.cpp \
+    recordcyclicbuffer.cpp \
+    timeindexedbuffer.cpp \
+    cyclicbufferpool.cpp \
+    asynccyclicbuffer.cpp
 
 HEADERS += \
-    cyclicbuffer.h
+    cyclicbuffer.h \
+    bytesearch.h \
+    buffercrc.h \
+    bufferstatistics.h \
+    spsccyclicbuffer.h \
+    mpsccyclicbuffer.h \
+    broadcastcyclicbuffer.h \
+    typedcyclicbuffer.h \
+    packetframer.h \
+    persistentcyclicbuffer.h \
+    sharedcyclicbuffer.h \
+    buffernotifier.h \
+    recordcyclicbuffer.h \
+    timeindexedbuffer.h \
+    cyclicbufferpool.h \
+    asynccyclicbuffer.h
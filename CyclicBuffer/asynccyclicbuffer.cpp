@@ -0,0 +1,186 @@
+#include "asynccyclicbuffer.h"
+
+#if defined(__cpp_impl_coroutine)
+
+#include "bytesearch.h"
+
+AsyncCyclicBuffer::AsyncCyclicBuffer(CyclicBuffer &buf)
+    : buffer(buf), waiting(false), closed(false), wait_length(0), wait_delimiter(-1), ready_pending(false), executor(NULL), executor_context(NULL)
+{
+    buffer.SetPushHook(PushHook, this);
+}
+
+AsyncCyclicBuffer::~AsyncCyclicBuffer()
+{
+    buffer.SetPushHook(NULL, NULL);
+}
+
+bool AsyncCyclicBuffer::IsSatisfied(size_t length, int delimiter)
+{
+    if(closed.load(std::memory_order_acquire))
+        return true;
+
+    if(delimiter >= 0)
+        return buffer.Find((unsigned char)delimiter)!=CyclicBuffer::BUFFER_NOT_FOUND;
+
+    CyclicBuffer::buffer_segments segments;
+    return buffer.PeekRead(segments, length)==length;
+}
+
+bool AsyncCyclicBuffer::Suspend(std::coroutine_handle<> handle, size_t length, int delimiter)
+{
+    {
+        std::lock_guard<std::mutex> lock(wait_mutex);
+        if(closed.load(std::memory_order_acquire))
+            return false;
+
+        waiter = handle;
+        wait_length = length;
+        wait_delimiter = delimiter;
+        waiting.store(true, std::memory_order_release);
+    }
+
+    // bytes pushed before registration were not checked by the push hook
+    if(!IsSatisfied(length, delimiter))
+        return true;
+
+    std::lock_guard<std::mutex> lock(wait_mutex);
+    if(!waiting.load(std::memory_order_relaxed))
+    {
+        // push hook (or 'Close') has already scheduled the coroutine
+        return true;
+    }
+
+    waiting.store(false, std::memory_order_relaxed);
+    waiter = std::coroutine_handle<>();
+    return false;
+}
+
+void AsyncCyclicBuffer::PushHook(void *context, const CyclicBuffer::buffer_segments &pushed, size_t available)
+{
+    AsyncCyclicBuffer * async = (AsyncCyclicBuffer *)context;
+
+    // pushes into buffer nobody waits for pay only this check
+    if(!async->waiting.load(std::memory_order_acquire))
+        return;
+
+    std::coroutine_handle<> handle;
+    {
+        std::lock_guard<std::mutex> lock(async->wait_mutex);
+        if(!async->waiting.load(std::memory_order_relaxed))
+            return;
+
+        // earlier unread bytes were checked when coroutine was suspended, only new ones are searched
+        bool satisfied;
+        if(async->wait_delimiter >= 0)
+        {
+            unsigned char value = (unsigned char)async->wait_delimiter;
+            satisfied = (pushed.first_length && FindByte(pushed.first, pushed.first_length, value)!=NULL) ||
+                        (pushed.second_length && FindByte(pushed.second, pushed.second_length, value)!=NULL);
+        }
+        else
+            satisfied = available >= async->wait_length;
+
+        if(!satisfied)
+            return;
+
+        handle = async->waiter;
+        async->waiter = std::coroutine_handle<>();
+        async->waiting.store(false, std::memory_order_relaxed);
+
+        if(async->executor==NULL)
+        {
+            async->ready = handle;
+            async->ready_pending.store(true, std::memory_order_release);
+            return;
+        }
+    }
+
+    async->executor(handle, async->executor_context);
+}
+
+void AsyncCyclicBuffer::Schedule(std::coroutine_handle<> handle)
+{
+    if(executor!=NULL)
+    {
+        executor(handle, executor_context);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(wait_mutex);
+    ready = handle;
+    ready_pending.store(true, std::memory_order_release);
+}
+
+void AsyncCyclicBuffer::ResumeReady()
+{
+    if(!ready_pending.load(std::memory_order_acquire))
+        return;
+
+    std::coroutine_handle<> handle;
+    {
+        std::lock_guard<std::mutex> lock(wait_mutex);
+        if(!ready)
+            return;
+
+        handle = ready;
+        ready = std::coroutine_handle<>();
+        ready_pending.store(false, std::memory_order_relaxed);
+    }
+
+    handle.resume();
+}
+
+size_t AsyncCyclicBuffer::PushN(const unsigned char *data, size_t length)
+{
+    size_t pushed = buffer.PushN(data, length);
+    ResumeReady();
+    return pushed;
+}
+
+size_t AsyncCyclicBuffer::CommitWrite(size_t length)
+{
+    size_t committed = buffer.CommitWrite(length);
+    ResumeReady();
+    return committed;
+}
+
+CyclicBuffer::buffer_error AsyncCyclicBuffer::FillFromFd(int fd, size_t &transferred, size_t max_length)
+{
+    CyclicBuffer::buffer_error error = buffer.FillFromFd(fd, transferred, max_length);
+    ResumeReady();
+    return error;
+}
+
+void AsyncCyclicBuffer::Close()
+{
+    std::coroutine_handle<> handle;
+    {
+        std::lock_guard<std::mutex> lock(wait_mutex);
+        closed.store(true, std::memory_order_release);
+        if(!waiting.load(std::memory_order_relaxed))
+            return;
+
+        handle = waiter;
+        waiter = std::coroutine_handle<>();
+        waiting.store(false, std::memory_order_relaxed);
+    }
+
+    Schedule(handle);
+    ResumeReady();
+}
+
+size_t AsyncCyclicBuffer::PopPacket(unsigned char *data, size_t max_length, unsigned char delimiter)
+{
+    size_t end = buffer.Find(delimiter);
+    if(end==CyclicBuffer::BUFFER_NOT_FOUND)
+        return 0;
+
+    // bytes of truncated packet that do not fit are dropped
+    size_t length = end+1;
+    size_t copied = buffer.PopN(data, length < max_length ? length : max_length);
+    buffer.ConsumeRead(length-copied);
+    return length;
+}
+
+#endif // __cpp_impl_coroutine
@@ -0,0 +1,236 @@
+/*
+ * Author:      Peter Mikula
+ * Date:        10. 10. 2015
+ * Version:     0.1.1
+ *
+ */
+
+//! Coroutine interface of cyclic buffer (C++20).
+/*!
+  Processing code written as coroutine waits for data by 'co_await' instead
+  of polling 'Pop' in a loop:
+
+    size_t length = co_await async.NextPacket(packet, sizeof(packet), '\n');
+
+  The coroutine is suspended until the requested number of bytes or a
+  complete packet ending by the delimiter is unread, and it is resumed when
+  the producer commits the missing bytes. The buffer is watched through its
+  push hook ('CyclicBuffer::SetPushHook'), so no thread is dedicated to one
+  buffer and one thread can serve hundreds of sensor streams.
+
+  Resumption is run inline by the producer functions of this class
+  ('PushN', 'CommitWrite', 'FillFromFd'), after the buffer is unlocked. If an
+  executor is set, resumption is passed to it instead, e.g. to be queued and
+  run by the consumer thread (required when the producer pushes directly to
+  a buffer shared between threads with 'BUFFER_BLOCK' policy). Only one
+  coroutine may wait for one buffer at a time.
+
+  The class is available only if compiler supports coroutines
+  ('__cpp_impl_coroutine'), otherwise the header is empty.
+  */
+
+#ifndef ASYNCCYCLICBUFFER_H
+#define ASYNCCYCLICBUFFER_H
+
+#if defined(__cpp_impl_coroutine)
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <mutex>
+
+#include "cyclicbuffer.h"
+
+class AsyncCyclicBuffer
+{
+
+public:
+
+    //! Function receiving coroutine to be resumed (see 'SetExecutor').
+    /*!
+     * \param handle Coroutine whose data are ready, executor has to call 'resume' on it exactly once.
+     * \param context Pointer given to 'SetExecutor'.
+     */
+    typedef void (*async_executor)(std::coroutine_handle<> handle, void * context);
+
+    //! Awaitable returned by 'ReadAsync', result of 'co_await' is number of bytes read.
+    class read_awaiter
+    {
+
+    public:
+
+        bool await_ready(void) { return owner.IsSatisfied(length, -1); }
+
+        bool await_suspend(std::coroutine_handle<> handle) { return owner.Suspend(handle, length, -1); }
+
+        size_t await_resume(void) { return owner.buffer.PopN(data, length); }
+
+    private:
+
+        friend class AsyncCyclicBuffer;
+
+        read_awaiter(AsyncCyclicBuffer &async, unsigned char * destination, size_t read_length) : owner(async), data(destination), length(read_length) { }
+
+        AsyncCyclicBuffer &owner;
+
+        unsigned char * data;
+
+        size_t length;
+
+    };
+
+    //! Awaitable returned by 'NextPacket', result of 'co_await' is length of packet.
+    class packet_awaiter
+    {
+
+    public:
+
+        bool await_ready(void) { return owner.IsSatisfied(0, delimiter); }
+
+        bool await_suspend(std::coroutine_handle<> handle) { return owner.Suspend(handle, 0, delimiter); }
+
+        size_t await_resume(void) { return owner.PopPacket(data, max_length, delimiter); }
+
+    private:
+
+        friend class AsyncCyclicBuffer;
+
+        packet_awaiter(AsyncCyclicBuffer &async, unsigned char * destination, size_t destination_length, unsigned char end_character)
+            : owner(async), data(destination), max_length(destination_length), delimiter(end_character) { }
+
+        AsyncCyclicBuffer &owner;
+
+        unsigned char * data;
+
+        size_t max_length;
+
+        unsigned char delimiter;
+
+    };
+
+    //! Constructor attaches push hook to the buffer.
+    /*!
+     * \brief Buffer must outlive this object and its push hook must not be used by other code.
+     * \param buf Buffer whose data are awaited.
+     */
+    AsyncCyclicBuffer(CyclicBuffer &buf);
+
+    //! Destructor detaches push hook. Waiting coroutine is not resumed (see 'Close').
+    ~AsyncCyclicBuffer(void);
+
+    //! Function sets executor resuming coroutines (NULL resumes them inline).
+    /*!
+     * \brief Executor is called in the producer thread, possibly with the buffer locked, so it should
+     * only queue the handle. It should be set before any coroutine waits.
+     * \param function Function receiving ready coroutines.
+     * \param context Pointer passed to the executor.
+     */
+    void SetExecutor(async_executor function, void * context) { executor = function; executor_context = context; }
+
+    //! Function returns awaitable reading exactly 'length' bytes (consumer side).
+    /*!
+     * \brief Coroutine is suspended until 'length' bytes are unread. After 'Close' it does not wait
+     * and reads what is available. Length must not exceed buffer size.
+     * \param data Memory where bytes are stored, it must stay valid while coroutine waits.
+     * \param length Number of bytes to be read.
+     */
+    read_awaiter ReadAsync(unsigned char * data, size_t length) { return read_awaiter(*this, data, length); }
+
+    //! Function returns awaitable reading next packet terminated by 'delimiter' (consumer side).
+    /*!
+     * \brief Coroutine is suspended until unread data contain the delimiter. The packet including delimiter
+     * is removed from the buffer and up to 'max_length' bytes of it are copied to 'data'. Result is length
+     * of the whole packet (greater than 'max_length' if it was truncated), or 0 if buffer was closed
+     * before complete packet arrived.
+     * \param data Memory where packet is stored, it must stay valid while coroutine waits.
+     * \param max_length Size of 'data'.
+     * \param delimiter Last byte of every packet.
+     */
+    packet_awaiter NextPacket(unsigned char * data, size_t max_length, unsigned char delimiter) { return packet_awaiter(*this, data, max_length, delimiter); }
+
+    //! Function pushes data to the buffer and resumes coroutine which became ready (producer side).
+    size_t PushN(const unsigned char * data, size_t length);
+
+    //! Function commits bytes written to 'PrepareWrite' regions and resumes coroutine which became ready (producer side).
+    size_t CommitWrite(size_t length);
+
+    //! Function reads file descriptor into the buffer and resumes coroutine which became ready (producer side).
+    /*!
+     * \brief See 'CyclicBuffer::FillFromFd'.
+     */
+    CyclicBuffer::buffer_error FillFromFd(int fd, size_t &transferred, size_t max_length = (size_t)-1);
+
+    //! Function resumes coroutine that became ready by pushes made directly to the buffer (no executor is set).
+    void ResumeReady(void);
+
+    //! Function closes the awaiting side, waiting coroutine is resumed and no coroutine waits anymore.
+    /*!
+     * \brief Used at shutdown or when the sensor stream ends, awaited operations then return data that
+     * are available ('NextPacket' returns 0 if no complete packet is left).
+     */
+    void Close(void);
+
+    //! Function returns true if 'Close' was called.
+    bool IsClosed(void) const { return closed.load(std::memory_order_acquire); }
+
+    //! Function returns true if a coroutine is suspended waiting for data.
+    bool IsWaiting(void) const { return waiting.load(std::memory_order_acquire); }
+
+    //! Function returns the awaited buffer.
+    CyclicBuffer & GetBuffer(void) { return buffer; }
+
+private:
+
+    //! Function returns true if 'length' bytes (or packet if 'delimiter' is not negative) are unread, or buffer is closed.
+    bool IsSatisfied(size_t length, int delimiter);
+
+    //! Function registers waiting coroutine, returns false if it does not need to wait anymore.
+    bool Suspend(std::coroutine_handle<> handle, size_t length, int delimiter);
+
+    //! Function removes packet from the buffer (see 'NextPacket').
+    size_t PopPacket(unsigned char * data, size_t max_length, unsigned char delimiter);
+
+    //! Function passes ready coroutine to the executor, or keeps it for 'ResumeReady' (called without 'wait_mutex').
+    void Schedule(std::coroutine_handle<> handle);
+
+    //! Push hook of the buffer, checks whether waiting coroutine is ready.
+    static void PushHook(void * context, const CyclicBuffer::buffer_segments &pushed, size_t available);
+
+    //! Awaited buffer.
+    CyclicBuffer &buffer;
+
+    //! Mutex guarding waiting and ready coroutine.
+    std::mutex wait_mutex;
+
+    //! True while 'waiter' is registered (checked by push hook without locking).
+    std::atomic<bool> waiting;
+
+    //! True after 'Close'.
+    std::atomic<bool> closed;
+
+    //! Waiting coroutine.
+    std::coroutine_handle<> waiter;
+
+    //! Number of bytes awaited by 'waiter' (0 if it waits for packet).
+    size_t wait_length;
+
+    //! Packet delimiter awaited by 'waiter' or negative value.
+    int wait_delimiter;
+
+    //! True while 'ready' is set (checked by 'ResumeReady' without locking).
+    std::atomic<bool> ready_pending;
+
+    //! Coroutine ready to be resumed by 'ResumeReady'.
+    std::coroutine_handle<> ready;
+
+    //! Executor or NULL.
+    async_executor executor;
+
+    //! Context passed to 'executor'.
+    void * executor_context;
+
+};
+
+#endif // __cpp_impl_coroutine
+
+#endif // ASYNCCYCLICBUFFER_H
@@ -0,0 +1,193 @@
+#include "benchmark.h"
+#include "asynccyclicbuffer.h"
+
+// coroutine awaitables need C++20, with older standard the group is not built
+#if defined(__cpp_impl_coroutine)
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static const unsigned int ASYNC_STREAMS = 256;
+static const unsigned int ASYNC_PACKET = 32;
+static const unsigned int ASYNC_ROUNDS = 2000;
+
+// Sequence byte of n-th packet of a stream (never the delimiter).
+static unsigned char SequenceByte(unsigned long long n)
+{
+    return (unsigned char)('A'+n%26);
+}
+
+// Coroutine started at once and destroyed when it returns, nobody awaits its result.
+struct BenchmarkTask
+{
+    struct promise_type
+    {
+        BenchmarkTask get_return_object(void) { return BenchmarkTask(); }
+        std::suspend_never initial_suspend(void) noexcept { return std::suspend_never(); }
+        std::suspend_never final_suspend(void) noexcept { return std::suspend_never(); }
+        void return_void(void) { }
+        void unhandled_exception(void) { std::abort(); }
+    };
+};
+
+// Results of one stream consumer.
+struct stream_result {
+    unsigned long long packets;
+    unsigned long long errors;
+};
+
+static BenchmarkTask PacketConsumer(AsyncCyclicBuffer &async, stream_result &result)
+{
+    unsigned char packet[64];
+    for(;;)
+    {
+        size_t length = co_await async.NextPacket(packet, sizeof(packet), '\n');
+        if(length==0)
+            break;
+        result.errors += length!=ASYNC_PACKET || packet[0]!=SequenceByte(result.packets);
+        result.packets++;
+    }
+}
+
+static BenchmarkTask FixedConsumer(AsyncCyclicBuffer &async, stream_result &result)
+{
+    unsigned char packet[ASYNC_PACKET];
+    while(co_await async.ReadAsync(packet, ASYNC_PACKET)==ASYNC_PACKET)
+    {
+        result.errors += packet[0]!=SequenceByte(result.packets);
+        result.packets++;
+    }
+}
+
+// Executor queueing coroutines, they are resumed by the loop after a batch of pushes.
+static void QueueExecutor(std::coroutine_handle<> handle, void * context)
+{
+    ((std::vector<std::coroutine_handle<> > *)context)->push_back(handle);
+}
+
+static void ReportResults(const char * name, const std::vector<stream_result> &results, const BenchmarkTimer &timer)
+{
+    unsigned long long packets = 0, errors = 0;
+    for(size_t i=0; i<results.size(); i++)
+    {
+        packets += results[i].packets;
+        errors += results[i].errors;
+    }
+
+    ReportBenchmark(name, packets, packets*ASYNC_PACKET, timer);
+    if(errors || packets!=(unsigned long long)ASYNC_STREAMS*ASYNC_ROUNDS)
+        ReportFailure("%llu errors, %llu packets", errors, packets);
+}
+
+// Every stream gets one packet in turn, consumer loop polls all streams after each round.
+static void BenchmarkPolling(void)
+{
+    int s;
+    std::vector<CyclicBuffer*> buffers(ASYNC_STREAMS);
+    for(unsigned int i=0; i<ASYNC_STREAMS; i++)
+        buffers[i] = new CyclicBuffer(4096, s);
+
+    std::vector<stream_result> results(ASYNC_STREAMS, stream_result());
+    unsigned char data[ASYNC_PACKET], packet[64];
+    memset(data, 'x', sizeof(data));
+    data[ASYNC_PACKET-1] = '\n';
+
+    BenchmarkTimer timer;
+    for(unsigned int r=0; r<ASYNC_ROUNDS; r++)
+    {
+        data[0] = SequenceByte(r);
+        for(unsigned int i=0; i<ASYNC_STREAMS; i++)
+            buffers[i]->PushN(data, ASYNC_PACKET);
+
+        for(unsigned int i=0; i<ASYNC_STREAMS; i++)
+        {
+            size_t end;
+            while((end = buffers[i]->Find('\n'))!=CyclicBuffer::BUFFER_NOT_FOUND)
+            {
+                size_t length = buffers[i]->PopN(packet, end+1);
+                results[i].errors += length!=ASYNC_PACKET || packet[0]!=SequenceByte(results[i].packets);
+                results[i].packets++;
+            }
+        }
+    }
+    ReportResults("256 streams polling Find/PopN", results, timer);
+
+    for(unsigned int i=0; i<ASYNC_STREAMS; i++)
+        delete buffers[i];
+}
+
+// The same traffic consumed by one coroutine per stream.
+static void BenchmarkCoroutines(bool packets, bool queued)
+{
+    int s;
+    std::vector<CyclicBuffer*> buffers(ASYNC_STREAMS);
+    std::vector<AsyncCyclicBuffer*> streams(ASYNC_STREAMS);
+    std::vector<stream_result> results(ASYNC_STREAMS, stream_result());
+    std::vector<std::coroutine_handle<> > queue;
+    queue.reserve(ASYNC_STREAMS);
+
+    for(unsigned int i=0; i<ASYNC_STREAMS; i++)
+    {
+        buffers[i] = new CyclicBuffer(4096, s);
+        streams[i] = new AsyncCyclicBuffer(*buffers[i]);
+        if(queued)
+            streams[i]->SetExecutor(QueueExecutor, &queue);
+        if(packets)
+            PacketConsumer(*streams[i], results[i]);
+        else
+            FixedConsumer(*streams[i], results[i]);
+    }
+
+    unsigned char data[ASYNC_PACKET];
+    memset(data, 'x', sizeof(data));
+    data[ASYNC_PACKET-1] = '\n';
+
+    BenchmarkTimer timer;
+    for(unsigned int r=0; r<ASYNC_ROUNDS; r++)
+    {
+        data[0] = SequenceByte(r);
+        for(unsigned int i=0; i<ASYNC_STREAMS; i++)
+            streams[i]->PushN(data, ASYNC_PACKET);
+
+        // queued coroutines run after the whole batch is pushed
+        for(size_t i=0; i<queue.size(); i++)
+            queue[i].resume();
+        queue.clear();
+    }
+
+    char name[96];
+    snprintf(name, sizeof(name), "256 streams co_await %s, %s", packets ? "NextPacket" : "ReadAsync", queued ? "queued" : "inline");
+    ReportResults(name, results, timer);
+
+    // consumers finish when their streams are closed
+    unsigned long long waiting = 0;
+    for(unsigned int i=0; i<ASYNC_STREAMS; i++)
+    {
+        streams[i]->Close();
+        for(size_t j=0; j<queue.size(); j++)
+            queue[j].resume();
+        queue.clear();
+        waiting += streams[i]->IsWaiting();
+        delete streams[i];
+        delete buffers[i];
+    }
+    if(waiting)
+        ReportFailure("%llu coroutines still waiting", waiting);
+}
+
+static void RunAsyncBenchmarks(void)
+{
+    printf("\n== Coroutine consumers, 256 streams of 32 B packets (every packet verified) ==\n");
+
+    BenchmarkPolling();
+    BenchmarkCoroutines(true, false);
+    BenchmarkCoroutines(true, true);
+    BenchmarkCoroutines(false, false);
+    BenchmarkCoroutines(false, true);
+}
+
+BENCHMARK_GROUP("async", RunAsyncBenchmarks);
+
+#endif // __cpp_impl_coroutine
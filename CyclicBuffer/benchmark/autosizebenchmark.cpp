@@ -0,0 +1,155 @@
+#include "benchmark.h"
+#include "cyclicbuffer.h"
+
+#include <cstring>
+#include <vector>
+
+static const unsigned int SENSOR_COUNT = 256;
+
+// Simple deterministic generator, so every run sees the same traffic.
+static unsigned int NextRandom(unsigned int &state)
+{
+    state = state*1103515245u+12345u;
+    return state >> 8;
+}
+
+// Every sensor buffer gets steady trickle of data, some of them get occasional bursts.
+// Consumer drains limited amount per tick, so bursts pile up. Each buffer verifies byte order.
+static void BenchmarkSensors(bool autosize, unsigned int initial_size, unsigned int ticks)
+{
+    std::vector<CyclicBuffer*> buffers;
+    std::vector<unsigned long long> written(SENSOR_COUNT, 0), read(SENSOR_COUNT, 0);
+
+    CyclicBuffer::buffer_autosize_policy policy;
+    policy.min_capacity = 256;
+    policy.max_capacity = 65536;
+    policy.grow_percent = 75;
+    policy.grow_samples = 2;
+    policy.shrink_percent = 20;
+
+    for(unsigned int i=0; i<SENSOR_COUNT; i++)
+    {
+        int s;
+        buffers.push_back(new CyclicBuffer(initial_size, s));
+        buffers[i]->SetOverflowPolicy(CyclicBuffer::BUFFER_REJECT);
+        if(autosize)
+            buffers[i]->SetAutoSizePolicy(policy);
+    }
+
+    unsigned char chunk[4096];
+    unsigned int random = 1;
+    unsigned long long rejected = 0, errors = 0, total = 0, capacity_sum = 0;
+    double sample_ns = 0.0;
+
+    BenchmarkTimer timer;
+    for(unsigned int tick=0; tick<ticks; tick++)
+    {
+        for(unsigned int i=0; i<SENSOR_COUNT; i++)
+        {
+            CyclicBuffer &buffer = *buffers[i];
+
+            // sensors in burst phase receive more than consumer drains for a while
+            bool burst = ((tick/200+i) % 16)==0 && (tick % 200) < 50;
+            unsigned int length = burst ? 1024+NextRandom(random) % 3072 : 16+NextRandom(random) % 48;
+            for(unsigned int j=0; j<length; j++)
+                chunk[j] = (unsigned char)(written[i]+j);
+            size_t accepted = buffer.PushN(chunk, length);
+            written[i] += accepted;
+            rejected += length-accepted;
+            total += length;
+
+            size_t n = buffer.PopN(chunk, 2048);
+            for(size_t j=0; j<n; j++)
+            {
+                if(chunk[j]!=(unsigned char)(read[i]+j))
+                    errors++;
+            }
+            read[i] += n;
+
+            BenchmarkTimer sample_timer(false);
+            buffer.SampleOccupancy();
+            sample_ns += sample_timer.ElapsedNs();
+
+            capacity_sum += buffer.GetBufferSize();
+        }
+    }
+    double ns = timer.ElapsedNs();
+
+    unsigned long long resizes = 0, reallocations = 0, memory = 0;
+    for(unsigned int i=0; i<SENSOR_COUNT; i++)
+    {
+        CyclicBuffer::buffer_telemetry telemetry;
+        buffers[i]->GetTelemetry(telemetry);
+        resizes += telemetry.resizes;
+        reallocations += telemetry.reallocations;
+        memory += buffers[i]->GetTotalBufferSize();
+        delete buffers[i];
+    }
+
+    char name[80];
+    snprintf(name, sizeof(name), "%u sensors, %s %u B", SENSOR_COUNT, autosize ? "auto-sized from" : "fixed", initial_size);
+    ReportBenchmark(name, (unsigned long long)ticks*SENSOR_COUNT, total, ns);
+    printf("    mean capacity %llu KiB, final memory %llu KiB, rejected %.2f %%, SampleOccupancy %.1f ns\n",
+           capacity_sum/ticks/1024, memory/1024, 100.0*(double)rejected/(double)total, sample_ns/((double)ticks*SENSOR_COUNT));
+    if(autosize)
+        printf("    %llu resizes, %llu of them reallocated memory\n", resizes, reallocations);
+    if(errors)
+        ReportFailure("%llu bytes out of order", errors);
+}
+
+// Wrapped unread data while growth is clamped by 'max_capacity' to less memory than the wrapped
+// part needs, so data cannot be unwrapped in place. Only the growing 'SampleOccupancy' is measured.
+static void BenchmarkClampedGrowth(unsigned int rounds)
+{
+    const unsigned int block = 4096, capacity = 3072, first = 2000, second = 3000;
+
+    CyclicBuffer::buffer_autosize_policy policy;
+    policy.min_capacity = 1024;
+    policy.max_capacity = block;
+    policy.grow_percent = 90;
+    policy.grow_samples = 1;
+    policy.shrink_percent = 10;
+
+    unsigned char data[second], out[block];
+    for(unsigned int i=0; i<second; i++)
+        data[i] = (unsigned char)(i*7+i/256);
+
+    unsigned long long errors = 0;
+    double ns = 0.0;
+    for(unsigned int r=0; r<rounds; r++)
+    {
+        int s;
+        CyclicBuffer buffer(block, s);
+        buffer.SetTopIndex(capacity-1);
+        buffer.SetOverflowPolicy(CyclicBuffer::BUFFER_REJECT);
+        buffer.SetAutoSizePolicy(policy);
+
+        // second push wraps, 'capacity-first' bytes below the top border, the rest at the bottom
+        buffer.PushN(data, first);
+        buffer.PopN(out, first);
+        buffer.PushN(data, second);
+
+        BenchmarkTimer timer(false);
+        buffer.SampleOccupancy();
+        ns += timer.ElapsedNs();
+
+        size_t n = buffer.PopN(out, block);
+        errors += buffer.GetBufferSize()!=block || n!=second || memcmp(out, data, second)!=0;
+    }
+
+    ReportBenchmark("wrapped data, growth clamped to max", rounds, (unsigned long long)rounds*second, ns);
+    if(errors)
+        ReportFailure("%llu resizes lost or reordered data", errors);
+}
+
+static void RunAutosizeBenchmarks(void)
+{
+    printf("\n== Auto-sizing of per-sensor buffers with bursty traffic (every byte verified) ==\n");
+
+    BenchmarkSensors(false, 4096, 2000);
+    BenchmarkSensors(false, 65536, 2000);
+    BenchmarkSensors(true, 256, 2000);
+    BenchmarkClampedGrowth(20000);
+}
+
+BENCHMARK_GROUP("autosize", RunAutosizeBenchmarks);
@@ -0,0 +1,118 @@
+/*
+ * Small timing helpers shared by all benchmarks of the buffer classes.
+ * Benchmarks are built as standalone console application without Qt.
+ *
+ * Every source file registers its benchmark group by 'BENCHMARK_GROUP' macro
+ * (similarly to Google Benchmark), groups run in order of registration and can
+ * be selected from command line (see 'main.cpp'). Each result line reports
+ * time per operation, throughput and, if hardware counters are accessible
+ * through Linux 'perf_event_open', cache misses per operation. Benchmarks verifying
+ * transferred data report failures by 'ReportFailure', then the program exits with
+ * non-zero status.
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <chrono>
+#include <cstdio>
+
+//! Function returns true if hardware cache-miss counter can be read.
+bool CacheMissCounterAvailable(void);
+
+//! Function returns cache misses counted so far in the process (including finished threads).
+unsigned long long ReadCacheMissCounter(void);
+
+//! Function disables hardware counters (e.g. from command line).
+void DisableCacheMissCounter(void);
+
+//! Simple monotonic stopwatch used by benchmarks, also measuring cache misses.
+class BenchmarkTimer
+{
+
+public:
+
+    //! Constructor starts the measurement.
+    /*!
+     * \param measure_cache_misses False for timers started inside measured loops, since reading
+     * the hardware counter is a system call.
+     */
+    explicit BenchmarkTimer(bool measure_cache_misses = true) : measure_misses(measure_cache_misses) { Start(); }
+
+    //! Function will (re)start the measurement.
+    void Start(void)
+    {
+        start_misses = measure_misses ? ReadCacheMissCounter() : 0;
+        start_time = std::chrono::steady_clock::now();
+    }
+
+    //! Function returns nanoseconds elapsed since the last 'Start' call.
+    double ElapsedNs(void) const
+    {
+        return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-start_time).count();
+    }
+
+    //! Function returns cache misses since the last 'Start' call (0 if counter is not available).
+    unsigned long long CacheMisses(void) const { return measure_misses ? ReadCacheMissCounter()-start_misses : 0; }
+
+    //! Function returns true if cache misses are measured.
+    bool MeasuresCacheMisses(void) const { return measure_misses && CacheMissCounterAvailable(); }
+
+private:
+
+    bool measure_misses;
+
+    std::chrono::steady_clock::time_point start_time;
+
+    unsigned long long start_misses;
+
+};
+
+//! Function prints one line of benchmark results.
+/*!
+ * \param name Name of the benchmark case.
+ * \param operations Number of operations (calls) measured.
+ * \param bytes Number of bytes moved during the measurement.
+ * \param nanoseconds Total time of the measurement.
+ * \param cache_misses Cache misses during the measurement, negative value if not measured.
+ */
+inline void ReportBenchmark(const char * name, unsigned long long operations, unsigned long long bytes, double nanoseconds, double cache_misses = -1.0)
+{
+    double ns_per_op = operations ? nanoseconds/(double)operations : 0.0;
+    double mb_per_s = nanoseconds > 0.0 ? ((double)bytes/(1024.0*1024.0))/(nanoseconds/1e9) : 0.0;
+    if(cache_misses >= 0.0 && operations)
+        printf("%-48s %14.2f ns/op %12.1f MiB/s %12.4f miss/op\n", name, ns_per_op, mb_per_s, cache_misses/(double)operations);
+    else
+        printf("%-48s %14.2f ns/op %12.1f MiB/s\n", name, ns_per_op, mb_per_s);
+}
+
+//! Function prints one line of benchmark results measured by 'timer' (stops at the time of call).
+inline void ReportBenchmark(const char * name, unsigned long long operations, unsigned long long bytes, const BenchmarkTimer &timer)
+{
+    double nanoseconds = timer.ElapsedNs();
+    double cache_misses = timer.MeasuresCacheMisses() ? (double)timer.CacheMisses() : -1.0;
+    ReportBenchmark(name, operations, bytes, nanoseconds, cache_misses);
+}
+
+//! Function prints failed verification of benchmark results, program then exits with non-zero status.
+/*!
+ * \param format Description of the failure ('printf' format without trailing new line).
+ */
+void ReportFailure(const char * format, ...);
+
+//! Variable written by benchmarks so the compiler can not remove measured code.
+extern volatile unsigned int benchmark_sink;
+
+//! Function running one group of benchmarks.
+typedef void (*benchmark_function)(void);
+
+//! Function registers benchmark group, groups run in order of registration.
+/*!
+ * \return Number of groups registered so far (value is only used to run registration during static initialization).
+ */
+int RegisterBenchmark(const char * name, benchmark_function function);
+
+//! Macro registering benchmark group implemented in a source file.
+#define BENCHMARK_GROUP(name, function) static int function##_registration = RegisterBenchmark(name, function)
+
+#endif // BENCHMARK_H
@@ -0,0 +1,87 @@
+#-------------------------------------------------
+#
+# Benchmarks of CyclicBuffer, built without Qt
+#
+# qmake benchmark.pro && make && ./CyclicBufferBenchmark --help
+#
+#-------------------------------------------------
+
+QT       -= core gui
+
+TARGET = CyclicBufferBenchmark
+CONFIG   += console
+CONFIG   -= app_bundle qt
+CONFIG   += c++11 thread
+
+TEMPLATE = app
+
+unix:LIBS += -lpthread
+unix:!macx:LIBS += -lrt
+
+INCLUDEPATH += ..
+
+# Uncomment to measure buffers with traffic statistics compiled in
+#DEFINES += CYCLICBUFFER_STATISTICS
+
+# Uncomment to build coroutine awaitables of AsyncCyclicBuffer (empty with older standard)
+#CONFIG += c++2a
+
+SOURCES += main.cpp \
+    perfcounter.cpp \
+    bulkbenchmark.cpp \
+    capacitybenchmark.cpp \
+    spscbenchmark.cpp \
+    mirrorbenchmark.cpp \
+    policybenchmark.cpp \
+    typedbenchmark.cpp \
+    framerbenchmark.cpp \
+    findbenchmark.cpp \
+    crcbenchmark.cpp \
+    mpscbenchmark.cpp \
+    broadcastbenchmark.cpp \
+    resizebenchmark.cpp \
+    autosizebenchmark.cpp \
+    statisticsbenchmark.cpp \
+    persistentbenchmark.cpp \
+    sharedbenchmark.cpp \
+    notifybenchmark.cpp \
+    fdbenchmark.cpp \
+    recordbenchmark.cpp \
+    timeindexbenchmark.cpp \
+    clearbenchmark.cpp \
+    poolbenchmark.cpp \
+    asyncbenchmark.cpp \
+    ../cyclicbuffer.cpp \
+    ../bytesearch.cpp \
+    ../buffercrc.cpp \
+    ../bufferstatistics.cpp \
+    ../spsccyclicbuffer.cpp \
+    ../mpsccyclicbuffer.cpp \
+    ../broadcastcyclicbuffer.cpp \
+    ../packetframer.cpp \
+    ../persistentcyclicbuffer.cpp \
+    ../sharedcyclicbuffer.cpp \
+    ../buffernotifier.cpp \
+    ../recordcyclicbuffer.cpp \
+    ../timeindexedbuffer.cpp \
+    ../cyclicbufferpool.cpp \
+    ../asynccyclicbuffer.cpp
+
+HEADERS += \
+    benchmark.h \
+    ../cyclicbuffer.h \
+    ../bytesearch.h \
+    ../buffercrc.h \
+    ../bufferstatistics.h \
+    ../spsccyclicbuffer.h \
+    ../mpsccyclicbuffer.h \
+    ../broadcastcyclicbuffer.h \
+    ../typedcyclicbuffer.h \
+    ../packetframer.h \
+    ../persistentcyclicbuffer.h \
+    ../sharedcyclicbuffer.h \
+    ../buffernotifier.h \
+    ../recordcyclicbuffer.h \
+    ../timeindexedbuffer.h \
+    ../cyclicbufferpool.h \
+    ../asynccyclicbuffer.h
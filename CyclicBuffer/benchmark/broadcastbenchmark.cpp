@@ -0,0 +1,219 @@
+#include "benchmark.h"
+#include "broadcastcyclicbuffer.h"
+#include "spsccyclicbuffer.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+static const size_t CHUNK_LENGTH = 256;
+
+// Stream byte at position i is (i & 0xFF), so every reader verifies order of its data.
+static void FillChunk(unsigned char * chunk, unsigned long long position, size_t length)
+{
+    for(size_t i=0; i<length; i++)
+        chunk[i] = (unsigned char)(position+i);
+}
+
+// Baseline: writer copies the stream into separate buffer of every consumer.
+static void BenchmarkCopies(unsigned int consumers, unsigned long long total)
+{
+    std::vector<SpscCyclicBuffer*> buffers;
+    for(unsigned int c=0; c<consumers; c++)
+    {
+        int s;
+        buffers.push_back(new SpscCyclicBuffer(65536, s));
+    }
+
+    std::atomic<unsigned long long> errors(0);
+    BenchmarkTimer timer;
+
+    std::vector<std::thread> threads;
+    for(unsigned int c=0; c<consumers; c++)
+    {
+        threads.push_back(std::thread([&, c]() {
+            unsigned char chunk[CHUNK_LENGTH];
+            unsigned long long position = 0, local_errors = 0;
+            while(position < total)
+            {
+                size_t n = buffers[c]->PopN(chunk, CHUNK_LENGTH);
+                if(!n)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                for(size_t i=0; i<n; i++)
+                {
+                    if(chunk[i]!=(unsigned char)(position+i))
+                        local_errors++;
+                }
+                position += n;
+            }
+            errors += local_errors;
+        }));
+    }
+
+    unsigned char chunk[CHUNK_LENGTH];
+    for(unsigned long long position=0; position<total; position+=CHUNK_LENGTH)
+    {
+        FillChunk(chunk, position, CHUNK_LENGTH);
+        for(unsigned int c=0; c<consumers; c++)
+        {
+            size_t written = 0;
+            while(written < CHUNK_LENGTH)
+            {
+                size_t n = buffers[c]->PushN(chunk+written, CHUNK_LENGTH-written);
+                if(!n)
+                    std::this_thread::yield();
+                written += n;
+            }
+        }
+    }
+
+    for(unsigned int c=0; c<consumers; c++)
+        threads[c].join();
+
+    char name[64];
+    snprintf(name, sizeof(name), "%u x SpscCyclicBuffer copies", consumers);
+    ReportBenchmark(name, total/CHUNK_LENGTH, total, timer);
+    if(errors)
+        ReportFailure("%llu bytes out of order", (unsigned long long)errors);
+
+    for(unsigned int c=0; c<consumers; c++)
+        delete buffers[c];
+}
+
+// One shared buffer, every consumer has its own read cursor.
+static void BenchmarkBroadcast(unsigned int consumers, unsigned long long total)
+{
+    int s;
+    BroadcastCyclicBuffer buffer(65536, consumers, s);
+
+    std::vector<int> readers;
+    for(unsigned int c=0; c<consumers; c++)
+        readers.push_back(buffer.RegisterReader());
+
+    std::atomic<unsigned long long> errors(0);
+    BenchmarkTimer timer;
+
+    std::vector<std::thread> threads;
+    for(unsigned int c=0; c<consumers; c++)
+    {
+        threads.push_back(std::thread([&, c]() {
+            unsigned long long position = 0, local_errors = 0;
+            CyclicBuffer::buffer_segments segments;
+            while(position < total)
+            {
+                // consumers verify data in place, without copying them out
+                size_t n = buffer.PeekRead(readers[c], segments, CHUNK_LENGTH);
+                if(!n)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                for(size_t i=0; i<segments.first_length; i++)
+                {
+                    if(segments.first[i]!=(unsigned char)(position+i))
+                        local_errors++;
+                }
+                for(size_t i=0; i<segments.second_length; i++)
+                {
+                    if(segments.second[i]!=(unsigned char)(position+segments.first_length+i))
+                        local_errors++;
+                }
+                position += buffer.ConsumeRead(readers[c], n);
+            }
+            errors += local_errors;
+        }));
+    }
+
+    unsigned char chunk[CHUNK_LENGTH];
+    for(unsigned long long position=0; position<total; position+=CHUNK_LENGTH)
+    {
+        FillChunk(chunk, position, CHUNK_LENGTH);
+        size_t written = 0;
+        while(written < CHUNK_LENGTH)
+        {
+            size_t n = buffer.PushN(chunk+written, CHUNK_LENGTH-written);
+            if(!n)
+                std::this_thread::yield();
+            written += n;
+        }
+    }
+
+    for(unsigned int c=0; c<consumers; c++)
+        threads[c].join();
+
+    char name[64];
+    snprintf(name, sizeof(name), "BroadcastCyclicBuffer readers=%u", consumers);
+    ReportBenchmark(name, total/CHUNK_LENGTH, total, timer);
+    if(errors)
+        ReportFailure("%llu bytes out of order", (unsigned long long)errors);
+}
+
+// Writer never waits for lossy reader, the reader must still see consistent stream.
+static void BenchmarkLossyReader(unsigned long long total)
+{
+    int s;
+    BroadcastCyclicBuffer buffer(4096, 1, s);
+    int reader = buffer.RegisterReader(true);
+
+    std::atomic<bool> done(false);
+    unsigned long long errors = 0, received = 0;
+
+    BenchmarkTimer timer;
+
+    std::thread consumer([&]() {
+        unsigned char chunk[CHUNK_LENGTH];
+        unsigned long long last_overruns = 0;
+        int expected = -1;
+        while(!done.load())
+        {
+            size_t n = buffer.PopN(reader, chunk, CHUNK_LENGTH);
+            unsigned long long overruns = buffer.GetOverruns(reader);
+            if(overruns!=last_overruns)
+            {
+                // skipped bytes break the sequence, continue from what was received
+                last_overruns = overruns;
+                expected = -1;
+            }
+            for(size_t i=0; i<n; i++)
+            {
+                if(expected >= 0 && chunk[i]!=(unsigned char)expected)
+                    errors++;
+                expected = (unsigned char)(chunk[i]+1);
+            }
+            received += n;
+        }
+    });
+
+    unsigned char chunk[CHUNK_LENGTH];
+    for(unsigned long long position=0; position<total; position+=CHUNK_LENGTH)
+    {
+        FillChunk(chunk, position, CHUNK_LENGTH);
+        buffer.PushN(chunk, CHUNK_LENGTH);
+    }
+    double ns = timer.ElapsedNs();
+    done = true;
+    consumer.join();
+
+    ReportBenchmark("BroadcastCyclicBuffer lossy reader, writer", total/CHUNK_LENGTH, total, ns);
+    printf("    reader received %llu bytes, missed %llu bytes\n", received, buffer.GetOverruns(reader));
+    if(errors)
+        ReportFailure("%llu bytes out of order", errors);
+}
+
+static void RunBroadcastBenchmarks(void)
+{
+    printf("\n== Broadcast of one stream to more consumers, 256 B chunks (every byte verified) ==\n");
+
+    const unsigned long long total = 64ull << 20;
+    for(unsigned int consumers=1; consumers<=4; consumers++)
+    {
+        BenchmarkCopies(consumers, total/4);
+        BenchmarkBroadcast(consumers, total/4);
+    }
+    BenchmarkLossyReader(total);
+}
+
+BENCHMARK_GROUP("broadcast", RunBroadcastBenchmarks);
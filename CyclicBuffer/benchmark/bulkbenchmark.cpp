@@ -0,0 +1,208 @@
+#include "benchmark.h"
+#include "cyclicbuffer.h"
+
+#include <cstring>
+#include <vector>
+
+// Compares byte-by-byte Push/Pop loops (as used in the demo application) with PushN/PopN.
+static void BenchmarkChunk(unsigned int buffer_size, unsigned int chunk_size, unsigned long long total_bytes)
+{
+    int s;
+    CyclicBuffer buffer(buffer_size, s);
+    if(s!=CyclicBuffer::BUFFER_OK)
+        return;
+
+    std::vector<unsigned char> input(chunk_size), output(chunk_size);
+    for(unsigned int i=0; i<chunk_size; i++)
+        input[i] = (unsigned char)i;
+
+    unsigned long long rounds = total_bytes/chunk_size;
+    char name[64];
+    unsigned int sum = 0;
+
+    BenchmarkTimer timer;
+    for(unsigned long long r=0; r<rounds; r++)
+    {
+        for(unsigned int i=0; i<chunk_size; i++)
+            buffer.Push(input[i]);
+        for(unsigned int i=0; i<chunk_size; i++)
+            output[i] = buffer.Pop();
+        sum += output[chunk_size-1];
+    }
+    snprintf(name, sizeof(name), "Push/Pop loop chunk=%u", chunk_size);
+    ReportBenchmark(name, rounds*chunk_size, rounds*chunk_size, timer);
+
+    timer.Start();
+    for(unsigned long long r=0; r<rounds; r++)
+    {
+        buffer.PushN(&input[0], chunk_size);
+        buffer.PopN(&output[0], chunk_size);
+        sum += output[chunk_size-1];
+    }
+    snprintf(name, sizeof(name), "PushN/PopN chunk=%u", chunk_size);
+    ReportBenchmark(name, rounds*chunk_size, rounds*chunk_size, timer);
+
+    benchmark_sink = benchmark_sink + sum;
+}
+
+// Ingest path: data arriving from driver into scratch array and pushed, compared
+// with driver writing straight into reserved regions and parser scanning in place.
+static void BenchmarkIngest(unsigned int buffer_size, unsigned int chunk_size, unsigned long long total_bytes)
+{
+    int s;
+    CyclicBuffer buffer(buffer_size, s);
+    if(s!=CyclicBuffer::BUFFER_OK)
+        return;
+
+    std::vector<unsigned char> device(chunk_size), scratch(chunk_size);
+    for(unsigned int i=0; i<chunk_size; i++)
+        device[i] = (unsigned char)i;
+
+    unsigned long long rounds = total_bytes/chunk_size;
+    char name[64];
+    unsigned int sum = 0;
+
+    BenchmarkTimer timer;
+    for(unsigned long long r=0; r<rounds; r++)
+    {
+        memcpy(&scratch[0], &device[0], chunk_size); // read() into scratch array
+        buffer.PushN(&scratch[0], chunk_size);
+        buffer.PopN(&scratch[0], chunk_size);
+        for(unsigned int i=0; i<chunk_size; i++)
+            sum += scratch[i];
+    }
+    snprintf(name, sizeof(name), "scratch+PushN/PopN chunk=%u", chunk_size);
+    ReportBenchmark(name, rounds*chunk_size, rounds*chunk_size, timer);
+
+    CyclicBuffer::buffer_segments segments;
+    timer.Start();
+    for(unsigned long long r=0; r<rounds; r++)
+    {
+        buffer.PrepareWrite(segments, chunk_size); // read() straight into the buffer
+        memcpy(segments.first, &device[0], segments.first_length);
+        memcpy(segments.second, &device[segments.first_length], segments.second_length);
+        buffer.CommitWrite(chunk_size);
+
+        size_t length = buffer.PeekRead(segments);
+        for(size_t i=0; i<segments.first_length; i++)
+            sum += segments.first[i];
+        for(size_t i=0; i<segments.second_length; i++)
+            sum += segments.second[i];
+        buffer.ConsumeRead(length);
+    }
+    snprintf(name, sizeof(name), "PrepareWrite/PeekRead chunk=%u", chunk_size);
+    ReportBenchmark(name, rounds*chunk_size, rounds*chunk_size, timer);
+
+    benchmark_sink = benchmark_sink + sum;
+}
+
+// Byte at position 'position' of the transferred stream, period 251 does not divide the buffer size.
+static unsigned char PatternByte(unsigned long long position)
+{
+    return (unsigned char)(position % 251);
+}
+
+// Transfers pattern through both bulk APIs across the wrap point and checks every byte,
+// then checks that 'BUFFER_OVERWRITE_OLDEST' keeps only the newest bytes of a block longer than the buffer.
+static void VerifyBulk(void)
+{
+    int s;
+    CyclicBuffer buffer(4096, s);
+    if(s!=CyclicBuffer::BUFFER_OK)
+    {
+        ReportFailure("buffer allocation failed");
+        return;
+    }
+
+    static const unsigned int chunks[] = { 1, 61, 1500, 4095, 4096 };
+    std::vector<unsigned char> input(8192), output(8192);
+    unsigned long long written = 0, read = 0, errors = 0;
+
+    for(unsigned int c=0; c<sizeof(chunks)/sizeof(chunks[0]); c++)
+    {
+        for(unsigned int r=0; r<64; r++)
+        {
+            for(unsigned int i=0; i<chunks[c]; i++)
+                input[i] = PatternByte(written+i);
+            if(buffer.PushN(&input[0], chunks[c])!=chunks[c])
+                errors++;
+            written += chunks[c];
+
+            size_t length = buffer.PopN(&output[0], chunks[c]);
+            if(length!=chunks[c])
+                errors++;
+            for(size_t i=0; i<length; i++)
+                errors += output[i]!=PatternByte(read+i);
+            read += length;
+        }
+    }
+    if(errors)
+        ReportFailure("PushN/PopN: %llu bytes lost or corrupted", errors);
+
+    // reader consumes only part of the data, so regions start at every offset
+    CyclicBuffer::buffer_segments segments;
+    errors = 0;
+    for(unsigned int c=0; c<sizeof(chunks)/sizeof(chunks[0]); c++)
+    {
+        for(unsigned int r=0; r<64; r++)
+        {
+            size_t length = buffer.PrepareWrite(segments, chunks[c]);
+            for(size_t i=0; i<segments.first_length; i++)
+                segments.first[i] = PatternByte(written+i);
+            for(size_t i=0; i<segments.second_length; i++)
+                segments.second[i] = PatternByte(written+segments.first_length+i);
+            buffer.CommitWrite(length);
+            written += length;
+
+            size_t available = buffer.PeekRead(segments);
+            if(available!=written-read)
+                errors++;
+            size_t consume = (available+1)/2;
+            for(size_t i=0; i<consume; i++)
+            {
+                unsigned char value = i < segments.first_length ? segments.first[i] : segments.second[i-segments.first_length];
+                errors += value!=PatternByte(read+i);
+            }
+            buffer.ConsumeRead(consume);
+            read += consume;
+        }
+    }
+    if(errors)
+        ReportFailure("PrepareWrite/PeekRead: %llu bytes lost or corrupted", errors);
+
+    // block longer than the buffer replaces all unread data with its newest bytes
+    unsigned long long dropped = buffer.GetDroppedBytes();
+    size_t unread = (size_t)(written-read);
+    size_t block = 4096+777;
+    for(size_t i=0; i<block; i++)
+        input[i] = PatternByte(written+i);
+    written += block;
+    errors = 0;
+    if(buffer.PushN(&input[0], block)!=4096 || buffer.GetDroppedBytes()-dropped!=unread+777)
+        errors++;
+    size_t length = buffer.PopN(&output[0], output.size());
+    if(length!=4096)
+        errors++;
+    for(size_t i=0; i<length; i++)
+        errors += output[i]!=PatternByte(written-4096+i);
+    if(errors)
+        ReportFailure("PushN longer than buffer: %llu errors, stored %u B, dropped %llu B",
+                      errors, (unsigned int)length, buffer.GetDroppedBytes()-dropped);
+}
+
+static void RunBulkBenchmarks(void)
+{
+    printf("\n== Bulk transfers (buffer 4096 B) ==\n");
+    VerifyBulk();
+    // chunk sizes not dividing the buffer size so wrap point is crossed regularly
+    BenchmarkChunk(4096, 16, 64ull<<20);
+    BenchmarkChunk(4096, 61, 64ull<<20);
+    BenchmarkChunk(4096, 256, 64ull<<20);
+    BenchmarkChunk(4096, 1500, 64ull<<20);
+
+    printf("\n== Ingest with scan (buffer 4096 B) ==\n");
+    BenchmarkIngest(4096, 61, 64ull<<20);
+    BenchmarkIngest(4096, 1500, 64ull<<20);
+}
+
+BENCHMARK_GROUP("bulk", RunBulkBenchmarks);
@@ -0,0 +1,73 @@
+#include "benchmark.h"
+#include "cyclicbuffer.h"
+
+#include <vector>
+
+// Buffer is kept half full while data stream through it, so the whole memory block
+// is touched and the working set grows with capacity (L1, L2, LLC, DRAM).
+static void BenchmarkBytes(unsigned int capacity, unsigned long long total)
+{
+    int s;
+    CyclicBuffer buffer(capacity, s);
+    if(s!=CyclicBuffer::BUFFER_OK)
+        return;
+    buffer.SetOverflowPolicy(CyclicBuffer::BUFFER_REJECT);
+
+    for(unsigned int i=0; i<capacity/2; i++)
+        buffer.Push((unsigned char)i);
+
+    unsigned int sum = 0;
+    BenchmarkTimer timer;
+    for(unsigned long long i=0; i<total; i++)
+    {
+        buffer.Push((unsigned char)i);
+        sum += buffer.Pop();
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "Push+Pop byte, capacity %u", capacity);
+    ReportBenchmark(name, total, total, timer);
+    benchmark_sink = benchmark_sink + sum;
+}
+
+// Same streaming with blocks, 'chunk' not dividing capacity makes transfers wrap regularly.
+static void BenchmarkBlocks(unsigned int capacity, unsigned int chunk, unsigned long long total)
+{
+    int s;
+    CyclicBuffer buffer(capacity, s);
+    if(s!=CyclicBuffer::BUFFER_OK || chunk > capacity/2)
+        return;
+    buffer.SetOverflowPolicy(CyclicBuffer::BUFFER_REJECT);
+
+    std::vector<unsigned char> data(chunk, 0x5A);
+    for(unsigned int i=0; i+chunk<=capacity/2; i+=chunk)
+        buffer.PushN(&data[0], chunk);
+
+    unsigned long long rounds = total/chunk;
+    BenchmarkTimer timer;
+    for(unsigned long long r=0; r<rounds; r++)
+    {
+        buffer.PushN(&data[0], chunk);
+        buffer.PopN(&data[0], chunk);
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "PushN+PopN %u B, capacity %u", chunk, capacity);
+    ReportBenchmark(name, rounds, rounds*chunk, timer);
+    benchmark_sink = benchmark_sink + data[0];
+}
+
+static void RunCapacityBenchmarks(void)
+{
+    printf("\n== Capacity sweep, buffer kept half full ==\n");
+
+    const unsigned long long total = 64ull << 20;
+    for(unsigned int capacity=256; capacity<=(64u << 20); capacity*=4)
+    {
+        BenchmarkBytes(capacity, total/4);
+        BenchmarkBlocks(capacity, 256, total);
+        BenchmarkBlocks(capacity, 61, total/4);
+    }
+}
+
+BENCHMARK_GROUP("capacity", RunCapacityBenchmarks);
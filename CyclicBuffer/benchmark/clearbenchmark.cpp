@@ -0,0 +1,85 @@
+#include "benchmark.h"
+#include "buffercrc.h"
+#include "cyclicbuffer.h"
+
+#include <cstdio>
+#include <vector>
+
+// Byte loop used by 'ResetBuffer' before lazy clearing, measured on plain array of the same size.
+static void ClearByteLoop(unsigned char * memory, unsigned int size)
+{
+    for(unsigned int i = 0; i < size; i++)
+        ((volatile unsigned char *)memory)[i] = 0;
+}
+
+// Buffer is filled completely (so all pages are resident and dirty) and reset, repeatedly.
+static void BenchmarkReset(unsigned int size)
+{
+    int s;
+    CyclicBuffer buffer(size, s);
+    if(s!=CyclicBuffer::BUFFER_OK)
+        return;
+
+    std::vector<unsigned char> data(size, 0x5A);
+    std::vector<unsigned char> plain(size, 0x5A);
+    const unsigned int rounds = size >= (16u << 20) ? 5 : 50;
+
+    double loop_ns = 0.0, lazy_ns = 0.0, immediate_ns = 0.0, push_ns = 0.0;
+    unsigned long long errors = 0;
+
+    for(unsigned int r=0; r<rounds; r++)
+    {
+        BenchmarkTimer loop_timer(false);
+        ClearByteLoop(&plain[0], size);
+        loop_ns += loop_timer.ElapsedNs();
+
+        buffer.PushN(&data[0], size);
+        BenchmarkTimer lazy_timer(false);
+        buffer.ResetBuffer();
+        lazy_ns += lazy_timer.ElapsedNs();
+        errors += buffer.GetValueAt(size/2)!=0;
+
+        // CRC query reads never written bytes as zeros without clearing them
+        if(r==0)
+        {
+            unsigned int crc = 0;
+            errors += buffer.ComputeCrc(buffer.GetBottomIndex(), size, crc)!=CyclicBuffer::BUFFER_OK ||
+                      crc!=(Crc32cUpdate(CRC32C_INITIAL, &plain[0], size) ^ CRC32C_FINAL_XOR);
+        }
+
+        // the first chunk after lazy reset pays only for its own bytes
+        BenchmarkTimer push_timer(false);
+        buffer.PushN(&data[0], 4096 < size ? 4096 : size);
+        push_ns += push_timer.ElapsedNs();
+
+        buffer.PushN(&data[0], size);
+        BenchmarkTimer immediate_timer(false);
+        buffer.ResetBuffer(true);
+        immediate_ns += immediate_timer.ElapsedNs();
+        errors += buffer.GetValueAt(size-1)!=0;
+    }
+
+    char name[96];
+    snprintf(name, sizeof(name), "%u KiB byte loop clear", size >> 10);
+    ReportBenchmark(name, rounds, (unsigned long long)rounds*size, loop_ns);
+    snprintf(name, sizeof(name), "%u KiB ResetBuffer() lazy", size >> 10);
+    ReportBenchmark(name, rounds, 0, lazy_ns);
+    snprintf(name, sizeof(name), "%u KiB first 4 KiB push after lazy reset", size >> 10);
+    ReportBenchmark(name, rounds, (unsigned long long)rounds*4096, push_ns);
+    snprintf(name, sizeof(name), "%u KiB ResetBuffer(true) immediate", size >> 10);
+    ReportBenchmark(name, rounds, (unsigned long long)rounds*size, immediate_ns);
+    if(errors)
+        ReportFailure("%llu errors", errors);
+}
+
+static void RunClearBenchmarks(void)
+{
+    printf("\n== Buffer reset and clearing ==\n");
+
+    BenchmarkReset(64u << 10);
+    BenchmarkReset(1u << 20);
+    BenchmarkReset(16u << 20);
+    BenchmarkReset(64u << 20);
+}
+
+BENCHMARK_GROUP("clear", RunClearBenchmarks);
@@ -0,0 +1,156 @@
+#include "benchmark.h"
+#include "buffercrc.h"
+#include "cyclicbuffer.h"
+
+#include <cstring>
+#include <vector>
+
+// CRC of packet-sized ranges crossing the wrap point.
+static void BenchmarkRangeCrc(unsigned int length, unsigned int repeats)
+{
+    int s;
+    CyclicBuffer buffer(8192, s);
+    if(s!=CyclicBuffer::BUFFER_OK)
+        return;
+
+    std::vector<unsigned char> data(8192);
+    for(unsigned int i=0; i<data.size(); i++)
+        data[i] = (unsigned char)(i*7);
+    buffer.PushN(&data[0], data.size());
+
+    // range starts before the top border, so it always wraps
+    unsigned int start = 8192-length/2;
+    unsigned int crc = 0, sum = 0;
+    char name[64];
+
+    BenchmarkTimer timer;
+    for(unsigned int r=0; r<repeats; r++)
+    {
+        crc = CRC32C_INITIAL;
+        unsigned int index = start;
+        for(unsigned int i=0; i<length; i++)
+        {
+            unsigned char ch = buffer.GetValueAt(index, false);
+            crc = Crc32cUpdateTables(crc, &ch, 1);
+            if(++index > buffer.GetTopIndex())
+                index = buffer.GetBottomIndex();
+        }
+        sum += crc;
+    }
+    snprintf(name, sizeof(name), "GetValueAt + bytewise CRC length=%u", length);
+    ReportBenchmark(name, repeats, (unsigned long long)repeats*length, timer);
+
+    CyclicBuffer::buffer_segments segments;
+    buffer.ConsumeRead(start);
+    buffer.PeekRead(segments, length);
+    timer.Start();
+    for(unsigned int r=0; r<repeats; r++)
+    {
+        crc = Crc32cUpdateTables(CRC32C_INITIAL, segments.first, segments.first_length);
+        crc = Crc32cUpdateTables(crc, segments.second, segments.second_length);
+        sum += crc;
+    }
+    snprintf(name, sizeof(name), "slicing-by-8 length=%u", length);
+    ReportBenchmark(name, repeats, (unsigned long long)repeats*length, timer);
+
+    timer.Start();
+    for(unsigned int r=0; r<repeats; r++)
+    {
+        buffer.ComputeCrc(start, length, crc);
+        sum += crc;
+    }
+    snprintf(name, sizeof(name), "ComputeCrc (%s) length=%u", Crc32cImplementation(), length);
+    ReportBenchmark(name, repeats, (unsigned long long)repeats*length, timer);
+
+    benchmark_sink = benchmark_sink + sum;
+}
+
+// Overhead of incremental CRC on bulk pushes.
+static void BenchmarkRunningCrc(bool enabled, unsigned long long total)
+{
+    int s;
+    CyclicBuffer buffer(4096, s);
+    if(s!=CyclicBuffer::BUFFER_OK)
+        return;
+    buffer.EnableRunningCrc(enabled);
+
+    unsigned char chunk[256];
+    for(unsigned int i=0; i<sizeof(chunk); i++)
+        chunk[i] = (unsigned char)i;
+
+    unsigned long long rounds = total/sizeof(chunk);
+    BenchmarkTimer timer;
+    for(unsigned long long r=0; r<rounds; r++)
+    {
+        buffer.PushN(chunk, sizeof(chunk));
+        buffer.ConsumeRead(sizeof(chunk));
+    }
+    ReportBenchmark(enabled ? "PushN 256 B, running CRC" : "PushN 256 B, no CRC", rounds, rounds*sizeof(chunk), timer);
+    benchmark_sink = benchmark_sink + buffer.GetRunningCrc();
+}
+
+// Known check value, selected implementation against tables, wrapped range against contiguous copy.
+static void VerifyCrc(void)
+{
+    const unsigned char check[] = "123456789";
+    if((Crc32cUpdate(CRC32C_INITIAL, check, 9) ^ CRC32C_FINAL_XOR)!=0xE3069283u ||
+       (Crc32cUpdateTables(CRC32C_INITIAL, check, 9) ^ CRC32C_FINAL_XOR)!=0xE3069283u)
+        ReportFailure("CRC-32C(\"123456789\") differs from 0xE3069283");
+
+    unsigned char data[1100];
+    for(unsigned int i=0; i<sizeof(data); i++)
+        data[i] = (unsigned char)(i*131+i/7);
+
+    // unaligned starts and odd lengths exercise heads and tails of the 8-byte steps
+    unsigned long long errors = 0;
+    for(unsigned int start=0; start<16; start++)
+    {
+        for(size_t length=0; length<=1024+start; length+=(length < 80 ? 1 : 37))
+            errors += Crc32cUpdate(CRC32C_INITIAL, data+start, length)!=Crc32cUpdateTables(CRC32C_INITIAL, data+start, length);
+    }
+    if(errors)
+        ReportFailure("%llu CRC values of %s differ from slicing-by-8", errors, Crc32cImplementation());
+
+    int s;
+    CyclicBuffer buffer(512, s);
+    buffer.PushN(data, 300);
+    buffer.ConsumeRead(300);
+    buffer.PushN(data, 400);
+
+    // range of 'length' bytes starts 'offset' bytes behind the read pointer and wraps at index 511
+    errors = 0;
+    for(unsigned int offset=0; offset<200; offset+=13)
+    {
+        for(unsigned int length=1; length<=400-offset; length+=29)
+        {
+            unsigned int crc;
+            unsigned int index = (300+offset) % 512;
+            if(buffer.ComputeCrc(index, length, crc)!=CyclicBuffer::BUFFER_OK ||
+               crc!=(Crc32cUpdateTables(CRC32C_INITIAL, data+offset, length) ^ CRC32C_FINAL_XOR))
+                errors++;
+        }
+    }
+
+    // running CRC covers pushed bytes split by the wrap point
+    buffer.ConsumeRead(400);
+    buffer.EnableRunningCrc(true);
+    buffer.PushN(data, 333);
+    buffer.PushN(data+333, 100);
+    errors += buffer.GetRunningCrc()!=(Crc32cUpdateTables(CRC32C_INITIAL, data, 433) ^ CRC32C_FINAL_XOR);
+    if(errors)
+        ReportFailure("%llu CRC values over wrapped ranges differ from contiguous data", errors);
+}
+
+static void RunCrcBenchmarks(void)
+{
+    printf("\n== CRC-32C over wrapping ranges ==\n");
+    VerifyCrc();
+    BenchmarkRangeCrc(64, 200000);
+    BenchmarkRangeCrc(1024, 20000);
+
+    printf("\n== Incremental CRC ==\n");
+    BenchmarkRunningCrc(false, 256ull<<20);
+    BenchmarkRunningCrc(true, 256ull<<20);
+}
+
+BENCHMARK_GROUP("crc", RunCrcBenchmarks);
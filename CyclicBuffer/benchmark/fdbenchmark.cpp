@@ -0,0 +1,190 @@
+#include "benchmark.h"
+#include "cyclicbuffer.h"
+
+#include <cstdio>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+
+static const size_t CHUNK_LENGTH = 4096;
+
+// Odd buffer size, so reads and writes cross the wrap point at varying offsets.
+static const unsigned int BUFFER_SIZE = 65536+1234;
+
+// Value of byte at given stream position (see 'spscbenchmark.cpp').
+static inline unsigned char StreamByte(unsigned long long position)
+{
+    return (unsigned char)((position*131u)^(position>>8));
+}
+
+// Thread writing 'total' bytes of the stream into the pipe and closing it.
+static void WriteStream(int fd, unsigned long long total)
+{
+    unsigned char chunk[CHUNK_LENGTH];
+    for(unsigned long long position=0; position<total; )
+    {
+        size_t length = CHUNK_LENGTH;
+        if(length > total-position)
+            length = (size_t)(total-position);
+        for(size_t i=0; i<length; i++)
+            chunk[i] = StreamByte(position+i);
+
+        ssize_t n = write(fd, chunk, length);
+        if(n<=0)
+            break;
+        position += (unsigned long long)n;
+    }
+    close(fd);
+}
+
+// Bytes of the stream are read from a pipe into the buffer and verified by 'PeekRead'.
+// Deployments read into temporary array and push it, 'FillFromFd' reads into the buffer directly.
+static void BenchmarkFill(bool direct, unsigned long long total)
+{
+    int fds[2];
+    if(pipe(fds)!=0)
+        return;
+
+    int s;
+    CyclicBuffer buffer(BUFFER_SIZE, s);
+    buffer.SetOverflowPolicy(CyclicBuffer::BUFFER_REJECT);
+
+    BenchmarkTimer timer;
+    std::thread writer(WriteStream, fds[1], total);
+
+    unsigned char chunk[CHUNK_LENGTH];
+    unsigned long long position = 0, errors = 0, calls = 0;
+    for(;;)
+    {
+        size_t n;
+        if(direct)
+        {
+            if(buffer.FillFromFd(fds[0], n, CHUNK_LENGTH)!=CyclicBuffer::BUFFER_OK)
+                break;
+        }
+        else
+        {
+            ssize_t length = read(fds[0], chunk, CHUNK_LENGTH);
+            if(length<=0)
+                break;
+            n = buffer.PushN(chunk, (size_t)length);
+        }
+        calls++;
+
+        CyclicBuffer::buffer_segments segments;
+        size_t available = buffer.PeekRead(segments);
+        for(size_t i=0; i<segments.first_length; i++)
+            errors += segments.first[i]!=StreamByte(position+i);
+        for(size_t i=0; i<segments.second_length; i++)
+            errors += segments.second[i]!=StreamByte(position+segments.first_length+i);
+        buffer.ConsumeRead(available);
+        position += available;
+    }
+
+    writer.join();
+    close(fds[0]);
+
+    ReportBenchmark(direct ? "FillFromFd from pipe" : "read() + PushN from pipe", calls, total, timer);
+    if(errors || position!=total)
+        ReportFailure("%llu errors, %llu of %llu bytes received", errors, position, total);
+}
+
+// Buffer is refilled by 'PushN' and drained into a pipe read by other thread.
+// Deployments pop into temporary array and write it, 'DrainToFd' writes from the buffer directly.
+static void BenchmarkDrain(bool direct, unsigned long long total)
+{
+    int fds[2];
+    if(pipe(fds)!=0)
+        return;
+
+    int s;
+    CyclicBuffer buffer(BUFFER_SIZE, s);
+    buffer.SetOverflowPolicy(CyclicBuffer::BUFFER_REJECT);
+
+    unsigned long long received = 0, errors = 0;
+    BenchmarkTimer timer;
+
+    std::thread reader([&]() {
+        unsigned char chunk[CHUNK_LENGTH];
+        ssize_t n;
+        while((n = read(fds[0], chunk, CHUNK_LENGTH)) > 0)
+        {
+            for(ssize_t i=0; i<n; i++)
+                errors += chunk[i]!=StreamByte(received+i);
+            received += (unsigned long long)n;
+        }
+    });
+
+    unsigned char chunk[CHUNK_LENGTH];
+    unsigned long long pushed = 0, sent = 0, calls = 0;
+    while(sent < total)
+    {
+        // keep the buffer filled, so writes cross the wrap point
+        while(pushed < total && buffer.FreeSpace() >= CHUNK_LENGTH)
+        {
+            size_t length = CHUNK_LENGTH;
+            if(length > total-pushed)
+                length = (size_t)(total-pushed);
+            for(size_t i=0; i<length; i++)
+                chunk[i] = StreamByte(pushed+i);
+            pushed += buffer.PushN(chunk, length);
+        }
+
+        size_t n;
+        if(direct)
+        {
+            if(buffer.DrainToFd(fds[1], n, CHUNK_LENGTH)!=CyclicBuffer::BUFFER_OK)
+                break;
+        }
+        else
+        {
+            size_t length = buffer.PopN(chunk, CHUNK_LENGTH);
+            ssize_t written = 0;
+            while((size_t)written < length)
+            {
+                ssize_t w = write(fds[1], chunk+written, length-written);
+                if(w<=0)
+                    break;
+                written += w;
+            }
+            n = (size_t)written;
+        }
+        sent += n;
+        calls++;
+    }
+
+    close(fds[1]);
+    reader.join();
+    close(fds[0]);
+
+    ReportBenchmark(direct ? "DrainToFd into pipe" : "PopN + write() into pipe", calls, total, timer);
+    if(errors || received!=total)
+        ReportFailure("%llu errors, %llu of %llu bytes received", errors, received, total);
+}
+
+#endif
+
+static void RunFdBenchmarks(void)
+{
+    printf("\n== File descriptor transfers, 4 KiB chunks (every byte verified) ==\n");
+
+#if defined(__unix__) || defined(__APPLE__)
+    // broken pipe is reported by error code
+    signal(SIGPIPE, SIG_IGN);
+
+    const unsigned long long total = 512ull << 20;
+    BenchmarkFill(false, total);
+    BenchmarkFill(true, total);
+    BenchmarkDrain(false, total);
+    BenchmarkDrain(true, total);
+#else
+    printf("  file descriptor benchmarks require POSIX system\n");
+#endif
+}
+
+BENCHMARK_GROUP("fd", RunFdBenchmarks);
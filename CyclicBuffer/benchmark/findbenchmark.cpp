@@ -0,0 +1,148 @@
+#include "benchmark.h"
+#include "bytesearch.h"
+#include "cyclicbuffer.h"
+
+#include <cstring>
+#include <vector>
+
+// Searches terminator at the end of deep unread region, data wrap around the top border.
+static void BenchmarkFind(unsigned int depth, unsigned int repeats)
+{
+    int s;
+    CyclicBuffer buffer(depth+4096, s);
+    if(s!=CyclicBuffer::BUFFER_OK)
+        return;
+
+    // move pointers, so unread data cross the wrap point
+    std::vector<unsigned char> data(depth, 0x11);
+    buffer.PushN(&data[0], 4096);
+    buffer.ConsumeRead(4096);
+    buffer.SetPushIndex(depth/2+4096);
+    buffer.SetPopIndex(depth/2+4096);
+
+    data[depth-3] = 0x7E;
+    data[depth-2] = 0x55;
+    data[depth-1] = 0xAA;
+    buffer.PushN(&data[0], depth);
+
+    unsigned int read_index = buffer.GetPopIndex();
+    unsigned int bottom = buffer.GetBottomIndex(), top = buffer.GetTopIndex();
+    size_t found = 0;
+    char name[64];
+
+    BenchmarkTimer timer;
+    for(unsigned int r=0; r<repeats; r++)
+    {
+        // byte by byte random access, as consumers had to do before
+        unsigned int index = read_index;
+        for(unsigned int i=0; i<depth; i++)
+        {
+            if(buffer.GetValueAt(index, false)==0x7E)
+            {
+                found += i;
+                break;
+            }
+            if(++index > top)
+                index = bottom;
+        }
+    }
+    snprintf(name, sizeof(name), "GetValueAt loop depth=%u", depth);
+    ReportBenchmark(name, repeats, (unsigned long long)repeats*depth, timer);
+
+    timer.Start();
+    for(unsigned int r=0; r<repeats; r++)
+        found += buffer.Find(0x7E);
+    snprintf(name, sizeof(name), "Find(byte) depth=%u", depth);
+    ReportBenchmark(name, repeats, (unsigned long long)repeats*depth, timer);
+
+    const unsigned char sync[] = { 0x7E, 0x55, 0xAA };
+    timer.Start();
+    for(unsigned int r=0; r<repeats; r++)
+        found += buffer.Find(sync, sizeof(sync));
+    snprintf(name, sizeof(name), "Find(sequence) depth=%u", depth);
+    ReportBenchmark(name, repeats, (unsigned long long)repeats*depth, timer);
+
+    benchmark_sink = benchmark_sink + (unsigned int)found;
+
+    // terminator and sync word are the last bytes of unread data
+    if(buffer.Find(0x7E)!=depth-3 || buffer.Find(sync, sizeof(sync))!=depth-3 || buffer.Find(0xAA, depth-2)!=depth-1)
+        ReportFailure("Find depth=%u returned wrong offset", depth);
+}
+
+// Every implementation is compared with 'memchr' at unaligned starts and lengths covering vector tails.
+static unsigned long long VerifyFindByte(void)
+{
+    unsigned char data[256];
+    unsigned int random = 1;
+    for(unsigned int i=0; i<sizeof(data); i++)
+    {
+        random = random*1103515245u+12345u;
+        data[i] = (unsigned char)(random >> 16);
+    }
+
+    unsigned long long errors = 0;
+    for(unsigned int start=0; start<64; start++)
+    {
+        for(size_t length=0; length<=130; length++)
+        {
+            // byte at the end of block, at its start and a byte that may be missing
+            const unsigned char values[] = { length ? data[start+length-1] : (unsigned char)0, data[start], 0x7E };
+            for(unsigned int v=0; v<sizeof(values); v++)
+                errors += FindByte(data+start, length, values[v])!=(const unsigned char *)memchr(data+start, values[v], length);
+        }
+    }
+    return errors;
+}
+
+// Sequence and byte crossing 'top_index' to 'bottom_index' are found at right offsets.
+static unsigned long long VerifyWrappedFind(void)
+{
+    int s;
+    CyclicBuffer buffer(64, s);
+    unsigned char data[64];
+    memset(data, 0x11, sizeof(data));
+    buffer.PushN(data, 60);
+    buffer.ConsumeRead(60);
+
+    // unread data start at index 60, sync word occupies indexes 62, 63 and 0
+    data[2] = 0x7E;
+    data[3] = 0x55;
+    data[4] = 0xAA;
+    data[20] = 0x7E;
+    buffer.PushN(data, 32);
+
+    const unsigned char sync[] = { 0x7E, 0x55, 0xAA };
+    unsigned long long errors = 0;
+    errors += buffer.Find(0x7E)!=2;
+    errors += buffer.Find(0xAA)!=4;
+    errors += buffer.Find(0x7E, 3)!=20;
+    errors += buffer.Find(sync, sizeof(sync))!=2;
+    errors += buffer.Find(sync, sizeof(sync), 3)!=CyclicBuffer::BUFFER_NOT_FOUND;
+    errors += buffer.Find(0x22)!=CyclicBuffer::BUFFER_NOT_FOUND;
+    return errors;
+}
+
+static void VerifyFind(void)
+{
+    const char * implementations[] = { "scalar", "sse2", "avx2" };
+    for(unsigned int i=0; i<sizeof(implementations)/sizeof(implementations[0]); i++)
+    {
+        if(!SelectFindByteImplementation(implementations[i]))
+            continue;
+        unsigned long long errors = VerifyFindByte()+VerifyWrappedFind();
+        if(errors)
+            ReportFailure("%llu wrong results of %s search", errors, implementations[i]);
+    }
+    SelectFindByteImplementation(NULL);
+}
+
+static void RunFindBenchmarks(void)
+{
+    printf("\n== Delimiter search over unread data (implementation: %s) ==\n", FindByteImplementation());
+    VerifyFind();
+    BenchmarkFind(4096, 20000);
+    BenchmarkFind(65536, 2000);
+    BenchmarkFind(1 << 20, 100);
+}
+
+BENCHMARK_GROUP("find", RunFindBenchmarks);
@@ -0,0 +1,155 @@
+#include "benchmark.h"
+#include "buffercrc.h"
+#include "cyclicbuffer.h"
+#include "packetframer.h"
+
+#include <cstring>
+#include <vector>
+
+static const unsigned char FRAME_END = 0xFE;
+
+static const size_t FRAME_MAX = 1024;
+
+// Builds stream of valid frames with payload of 20 to 200 bytes, returns number of frames whose
+// CRC contains the ending character. If 'garbage' is true, every 50th frame is preceded by noise
+// (also containing ending characters and terminated as a corrupted frame), so the framer has to resynchronize.
+static unsigned long long BuildFrameStream(std::vector<unsigned char> &stream, size_t size, bool garbage, unsigned long long &frames)
+{
+    unsigned long long terminator_in_crc = 0;
+    frames = 0;
+    for(unsigned int p=0; stream.size() < size; p++)
+    {
+        if(garbage && p % 50==25)
+        {
+            unsigned int length = 10+(p*31)%300;
+            for(unsigned int i=0; i<length; i++)
+                stream.push_back((i % 37)==5 || i+1==length ? FRAME_END : (unsigned char)(p*13+i*29));
+        }
+
+        std::vector<unsigned char> frame;
+        unsigned int length = 20+(p*53)%180;
+        for(unsigned int i=0; i<length; i++)
+            frame.push_back((unsigned char)((p+i*7)%200));
+
+        unsigned int crc = Crc32cUpdate(CRC32C_INITIAL, &frame[0], frame.size()) ^ CRC32C_FINAL_XOR;
+        bool in_crc = false;
+        for(int i=0; i<4; i++)
+        {
+            frame.push_back((unsigned char)(crc >> (8*i)));
+            in_crc = in_crc || frame.back()==FRAME_END;
+        }
+        terminator_in_crc += in_crc;
+
+        frame.push_back(FRAME_END);
+        stream.insert(stream.end(), frame.begin(), frame.end());
+        frames++;
+    }
+    return terminator_in_crc;
+}
+
+// Consumer popping bytes until the ending character, CRC computed on popped copy. When CRC does not
+// match, ending character is taken as part of the frame, frame exceeding maximal length is dropped.
+static unsigned long long PopLoopFrames(CyclicBuffer &buffer, const std::vector<unsigned char> &stream, int passes)
+{
+    unsigned long long frames = 0;
+    std::vector<unsigned char> frame(FRAME_MAX);
+    size_t frame_length = 0;
+
+    for(int pass=0; pass<passes; pass++)
+    {
+        size_t position = 0;
+        while(position < stream.size())
+        {
+            position += buffer.PushN(&stream[position], stream.size()-position < 1400 ? stream.size()-position : 1400);
+
+            unsigned char ch;
+            while(!buffer.IsEmpty())
+            {
+                ch = buffer.Pop();
+                frame[frame_length++] = ch;
+                if(ch!=FRAME_END && frame_length < FRAME_MAX)
+                    continue;
+
+                if(ch==FRAME_END && frame_length >= 5)
+                {
+                    unsigned int crc = Crc32cUpdate(CRC32C_INITIAL, &frame[0], frame_length-5) ^ CRC32C_FINAL_XOR;
+                    if(memcmp(&crc, &frame[frame_length-5], 4)==0)
+                    {
+                        frames++;
+                        frame_length = 0;
+                        continue;
+                    }
+                }
+                if(frame_length >= FRAME_MAX)
+                    frame_length = 0;
+            }
+        }
+    }
+    return frames;
+}
+
+static unsigned long long FramerFrames(CyclicBuffer &buffer, PacketFramer &framer, const std::vector<unsigned char> &stream, int passes)
+{
+    PacketFramer::frame_view view;
+    unsigned long long frames = 0;
+
+    for(int pass=0; pass<passes; pass++)
+    {
+        size_t position = 0;
+        while(position < stream.size())
+        {
+            position += buffer.PushN(&stream[position], stream.size()-position < 1400 ? stream.size()-position : 1400);
+
+            while(framer.NextFrame(view))
+            {
+                framer.ReleaseFrame(view);
+                frames++;
+            }
+        }
+    }
+    return frames;
+}
+
+static void RunFramerBenchmarks(void)
+{
+    printf("\n== Framing with CRC validation (buffer 8 KiB) ==\n");
+
+    std::vector<unsigned char> stream;
+    unsigned long long stream_frames;
+    unsigned long long terminator_in_crc = BuildFrameStream(stream, 1 << 20, false, stream_frames);
+    const int passes = 64;
+
+    int s;
+    CyclicBuffer buffer(8192, s);
+    buffer.SetOverflowPolicy(CyclicBuffer::BUFFER_REJECT);
+
+    BenchmarkTimer timer;
+    unsigned long long frames = PopLoopFrames(buffer, stream, passes);
+    ReportBenchmark("Pop loop + CRC", frames, passes*(unsigned long long)stream.size(), timer);
+
+    PacketFramer framer(buffer, FRAME_END, 4, FRAME_MAX);
+    timer.Start();
+    unsigned long long framer_frames = FramerFrames(buffer, framer, stream, passes);
+    ReportBenchmark("PacketFramer", framer_frames, passes*(unsigned long long)stream.size(), timer);
+
+    // frames with the ending character inside CRC must not be cut
+    unsigned long long expected = passes*stream_frames;
+    if(frames!=expected || framer_frames!=expected || framer.GetCrcFailures() || framer.GetDroppedBytes() || !terminator_in_crc)
+        ReportFailure("frames %llu/%llu of %llu (%llu with ending character in CRC), CRC failures %llu, dropped %llu B",
+               frames, framer_frames, expected, passes*terminator_in_crc, framer.GetCrcFailures(), framer.GetDroppedBytes());
+
+    // noise between frames, every valid frame is recovered
+    std::vector<unsigned char> noisy;
+    BuildFrameStream(noisy, 1 << 20, true, stream_frames);
+    buffer.ResetBuffer();
+    PacketFramer resync(buffer, FRAME_END, 4, FRAME_MAX);
+    timer.Start();
+    framer_frames = FramerFrames(buffer, resync, noisy, passes);
+    ReportBenchmark("PacketFramer, noise between frames", framer_frames, passes*(unsigned long long)noisy.size(), timer);
+
+    expected = passes*stream_frames;
+    if(framer_frames!=expected || !resync.GetDroppedBytes())
+        ReportFailure("frames %llu of %llu after resynchronization, dropped %llu B", framer_frames, expected, resync.GetDroppedBytes());
+}
+
+BENCHMARK_GROUP("framer", RunFramerBenchmarks);
@@ -0,0 +1,121 @@
+#include "benchmark.h"
+
+#include <cstdarg>
+#include <cstring>
+#include <vector>
+
+volatile unsigned int benchmark_sink = 0;
+
+namespace
+{
+
+unsigned int failure_count = 0;
+
+struct registered_benchmark
+{
+    const char * name;
+    benchmark_function function;
+};
+
+std::vector<registered_benchmark> & Registry(void)
+{
+    static std::vector<registered_benchmark> registry;
+    return registry;
+}
+
+// Filter is comma separated list of substrings, group runs if its name contains any of them.
+bool MatchesFilter(const char * name, const char * filter)
+{
+    if(filter==NULL)
+        return true;
+
+    const char * part = filter;
+    while(*part)
+    {
+        size_t length = strcspn(part, ",");
+        for(const char * n = name; strlen(n) >= length; n++)
+        {
+            if(length && strncmp(n, part, length)==0)
+                return true;
+        }
+        part += length;
+        if(*part==',')
+            part++;
+    }
+    return false;
+}
+
+void PrintUsage(const char * program)
+{
+    printf("Usage: %s [--list] [--filter=name[,name...]] [--no-perf]\n", program);
+    printf("  --list        print names of benchmark groups\n");
+    printf("  --filter=...  run only groups whose name contains any of given texts\n");
+    printf("  --no-perf     do not read hardware cache-miss counter\n");
+}
+
+}
+
+void ReportFailure(const char * format, ...)
+{
+    va_list arguments;
+    va_start(arguments, format);
+    printf("    ERROR: ");
+    vprintf(format, arguments);
+    printf("\n");
+    va_end(arguments);
+    failure_count++;
+}
+
+int RegisterBenchmark(const char * name, benchmark_function function)
+{
+    registered_benchmark benchmark = { name, function };
+    Registry().push_back(benchmark);
+    return (int)Registry().size();
+}
+
+int main(int argc, char *argv[])
+{
+    const char * filter = NULL;
+    bool list = false;
+
+    for(int i=1; i<argc; i++)
+    {
+        if(strcmp(argv[i], "--list")==0)
+            list = true;
+        else if(strncmp(argv[i], "--filter=", 9)==0)
+            filter = argv[i]+9;
+        else if(strcmp(argv[i], "--no-perf")==0)
+            DisableCacheMissCounter();
+        else
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    const std::vector<registered_benchmark> &registry = Registry();
+
+    if(list)
+    {
+        for(size_t i=0; i<registry.size(); i++)
+            printf("%s\n", registry[i].name);
+        return 0;
+    }
+
+    printf("Cache-miss counter: %s\n", CacheMissCounterAvailable() ? "perf_event_open" : "not available");
+
+    for(size_t i=0; i<registry.size(); i++)
+    {
+        if(MatchesFilter(registry[i].name, filter))
+            registry[i].function();
+    }
+
+    // verification failures make the run fail, so it can be used as a test
+    if(failure_count)
+    {
+        printf("\n%u verification failures\n", failure_count);
+        return 2;
+    }
+
+    return 0;
+}
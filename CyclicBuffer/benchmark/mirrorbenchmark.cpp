@@ -0,0 +1,147 @@
+#include "benchmark.h"
+#include "cyclicbuffer.h"
+
+#include <cstring>
+#include <vector>
+
+static const unsigned char PACKET_END = 0x7E;
+
+// Sums packet bytes, stands for decoding of packet fields. If 'parsed' is given, packet is appended to it.
+static inline unsigned int ParsePacket(const unsigned char * packet, size_t length, std::vector<unsigned char> * parsed)
+{
+    if(parsed!=NULL)
+        parsed->insert(parsed->end(), packet, packet+length);
+
+    unsigned int sum = 0;
+    for(size_t i=0; i<length; i++)
+        sum += packet[i];
+    return sum;
+}
+
+// Stream of packets with various lengths, so packets straddle the wrap point often.
+static void BuildPacketStream(std::vector<unsigned char> &stream)
+{
+    for(unsigned int p=0; stream.size() < 64*1024; p++)
+    {
+        unsigned int length = 40+(p*37)%60;
+        for(unsigned int i=0; i<length; i++)
+            stream.push_back((unsigned char)((p+i) & 0x3F));
+        stream.push_back(PACKET_END);
+    }
+}
+
+// Parses all complete packets available in buffer. Packets lying in one contiguous
+// region are parsed in place, packets straddling the wrap point are copied into temporary.
+static unsigned int ParseAvailable(CyclicBuffer &buffer, unsigned char * temporary, unsigned long long &slow_path,
+                                   std::vector<unsigned char> * parsed = NULL)
+{
+    unsigned int sum = 0;
+    CyclicBuffer::buffer_segments segments;
+
+    for(;;)
+    {
+        buffer.PeekRead(segments);
+
+        const unsigned char * end = (const unsigned char *)memchr(segments.first, PACKET_END, segments.first_length);
+        if(end!=NULL)
+        {
+            size_t length = (size_t)(end-segments.first)+1;
+            sum += ParsePacket(segments.first, length, parsed);
+            buffer.ConsumeRead(length);
+            continue;
+        }
+
+        // packet is not complete or it continues after the wrap point
+        end = (const unsigned char *)memchr(segments.second, PACKET_END, segments.second_length);
+        if(end==NULL)
+            return sum;
+
+        size_t second = (size_t)(end-segments.second)+1;
+        memcpy(temporary, segments.first, segments.first_length);
+        memcpy(temporary+segments.first_length, segments.second, second);
+        sum += ParsePacket(temporary, segments.first_length+second, parsed);
+        buffer.ConsumeRead(segments.first_length+second);
+        slow_path++;
+    }
+}
+
+static void BenchmarkParsing(const char * name, bool mirrored, unsigned int buffer_size, unsigned long long total_bytes)
+{
+    int s;
+    CyclicBuffer buffer(buffer_size, s, mirrored);
+    if(s!=CyclicBuffer::BUFFER_OK)
+        return;
+    if(mirrored && !buffer.IsMirrored())
+    {
+        printf("%-48s mirrored memory not availible\n", name);
+        return;
+    }
+
+    std::vector<unsigned char> stream;
+    BuildPacketStream(stream);
+
+    std::vector<unsigned char> temporary(buffer_size);
+    unsigned long long slow_path = 0, pushed = 0;
+    unsigned int sum = 0;
+    size_t position = 0;
+
+    BenchmarkTimer timer;
+    while(pushed < total_bytes)
+    {
+        // producer delivers chunks of 700 bytes, parser takes all complete packets
+        size_t length = stream.size()-position;
+        if(length > 700)
+            length = 700;
+        size_t n = buffer.PushN(&stream[position], length);
+        position = (position+n) % stream.size();
+        pushed += n;
+
+        sum += ParseAvailable(buffer, &temporary[0], slow_path);
+    }
+    double ns = timer.ElapsedNs();
+
+    ReportBenchmark(name, pushed, pushed, ns);
+    printf("    packets copied on wrap: %llu\n", slow_path);
+    benchmark_sink = benchmark_sink + sum;
+}
+
+// Parses the whole stream once (wrapping the buffer many times), parsed packets must match it byte for byte.
+static void VerifyParsing(const char * name, bool mirrored, unsigned int buffer_size)
+{
+    int s;
+    CyclicBuffer buffer(buffer_size, s, mirrored);
+    if(s!=CyclicBuffer::BUFFER_OK || (mirrored && !buffer.IsMirrored()))
+        return;
+
+    std::vector<unsigned char> stream, parsed, temporary(buffer_size);
+    BuildPacketStream(stream);
+    unsigned long long slow_path = 0;
+
+    for(size_t position = 0; position < stream.size(); position += 700)
+    {
+        size_t length = stream.size()-position < 700 ? stream.size()-position : 700;
+        if(buffer.PushN(&stream[position], length)!=length)
+            break;
+        ParseAvailable(buffer, &temporary[0], slow_path, &parsed);
+    }
+
+    if(parsed!=stream || (!mirrored && !slow_path))
+    {
+        size_t i = 0;
+        while(i < parsed.size() && i < stream.size() && parsed[i]==stream[i])
+            i++;
+        ReportFailure("%s: parsed %u of %u B, first difference at %u", name,
+                      (unsigned int)parsed.size(), (unsigned int)stream.size(), (unsigned int)i);
+    }
+}
+
+static void RunMirrorBenchmarks(void)
+{
+    printf("\n== Packet parsing across the wrap point (buffer 4096 B) ==\n");
+    VerifyParsing("heap memory", false, 4096);
+    VerifyParsing("mirrored memory", true, 4096);
+    BenchmarkParsing("heap memory", false, 4096, 256ull<<20);
+    BenchmarkParsing("mirrored memory", true, 4096, 256ull<<20);
+}
+
+BENCHMARK_GROUP("mirror", RunMirrorBenchmarks);
@@ -0,0 +1,169 @@
+#include "benchmark.h"
+#include "cyclicbuffer.h"
+#include "mpsccyclicbuffer.h"
+
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static const size_t PACKET_LENGTH = 64;
+
+// Packet carries producer ID and sequence number, the rest is filled with value
+// derived from them, so bytewise interleaving of packets is detected.
+static void BuildPacket(unsigned char * packet, unsigned char producer, unsigned int sequence)
+{
+    packet[0] = producer;
+    memcpy(packet+1, &sequence, sizeof(sequence));
+    memset(packet+5, (unsigned char)(producer+sequence), PACKET_LENGTH-5);
+}
+
+// Checks packet consistency and per-producer order. Returns false on error.
+static bool CheckPacket(const unsigned char * packet, std::vector<unsigned int> &next_sequence)
+{
+    unsigned int sequence;
+    memcpy(&sequence, packet+1, sizeof(sequence));
+    if(packet[0] >= next_sequence.size() || sequence!=next_sequence[packet[0]])
+        return false;
+    for(size_t i=5; i<PACKET_LENGTH; i++)
+    {
+        if(packet[i]!=(unsigned char)(packet[0]+sequence))
+            return false;
+    }
+    next_sequence[packet[0]]++;
+    return true;
+}
+
+static void BenchmarkMutex(unsigned int producers, unsigned int packets_per_producer)
+{
+    int s;
+    CyclicBuffer buffer(65536, s);
+    buffer.SetOverflowPolicy(CyclicBuffer::BUFFER_REJECT);
+    std::mutex mutex;
+
+    BenchmarkTimer timer;
+
+    std::vector<std::thread> threads;
+    for(unsigned int p=0; p<producers; p++)
+    {
+        threads.push_back(std::thread([&, p]() {
+            unsigned char packet[PACKET_LENGTH];
+            for(unsigned int i=0; i<packets_per_producer; i++)
+            {
+                BuildPacket(packet, (unsigned char)p, i);
+                for(;;)
+                {
+                    {
+                        // whole packet or nothing, so packets do not interleave
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if(buffer.FreeSpace() >= PACKET_LENGTH)
+                        {
+                            buffer.PushN(packet, PACKET_LENGTH);
+                            break;
+                        }
+                    }
+                    std::this_thread::yield();
+                }
+            }
+        }));
+    }
+
+    std::vector<unsigned int> next_sequence(producers, 0);
+    unsigned long long total = (unsigned long long)producers*packets_per_producer, received = 0, errors = 0;
+    unsigned char packet[PACKET_LENGTH];
+    while(received < total)
+    {
+        size_t n;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            n = buffer.Available() >= PACKET_LENGTH ? buffer.PopN(packet, PACKET_LENGTH) : 0;
+        }
+        if(!n)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        if(!CheckPacket(packet, next_sequence))
+            errors++;
+        received++;
+    }
+
+    for(unsigned int p=0; p<producers; p++)
+        threads[p].join();
+
+    char name[64];
+    snprintf(name, sizeof(name), "mutex CyclicBuffer producers=%u", producers);
+    ReportBenchmark(name, total, total*PACKET_LENGTH, timer);
+    if(errors)
+        ReportFailure("%llu packets corrupted or out of order", errors);
+}
+
+static void BenchmarkMpsc(unsigned int producers, unsigned int packets_per_producer)
+{
+    int s;
+    MpscCyclicBuffer buffer(65536, s);
+
+    BenchmarkTimer timer;
+
+    std::vector<std::thread> threads;
+    for(unsigned int p=0; p<producers; p++)
+    {
+        threads.push_back(std::thread([&, p]() {
+            unsigned char packet[PACKET_LENGTH];
+            for(unsigned int i=0; i<packets_per_producer; i++)
+            {
+                BuildPacket(packet, (unsigned char)p, i);
+                buffer.Push(packet, PACKET_LENGTH);
+            }
+        }));
+    }
+
+    std::vector<unsigned int> next_sequence(producers, 0);
+    unsigned long long total = (unsigned long long)producers*packets_per_producer, received = 0, errors = 0;
+    MpscCyclicBuffer::packet_slot slot;
+    unsigned char packet[PACKET_LENGTH];
+    while(received < total)
+    {
+        if(!buffer.Peek(slot))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // verify in place when the packet does not wrap
+        const unsigned char * data = slot.segments.first;
+        if(slot.segments.second_length)
+        {
+            memcpy(packet, slot.segments.first, slot.segments.first_length);
+            memcpy(packet+slot.segments.first_length, slot.segments.second, slot.segments.second_length);
+            data = packet;
+        }
+        if(slot.length!=PACKET_LENGTH || !CheckPacket(data, next_sequence))
+            errors++;
+        buffer.Release(slot);
+        received++;
+    }
+
+    for(unsigned int p=0; p<producers; p++)
+        threads[p].join();
+
+    char name[64];
+    snprintf(name, sizeof(name), "MpscCyclicBuffer producers=%u", producers);
+    ReportBenchmark(name, total, total*PACKET_LENGTH, timer);
+    if(errors)
+        ReportFailure("%llu packets corrupted or out of order", errors);
+}
+
+static void RunMpscBenchmarks(void)
+{
+    printf("\n== Multi-producer ingest, 64 B packets (buffer 64 KiB, every packet verified) ==\n");
+
+    const unsigned int total_packets = 1 << 21;
+    for(unsigned int producers=1; producers<=16; producers*=2)
+    {
+        BenchmarkMutex(producers, total_packets/producers);
+        BenchmarkMpsc(producers, total_packets/producers);
+    }
+}
+
+BENCHMARK_GROUP("mpsc", RunMpscBenchmarks);
@@ -0,0 +1,160 @@
+#include "benchmark.h"
+#include "buffernotifier.h"
+#include "cyclicbuffer.h"
+#include "spsccyclicbuffer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+static const size_t PACKET_LENGTH = 64;
+static const unsigned char TERMINATOR = '\n';
+
+// Cost of notifier in producer's path, notifier stays disarmed as nobody acknowledges.
+static void BenchmarkNotifierOverhead(bool attach)
+{
+    int s;
+    SpscCyclicBuffer buffer(65536, s);
+    BufferNotifier notifier(s);
+    notifier.SetTerminator(TERMINATOR);
+    if(attach)
+        buffer.SetNotifier(&notifier);
+
+    unsigned char packet[PACKET_LENGTH], out[PACKET_LENGTH];
+    memset(packet, 'x', sizeof(packet));
+    packet[PACKET_LENGTH-1] = TERMINATOR;
+
+    const unsigned long long packets = 4000000;
+    BenchmarkTimer timer;
+    for(unsigned long long i=0; i<packets; i++)
+    {
+        buffer.PushN(packet, PACKET_LENGTH);
+        buffer.PopN(out, PACKET_LENGTH);
+    }
+    ReportBenchmark(attach ? "SpscCyclicBuffer push+pop with notifier" : "SpscCyclicBuffer push+pop without notifier",
+                    packets, packets*PACKET_LENGTH, timer);
+}
+
+#if defined(__linux__)
+
+static double ThreadCpuNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return (double)now.tv_sec*1e9+(double)now.tv_nsec;
+}
+
+// Producer pushes packets in bursts, consumer either waits in epoll for the notifier
+// or polls 'PopN' yielding when empty. Consumer counts terminators to verify all packets arrived.
+static void BenchmarkConsumerWakeup(bool use_epoll, size_t threshold, unsigned int burst)
+{
+    int s;
+    SpscCyclicBuffer buffer(1 << 20, s);
+    BufferNotifier notifier(s);
+    notifier.SetThreshold(threshold);
+    notifier.SetTerminator(threshold ? -1 : TERMINATOR);
+    if(use_epoll)
+        buffer.SetNotifier(&notifier);
+
+    // the same number of bursts in every run
+    const unsigned long long packets = 12500ull*burst;
+    unsigned long long wakeups = 0, received = 0;
+    double consumer_cpu_ns = 0.0;
+
+    BenchmarkTimer timer;
+
+    std::thread consumer([&]() {
+        double start = ThreadCpuNs();
+        int epoll = -1;
+        if(use_epoll)
+        {
+            epoll = epoll_create1(0);
+            struct epoll_event event;
+            event.events = EPOLLIN;
+            event.data.fd = notifier.GetDescriptor();
+            epoll_ctl(epoll, EPOLL_CTL_ADD, notifier.GetDescriptor(), &event);
+        }
+
+        unsigned char chunk[4096];
+        while(received < packets)
+        {
+            if(use_epoll)
+            {
+                struct epoll_event event;
+                if(epoll_wait(epoll, &event, 1, 1000)<=0)
+                    break;
+                wakeups++;
+            }
+
+            size_t n;
+            while((n = buffer.PopN(chunk, sizeof(chunk)))!=0)
+            {
+                for(size_t i=0; i<n; i++)
+                    received += chunk[i]==TERMINATOR;
+            }
+
+            if(use_epoll)
+                buffer.AcknowledgeNotification();
+            else
+                std::this_thread::yield();
+        }
+        if(epoll>=0)
+            close(epoll);
+        consumer_cpu_ns = ThreadCpuNs()-start;
+    });
+
+    unsigned char packet[PACKET_LENGTH];
+    memset(packet, 'x', sizeof(packet));
+    packet[PACKET_LENGTH-1] = TERMINATOR;
+
+    for(unsigned long long i=0; i<packets; i++)
+    {
+        while(!buffer.PushN(packet, PACKET_LENGTH))
+            std::this_thread::yield();
+        // serial link delivers packets in bursts
+        if((i % burst)==burst-1)
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+
+    consumer.join();
+
+    char name[96];
+    if(!use_epoll)
+        snprintf(name, sizeof(name), "polling consumer, bursts of %u", burst);
+    else if(threshold)
+        snprintf(name, sizeof(name), "epoll consumer, %zu byte threshold, bursts of %u", threshold, burst);
+    else
+        snprintf(name, sizeof(name), "epoll consumer, terminator, bursts of %u", burst);
+    ReportBenchmark(name, packets, packets*PACKET_LENGTH, timer);
+    printf("    consumer CPU %.0f ns/packet", consumer_cpu_ns/(double)packets);
+    if(use_epoll)
+        printf(", %llu wakeups (%.2f packets per wakeup), %llu signals", wakeups, (double)received/(double)(wakeups ? wakeups : 1), notifier.GetSignalCount());
+    printf("\n");
+    if(received!=packets)
+        ReportFailure("%llu packets lost", packets-received);
+}
+
+#endif
+
+static void RunNotifyBenchmarks(void)
+{
+    printf("\n== Consumer notification, 64 B packets (every packet counted) ==\n");
+
+    BenchmarkNotifierOverhead(false);
+    BenchmarkNotifierOverhead(true);
+#if defined(__linux__)
+    BenchmarkConsumerWakeup(false, 0, 16);
+    BenchmarkConsumerWakeup(true, 0, 16);
+    BenchmarkConsumerWakeup(true, 1024, 16);
+    BenchmarkConsumerWakeup(true, 0, 1);
+#endif
+}
+
+BENCHMARK_GROUP("notify", RunNotifyBenchmarks);
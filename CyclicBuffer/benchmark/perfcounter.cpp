@@ -0,0 +1,72 @@
+#include "benchmark.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+namespace
+{
+
+// Counter is opened once for the whole process. With 'inherit' set, threads
+// created later are counted too (their counts are added when they finish).
+struct CacheMissCounter
+{
+    int fd;
+
+    CacheMissCounter(void) : fd(-1)
+    {
+#if defined(__linux__) && defined(SYS_perf_event_open)
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+    }
+
+    ~CacheMissCounter(void)
+    {
+#if defined(__linux__)
+        if(fd >= 0)
+            close(fd);
+#endif
+    }
+};
+
+CacheMissCounter & Counter(void)
+{
+    static CacheMissCounter counter;
+    return counter;
+}
+
+bool counter_disabled = false;
+
+}
+
+bool CacheMissCounterAvailable(void)
+{
+    return !counter_disabled && Counter().fd >= 0;
+}
+
+unsigned long long ReadCacheMissCounter(void)
+{
+    unsigned long long value = 0;
+#if defined(__linux__)
+    if(CacheMissCounterAvailable() && read(Counter().fd, &value, sizeof(value))!=(ssize_t)sizeof(value))
+        value = 0;
+#endif
+    return value;
+}
+
+void DisableCacheMissCounter(void)
+{
+    counter_disabled = true;
+}
@@ -0,0 +1,165 @@
+#include "benchmark.h"
+#include "cyclicbuffer.h"
+#include "persistentcyclicbuffer.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <cstdio>
+
+static const size_t CHUNK_LENGTH = 256;
+static const unsigned int BUFFER_SIZE = 1 << 20;
+
+static const char * BenchmarkPath(const char * suffix, char * path, size_t length)
+{
+    snprintf(path, length, "/tmp/cyclicbuffer-benchmark-%d-%s.ring", (int)getpid(), suffix);
+    return path;
+}
+
+// Push and pop 'total' bytes in chunks, flushing the file every 'sync_interval' bytes.
+static void BenchmarkPersistentThroughput(unsigned long long total, size_t sync_interval)
+{
+    char path[128];
+    BenchmarkPath("throughput", path, sizeof(path));
+
+    int s;
+    PersistentCyclicBuffer buffer(path, BUFFER_SIZE, s, true);
+    if(s!=CyclicBuffer::BUFFER_OK)
+    {
+        printf("  PersistentCyclicBuffer could not be created (%d)\n", s);
+        return;
+    }
+    buffer.SetSyncInterval(sync_interval);
+
+    unsigned char in[CHUNK_LENGTH], out[CHUNK_LENGTH];
+    for(size_t i=0; i<CHUNK_LENGTH; i++)
+        in[i] = (unsigned char)i;
+
+    unsigned long long errors = 0;
+    BenchmarkTimer timer;
+    for(unsigned long long position=0; position<total; position+=CHUNK_LENGTH)
+    {
+        buffer.PushN(in, CHUNK_LENGTH);
+        if(buffer.PopN(out, CHUNK_LENGTH)!=CHUNK_LENGTH || out[CHUNK_LENGTH-1]!=in[CHUNK_LENGTH-1])
+            errors++;
+    }
+
+    char name[80];
+    if(sync_interval)
+        snprintf(name, sizeof(name), "PersistentCyclicBuffer msync every %zu KiB", sync_interval >> 10);
+    else
+        snprintf(name, sizeof(name), "PersistentCyclicBuffer without msync");
+    ReportBenchmark(name, total/CHUNK_LENGTH, total, timer);
+    if(errors)
+        ReportFailure("%llu errors", errors);
+
+    unlink(path);
+}
+
+static void BenchmarkMemoryThroughput(unsigned long long total)
+{
+    int s;
+    CyclicBuffer buffer(BUFFER_SIZE, s);
+
+    unsigned char in[CHUNK_LENGTH], out[CHUNK_LENGTH];
+    for(size_t i=0; i<CHUNK_LENGTH; i++)
+        in[i] = (unsigned char)i;
+
+    BenchmarkTimer timer;
+    for(unsigned long long position=0; position<total; position+=CHUNK_LENGTH)
+    {
+        buffer.PushN(in, CHUNK_LENGTH);
+        buffer.PopN(out, CHUNK_LENGTH);
+    }
+    ReportBenchmark("CyclicBuffer in memory", total/CHUNK_LENGTH, total, timer);
+}
+
+// Child process pushes stream byte i = (i & 0xFF), reading part of it, and is killed in the middle.
+// Parent reattaches the file and verifies that unread data continue the stream without gap.
+static void BenchmarkCrashRecovery(void)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    char path[128];
+    BenchmarkPath("crash", path, sizeof(path));
+    unlink(path);
+
+    pid_t child = fork();
+    if(child==0)
+    {
+        int s;
+        PersistentCyclicBuffer buffer(path, 65536, s, true);
+        if(s!=CyclicBuffer::BUFFER_OK)
+            _exit(1);
+
+        unsigned char chunk[CHUNK_LENGTH], out[CHUNK_LENGTH];
+        unsigned long long position = 0;
+        for(;;)
+        {
+            for(size_t i=0; i<CHUNK_LENGTH; i++)
+                chunk[i] = (unsigned char)(position+i);
+            position += buffer.PushN(chunk, CHUNK_LENGTH);
+            // reader keeps behind writer
+            if(buffer.Available() > 32768)
+                buffer.PopN(out, 97);
+        }
+    }
+    if(child<0)
+    {
+        printf("  fork failed, crash test skipped\n");
+        return;
+    }
+
+    usleep(100000);
+    kill(child, SIGKILL);
+    int status;
+    waitpid(child, &status, 0);
+
+    BenchmarkTimer timer;
+    int s;
+    PersistentCyclicBuffer buffer(path, 65536, s);
+    double attach_ns = timer.ElapsedNs();
+    if(s!=CyclicBuffer::BUFFER_OK || !buffer.IsReattached())
+    {
+        printf("  PersistentCyclicBuffer could not be reattached (%d)\n", s);
+        unlink(path);
+        return;
+    }
+
+    // buffer size is multiple of 256, so read index gives low byte of the stream position
+    unsigned char expected = (unsigned char)buffer.GetPopIndex();
+    unsigned long long recovered = 0, errors = 0;
+    unsigned char chunk[CHUNK_LENGTH];
+    size_t n;
+    while((n = buffer.PopN(chunk, CHUNK_LENGTH))!=0)
+    {
+        for(size_t i=0; i<n; i++)
+        {
+            if(chunk[i]!=expected++)
+                errors++;
+        }
+        recovered += n;
+    }
+
+    printf("  crash recovery: reattached in %.0f ns, %llu unread bytes recovered, %llu errors\n", attach_ns, recovered, errors);
+    if(errors)
+        ReportFailure("%llu bytes out of order after crash recovery", errors);
+    unlink(path);
+#endif
+}
+
+static void RunPersistentBenchmarks(void)
+{
+    printf("\n== File-backed persistent buffer (1 MiB, 256 B chunks) ==\n");
+
+    const unsigned long long total = 256ull << 20;
+    BenchmarkMemoryThroughput(total);
+    BenchmarkPersistentThroughput(total, 0);
+    BenchmarkPersistentThroughput(total/16, 1 << 20);
+    BenchmarkPersistentThroughput(total/64, 64 << 10);
+    BenchmarkCrashRecovery();
+}
+
+BENCHMARK_GROUP("persistent", RunPersistentBenchmarks);
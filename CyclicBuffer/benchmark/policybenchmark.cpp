@@ -0,0 +1,135 @@
+#include "benchmark.h"
+#include "cyclicbuffer.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Consumer work per byte, makes the consumer slower than the producer so overflow happens.
+static inline unsigned int ConsumeByte(unsigned int state, unsigned char byte)
+{
+    for(int i=0; i<4; i++)
+        state = state*33u+byte;
+    return state;
+}
+
+// Byte 'offset' of packet number 'sequence', packet starts with its number (little endian).
+static inline unsigned char PacketByte(unsigned long long sequence, unsigned int offset)
+{
+    return offset < 8 ? (unsigned char)(sequence >> (8*offset)) : (unsigned char)(sequence+offset);
+}
+
+// Producer pushes 64 B packets as fast as possible, slower consumer pops 256 B chunks.
+// Buffer with 'BUFFER_BLOCK' policy is synchronized internally, other policies need external mutex.
+static void BenchmarkPolicy(const char * name, CyclicBuffer::buffer_overflow_policy policy, unsigned long long total_bytes)
+{
+    int s;
+    CyclicBuffer buffer(16384, s);
+    if(s!=CyclicBuffer::BUFFER_OK)
+        return;
+    buffer.SetOverflowPolicy(policy, 1000);
+
+    bool external_lock = (policy!=CyclicBuffer::BUFFER_BLOCK);
+    std::mutex mutex;
+    std::atomic<bool> finished(false);
+    unsigned long long accepted = 0, rejected = 0, partial = 0, calls = 0;
+    double max_push_ns = 0.0, total_push_ns = 0.0;
+
+    BenchmarkTimer timer;
+
+    std::thread producer([&]() {
+        unsigned char packet[64];
+
+        for(unsigned long long sent=0; sent<total_bytes; sent+=sizeof(packet))
+        {
+            for(unsigned int i=0; i<sizeof(packet); i++)
+                packet[i] = PacketByte(calls, i);
+
+            BenchmarkTimer push_timer(false);
+            size_t n;
+            if(external_lock)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                n = buffer.PushN(packet, sizeof(packet));
+            }
+            else
+                n = buffer.PushN(packet, sizeof(packet));
+            double ns = push_timer.ElapsedNs();
+
+            total_push_ns += ns;
+            if(ns > max_push_ns)
+                max_push_ns = ns;
+            accepted += n;
+            if(n==0)
+                rejected += sizeof(packet);
+            else if(n!=sizeof(packet))
+                partial++;
+            calls++;
+        }
+        finished.store(true);
+    });
+
+    // every push stores whole packet or nothing, so popped chunks consist of whole packets
+    unsigned char chunk[256];
+    unsigned long long delivered = 0, next_sequence = 0, errors = 0;
+    unsigned int state = 0;
+    for(;;)
+    {
+        bool done = finished.load();
+        size_t n;
+        if(external_lock)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            n = buffer.PopN(chunk, sizeof(chunk));
+        }
+        else
+            n = buffer.PopN(chunk, sizeof(chunk));
+
+        for(size_t i=0; i<n; i++)
+            state = ConsumeByte(state, chunk[i]);
+        delivered += n;
+
+        // packets are never reordered, with 'BUFFER_BLOCK' none of them is lost
+        for(size_t offset=0; offset+64 <= n; offset+=64)
+        {
+            unsigned long long sequence = 0;
+            for(unsigned int i=0; i<8; i++)
+                sequence |= (unsigned long long)chunk[offset+i] << (8*i);
+            bool lost = sequence!=next_sequence;
+            if(sequence < next_sequence || (lost && policy==CyclicBuffer::BUFFER_BLOCK))
+                errors++;
+            for(unsigned int i=8; i<64; i++)
+                errors += chunk[offset+i]!=PacketByte(sequence, i);
+            next_sequence = sequence+1;
+        }
+        errors += n % 64!=0;
+
+        if(!n && done)
+            break;
+    }
+
+    producer.join();
+    double ns = timer.ElapsedNs();
+
+    ReportBenchmark(name, calls, delivered, ns);
+    printf("    push latency avg %.1f ns max %.1f us, accepted %llu B, dropped %llu B, rejected %llu B\n",
+           calls ? total_push_ns/(double)calls : 0.0, max_push_ns/1000.0, accepted, buffer.GetDroppedBytes(), rejected);
+
+    // accepted bytes are either delivered or counted as overwritten
+    if(errors || partial || accepted+rejected!=calls*64 || delivered+buffer.GetDroppedBytes()!=accepted ||
+       (policy==CyclicBuffer::BUFFER_BLOCK && delivered!=calls*64))
+        ReportFailure("%llu packets lost, reordered or corrupted, %llu partial pushes, sent %llu B, delivered %llu B",
+                      errors, partial, calls*64, delivered);
+    benchmark_sink = benchmark_sink + state;
+}
+
+static void RunPolicyBenchmarks(void)
+{
+    printf("\n== Overflow policies, slow consumer (buffer 16 KiB, 64 B packets) ==\n");
+    BenchmarkPolicy("BUFFER_OVERWRITE_OLDEST", CyclicBuffer::BUFFER_OVERWRITE_OLDEST, 64ull<<20);
+    BenchmarkPolicy("BUFFER_REJECT", CyclicBuffer::BUFFER_REJECT, 64ull<<20);
+    BenchmarkPolicy("BUFFER_BLOCK", CyclicBuffer::BUFFER_BLOCK, 64ull<<20);
+}
+
+BENCHMARK_GROUP("policy", RunPolicyBenchmarks);
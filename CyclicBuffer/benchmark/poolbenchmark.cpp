@@ -0,0 +1,153 @@
+#include "benchmark.h"
+#include "cyclicbuffer.h"
+#include "cyclicbufferpool.h"
+
+#include <cstdio>
+#include <vector>
+
+static const unsigned int POOL_RINGS = 512;
+static const unsigned int POOL_RING_SIZE = 64u << 10;
+static const unsigned int POOL_CHUNK = 256;
+
+static const char * PageModeName(CyclicBufferPool::pool_page_mode mode)
+{
+    switch(mode)
+    {
+    case CyclicBufferPool::POOL_TRANSPARENT_HUGE_PAGES: return "THP";
+    case CyclicBufferPool::POOL_EXPLICIT_HUGE_PAGES: return "explicit huge pages";
+    default: return "normal pages";
+    }
+}
+
+// All rings are created and destroyed at once, as when a sensor group is reconfigured.
+static void BenchmarkCreate(void)
+{
+    const unsigned int rounds = 50;
+    std::vector<CyclicBuffer*> rings(POOL_RINGS);
+    int s;
+
+    BenchmarkTimer heap_timer;
+    for(unsigned int r=0; r<rounds; r++)
+    {
+        for(unsigned int i=0; i<POOL_RINGS; i++)
+            rings[i] = new CyclicBuffer(POOL_RING_SIZE, s);
+        for(unsigned int i=0; i<POOL_RINGS; i++)
+            delete rings[i];
+    }
+    ReportBenchmark("512 rings new/delete", (unsigned long long)rounds*POOL_RINGS, 0, heap_timer);
+
+    CyclicBufferPool pool((size_t)POOL_RINGS*POOL_RING_SIZE, CyclicBufferPool::POOL_TRANSPARENT_HUGE_PAGES, s);
+    if(s!=CyclicBuffer::BUFFER_OK)
+        return;
+
+    unsigned long long errors = 0;
+    BenchmarkTimer pool_timer;
+    for(unsigned int r=0; r<rounds; r++)
+    {
+        for(unsigned int i=0; i<POOL_RINGS; i++)
+            errors += (rings[i] = pool.Acquire(POOL_RING_SIZE, s))==NULL;
+        for(unsigned int i=0; i<POOL_RINGS; i++)
+            pool.Release(rings[i]);
+    }
+    ReportBenchmark("512 rings pool Acquire/Release", (unsigned long long)rounds*POOL_RINGS, 0, pool_timer);
+
+    // every round after the first one recycles blocks, arena must not grow
+    if(pool.GetRemainingBytes()!=0 || pool.GetBufferCount()!=0)
+        errors++;
+    if(errors)
+        ReportFailure("%llu errors", errors);
+}
+
+// Sensors deliver small packets in turn, so every push and pop lands in a different ring.
+static void RoundRobinTraffic(const char * name, std::vector<CyclicBuffer*> &rings)
+{
+    const unsigned int rounds = 2*POOL_RING_SIZE/POOL_CHUNK;
+    unsigned char data[POOL_CHUNK], out[POOL_CHUNK];
+    unsigned long long errors = 0;
+
+    // page faults (and zeroing of huge pages) are not measured
+    std::vector<unsigned char> warm(POOL_RING_SIZE);
+    for(unsigned int i=0; i<POOL_RINGS; i++)
+    {
+        rings[i]->PushN(&warm[0], POOL_RING_SIZE);
+        rings[i]->PopN(&warm[0], POOL_RING_SIZE);
+    }
+
+    BenchmarkTimer timer;
+    for(unsigned int r=0; r<rounds; r++)
+    {
+        for(unsigned int i=0; i<POOL_RINGS; i++)
+        {
+            data[0] = data[POOL_CHUNK-1] = (unsigned char)(i+r);
+            rings[i]->PushN(data, POOL_CHUNK);
+        }
+        for(unsigned int i=0; i<POOL_RINGS; i++)
+        {
+            rings[i]->PopN(out, POOL_CHUNK);
+            errors += out[0]!=(unsigned char)(i+r) || out[POOL_CHUNK-1]!=(unsigned char)(i+r);
+        }
+    }
+    ReportBenchmark(name, 2ull*rounds*POOL_RINGS, 2ull*rounds*POOL_RINGS*POOL_CHUNK, timer);
+    if(errors)
+        ReportFailure("%llu errors", errors);
+}
+
+static void BenchmarkPoolTraffic(CyclicBufferPool::pool_page_mode mode, bool bind)
+{
+    int s;
+    CyclicBufferPool pool((size_t)POOL_RINGS*POOL_RING_SIZE, mode, s);
+    if(s!=CyclicBuffer::BUFFER_OK)
+        return;
+
+    std::vector<CyclicBuffer*> rings(POOL_RINGS);
+    int node = bind ? CyclicBufferPool::CurrentNumaNode() : -1;
+    for(unsigned int i=0; i<POOL_RINGS; i++)
+    {
+        rings[i] = pool.Acquire(POOL_RING_SIZE, s, node);
+        if(rings[i]==NULL)
+        {
+            ReportFailure("pool exhausted");
+            return;
+        }
+    }
+
+    // pool falls back to other pages if requested ones are not available
+    char name[96];
+    if(pool.GetPageMode()==mode)
+        snprintf(name, sizeof(name), "512 rings pool, %s%s", PageModeName(mode), bind ? ", node" : "");
+    else
+        snprintf(name, sizeof(name), "512 rings pool, %s -> %s%s", PageModeName(mode), PageModeName(pool.GetPageMode()), bind ? ", node" : "");
+    RoundRobinTraffic(name, rings);
+    if(bind && pool.GetBindFailures())
+        printf("    NUMA binding not available (%llu failures)\n", pool.GetBindFailures());
+
+    for(unsigned int i=0; i<POOL_RINGS; i++)
+        pool.Release(rings[i]);
+}
+
+static void BenchmarkHeapTraffic(void)
+{
+    int s;
+    std::vector<CyclicBuffer*> rings(POOL_RINGS);
+    for(unsigned int i=0; i<POOL_RINGS; i++)
+        rings[i] = new CyclicBuffer(POOL_RING_SIZE, s);
+
+    RoundRobinTraffic("512 rings heap", rings);
+
+    for(unsigned int i=0; i<POOL_RINGS; i++)
+        delete rings[i];
+}
+
+static void RunPoolBenchmarks(void)
+{
+    printf("\n== Buffer pool, 512 rings of 64 KiB ==\n");
+
+    BenchmarkCreate();
+    BenchmarkHeapTraffic();
+    BenchmarkPoolTraffic(CyclicBufferPool::POOL_NORMAL_PAGES, false);
+    BenchmarkPoolTraffic(CyclicBufferPool::POOL_TRANSPARENT_HUGE_PAGES, false);
+    BenchmarkPoolTraffic(CyclicBufferPool::POOL_EXPLICIT_HUGE_PAGES, false);
+    BenchmarkPoolTraffic(CyclicBufferPool::POOL_TRANSPARENT_HUGE_PAGES, true);
+}
+
+BENCHMARK_GROUP("pool", RunPoolBenchmarks);
@@ -0,0 +1,164 @@
+#include "benchmark.h"
+#include "cyclicbuffer.h"
+#include "recordcyclicbuffer.h"
+
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+static const unsigned int MAX_PACKET_LENGTH = 16+511;
+static const unsigned int BATCH_RECORDS = 32;
+
+// Packet length depends on the number of targets seen by radar, here pseudo-random 16..527 bytes.
+static inline unsigned int PacketLength(unsigned int sequence)
+{
+    return 16+((sequence*2654435761u) >> 23);
+}
+
+// Packet starts with its sequence number, the rest is filled by its low byte.
+static void FillPacket(unsigned char * packet, unsigned int sequence, unsigned int length)
+{
+    memset(packet, (unsigned char)sequence, length);
+    memcpy(packet, &sequence, sizeof(sequence));
+}
+
+static inline bool CheckPacket(const unsigned char * packet, unsigned int length, unsigned int sequence)
+{
+    unsigned int stored;
+    memcpy(&stored, packet, sizeof(stored));
+    return length==PacketLength(sequence) && stored==sequence && packet[length-1]==(unsigned char)sequence;
+}
+
+// Packets stored in byte buffer with 2-byte length prefix, consumer copies them out one by one.
+static void BenchmarkBytePackets(unsigned int packets)
+{
+    int s;
+    CyclicBuffer buffer(1 << 16, s);
+    buffer.SetOverflowPolicy(CyclicBuffer::BUFFER_REJECT);
+
+    unsigned char packet[MAX_PACKET_LENGTH], out[MAX_PACKET_LENGTH];
+    unsigned long long errors = 0, bytes = 0;
+
+    BenchmarkTimer timer;
+    for(unsigned int sequence=0; sequence<packets; sequence++)
+    {
+        unsigned int length = PacketLength(sequence);
+        FillPacket(packet, sequence, length);
+        unsigned char prefix[2] = { (unsigned char)length, (unsigned char)(length >> 8) };
+        buffer.PushN(prefix, 2);
+        buffer.PushN(packet, length);
+
+        buffer.PopN(prefix, 2);
+        unsigned int popped = prefix[0] | (prefix[1] << 8);
+        buffer.PopN(out, popped);
+        errors += !CheckPacket(out, popped, sequence);
+        bytes += length;
+    }
+    ReportBenchmark("CyclicBuffer length-prefixed packets", packets, bytes, timer);
+    if(errors)
+        ReportFailure("%llu errors", errors);
+}
+
+// Records pushed one by one and consumed either by copy, in place, or in batches.
+static void BenchmarkRecords(const char * name, unsigned int packets, int mode)
+{
+    int s;
+    RecordCyclicBuffer buffer(1 << 16, s);
+
+    unsigned char packet[MAX_PACKET_LENGTH], out[MAX_PACKET_LENGTH];
+    RecordCyclicBuffer::record_view views[BATCH_RECORDS];
+    unsigned long long errors = 0, bytes = 0;
+    unsigned int expected = 0;
+
+    BenchmarkTimer timer;
+    for(unsigned int sequence=0; sequence<packets; sequence++)
+    {
+        unsigned int length = PacketLength(sequence);
+        FillPacket(packet, sequence, length);
+        if(buffer.PushRecord(packet, length)!=CyclicBuffer::BUFFER_OK)
+            errors++;
+        bytes += length;
+
+        if(mode==0)
+        {
+            unsigned int popped;
+            if(!buffer.PopRecord(out, sizeof(out), popped))
+                errors++;
+            errors += !CheckPacket(out, popped, expected++);
+        }
+        else if(mode==1)
+        {
+            RecordCyclicBuffer::record_view record;
+            if(!buffer.PeekRecord(record))
+                errors++;
+            errors += !CheckPacket(record.data, record.length, expected++);
+            buffer.ConsumeRecord();
+        }
+        else if((sequence % BATCH_RECORDS)==BATCH_RECORDS-1)
+        {
+            unsigned int count = buffer.PeekRecords(views, BATCH_RECORDS);
+            for(unsigned int i=0; i<count; i++)
+                errors += !CheckPacket(views[i].data, views[i].length, expected++);
+            buffer.ConsumeRecords(count);
+        }
+    }
+    ReportBenchmark(name, packets, bytes, timer);
+    if(errors || (mode!=2 && expected!=packets))
+        ReportFailure("%llu errors", errors);
+}
+
+// Producer thread pushes records, consumer thread dequeues them in batches and verifies the sequence.
+static void BenchmarkRecordsCrossThread(unsigned int packets)
+{
+    int s;
+    RecordCyclicBuffer buffer(1 << 16, s);
+    unsigned long long errors = 0, bytes = 0;
+
+    BenchmarkTimer timer;
+
+    std::thread consumer([&]() {
+        RecordCyclicBuffer::record_view views[BATCH_RECORDS];
+        unsigned int expected = 0;
+        while(expected < packets)
+        {
+            unsigned int count = buffer.PeekRecords(views, BATCH_RECORDS);
+            if(!count)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            for(unsigned int i=0; i<count; i++)
+                errors += !CheckPacket(views[i].data, views[i].length, expected++);
+            buffer.ConsumeRecords(count);
+        }
+    });
+
+    unsigned char packet[MAX_PACKET_LENGTH];
+    for(unsigned int sequence=0; sequence<packets; sequence++)
+    {
+        unsigned int length = PacketLength(sequence);
+        FillPacket(packet, sequence, length);
+        while(buffer.PushRecord(packet, length)!=CyclicBuffer::BUFFER_OK)
+            std::this_thread::yield();
+        bytes += length;
+    }
+
+    consumer.join();
+    ReportBenchmark("RecordCyclicBuffer cross-thread, batches of 32", packets, bytes, timer);
+    if(errors)
+        ReportFailure("%llu errors", errors);
+}
+
+static void RunRecordBenchmarks(void)
+{
+    printf("\n== Variable-length packets, 16 to 527 B (buffer 64 KiB, every packet verified) ==\n");
+
+    const unsigned int packets = 4000000;
+    BenchmarkBytePackets(packets);
+    BenchmarkRecords("RecordCyclicBuffer PushRecord + PopRecord", packets, 0);
+    BenchmarkRecords("RecordCyclicBuffer PushRecord + PeekRecord", packets, 1);
+    BenchmarkRecords("RecordCyclicBuffer PushRecord + PeekRecords(32)", packets, 2);
+    BenchmarkRecordsCrossThread(packets);
+}
+
+BENCHMARK_GROUP("record", RunRecordBenchmarks);
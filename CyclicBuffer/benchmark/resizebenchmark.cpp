@@ -0,0 +1,141 @@
+#include "benchmark.h"
+#include "cyclicbuffer.h"
+#include "spsccyclicbuffer.h"
+
+#include <atomic>
+#include <thread>
+
+static const size_t CHUNK_LENGTH = 1024;
+
+// Producer resizes the buffer every 'resize_period' bytes, cycling sizes from 4 KiB to 1 MiB.
+// Consumer verifies that stream byte at position i is (i & 0xFF).
+static void BenchmarkSpscResize(unsigned long long total, unsigned long long resize_period)
+{
+    int s;
+    SpscCyclicBuffer buffer(65536, s);
+
+    unsigned long long errors = 0;
+    BenchmarkTimer timer;
+
+    std::thread consumer([&]() {
+        unsigned char chunk[CHUNK_LENGTH];
+        unsigned long long position = 0;
+        while(position < total)
+        {
+            size_t n = buffer.PopN(chunk, CHUNK_LENGTH);
+            if(!n)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            for(size_t i=0; i<n; i++)
+            {
+                if(chunk[i]!=(unsigned char)(position+i))
+                    errors++;
+            }
+            position += n;
+        }
+    });
+
+    unsigned char chunk[CHUNK_LENGTH];
+    unsigned long long next_resize = resize_period, resizes = 0;
+    double resize_ns = 0.0;
+    unsigned int size = 4096;
+
+    for(unsigned long long position=0; position<total; position+=CHUNK_LENGTH)
+    {
+        for(size_t i=0; i<CHUNK_LENGTH; i++)
+            chunk[i] = (unsigned char)(position+i);
+
+        size_t written = 0;
+        while(written < CHUNK_LENGTH)
+        {
+            size_t n = buffer.PushN(chunk+written, CHUNK_LENGTH-written);
+            if(!n)
+                std::this_thread::yield();
+            written += n;
+        }
+
+        if(position >= next_resize)
+        {
+            BenchmarkTimer resize_timer(false);
+            if(buffer.Resize(size)!=CyclicBuffer::BUFFER_OK)
+                errors++;
+            resize_ns += resize_timer.ElapsedNs();
+            resizes++;
+
+            size = size >= (1u << 20) ? 4096 : size*4;
+            next_resize += resize_period;
+        }
+    }
+
+    consumer.join();
+
+    char name[80];
+    if(resizes)
+    {
+        snprintf(name, sizeof(name), "SpscCyclicBuffer resize every %llu KiB", resize_period >> 10);
+        ReportBenchmark(name, total/CHUNK_LENGTH, total, timer);
+        printf("    %llu resizes, producer spent %.0f ns per Resize call\n", resizes, resize_ns/(double)resizes);
+    }
+    else
+        ReportBenchmark("SpscCyclicBuffer without resize", total/CHUNK_LENGTH, total, timer);
+    if(errors)
+        ReportFailure("%llu bytes out of order or failed resizes", errors);
+}
+
+// Wrapped unread data must survive growing and shrinking of CyclicBuffer in order.
+static void BenchmarkReallocBuffer(unsigned int iterations)
+{
+    int s;
+    CyclicBuffer buffer(4096, s);
+    buffer.SetOverflowPolicy(CyclicBuffer::BUFFER_REJECT);
+
+    unsigned char chunk[8192];
+    unsigned long long written = 0, read = 0, errors = 0;
+
+    BenchmarkTimer timer;
+    for(unsigned int i=0; i<iterations; i++)
+    {
+        // make the unread data wrap at the top border
+        while(buffer.FreeSpace() > 0)
+        {
+            size_t n = buffer.FreeSpace() < sizeof(chunk) ? buffer.FreeSpace() : sizeof(chunk);
+            for(size_t j=0; j<n; j++)
+                chunk[j] = (unsigned char)(written+j);
+            written += buffer.PushN(chunk, n);
+        }
+
+        // pop so that unread data fit into the smaller size, verify order across reallocation
+        for(int step=0; step<2; step++)
+        {
+            size_t n = buffer.PopN(chunk, step ? sizeof(chunk) : buffer.Available()-1000);
+            for(size_t j=0; j<n; j++)
+            {
+                if(chunk[j]!=(unsigned char)(read+j))
+                    errors++;
+            }
+            read += n;
+
+            if(!step && buffer.ReallocBuffer((i & 1) ? 4096 : 8192)!=CyclicBuffer::BUFFER_OK)
+                errors++;
+        }
+    }
+
+    ReportBenchmark("CyclicBuffer ReallocBuffer 4<->8 KiB, wrapped", iterations, (unsigned long long)iterations*4096, timer);
+    if(errors)
+        ReportFailure("%llu bytes out of order or failed reallocations", errors);
+}
+
+static void RunResizeBenchmarks(void)
+{
+    printf("\n== Resizing under load, 1 KiB chunks (every byte verified) ==\n");
+
+    const unsigned long long total = 256ull << 20;
+    BenchmarkSpscResize(total, total*2);
+    BenchmarkSpscResize(total, 1ull << 20);
+    BenchmarkSpscResize(total, 64ull << 10);
+    BenchmarkReallocBuffer(20000);
+}
+
+BENCHMARK_GROUP("resize", RunResizeBenchmarks);
@@ -0,0 +1,266 @@
+#include "benchmark.h"
+#include "sharedcyclicbuffer.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <cstdio>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+
+static const size_t CHUNK_LENGTH = 4096;
+static const unsigned int BUFFER_SIZE = 1 << 20;
+
+// Value of byte at given stream position (see 'spscbenchmark.cpp').
+static inline unsigned char StreamByte(unsigned long long position)
+{
+    return (unsigned char)((position*131u)^(position>>8));
+}
+
+static void SharedName(const char * suffix, char * name, size_t length)
+{
+    snprintf(name, length, "/cyclicbuffer-benchmark-%d-%s", (int)getpid(), suffix);
+}
+
+// Waits for child process, returns true if it exited with status 0.
+static bool ChildSucceeded(pid_t child)
+{
+    int status;
+    if(waitpid(child, &status, 0)!=child)
+        return false;
+    return WIFEXITED(status) && WEXITSTATUS(status)==0;
+}
+
+// Parent process pushes 'total' bytes, child process attaches by name and verifies them in place.
+static void BenchmarkSharedThroughput(unsigned long long total)
+{
+    char name[128];
+    SharedName("throughput", name, sizeof(name));
+
+    int s;
+    SharedCyclicBuffer buffer(name, BUFFER_SIZE, SharedCyclicBuffer::SHARED_CREATE, s);
+    if(s!=CyclicBuffer::BUFFER_OK)
+    {
+        printf("  SharedCyclicBuffer could not be created (%d)\n", s);
+        return;
+    }
+
+    BenchmarkTimer timer;
+
+    pid_t child = fork();
+    if(child==0)
+    {
+        SharedCyclicBuffer consumer(name, 0, SharedCyclicBuffer::SHARED_ATTACH, s);
+        if(s!=CyclicBuffer::BUFFER_OK)
+            _exit(2);
+
+        unsigned long long position = 0, errors = 0;
+        while(position < total)
+        {
+            consumer.WaitForData();
+            CyclicBuffer::buffer_segments segments;
+            size_t n = consumer.PeekRead(segments);
+            for(size_t i=0; i<segments.first_length; i++)
+                errors += segments.first[i]!=StreamByte(position+i);
+            for(size_t i=0; i<segments.second_length; i++)
+                errors += segments.second[i]!=StreamByte(position+segments.first_length+i);
+            consumer.ConsumeRead(n);
+            position += n;
+        }
+        _exit(errors ? 1 : 0);
+    }
+    if(child<0)
+    {
+        printf("  fork failed, shared memory benchmark skipped\n");
+        return;
+    }
+
+    unsigned char chunk[CHUNK_LENGTH];
+    for(unsigned long long position=0; position<total; position+=CHUNK_LENGTH)
+    {
+        for(size_t i=0; i<CHUNK_LENGTH; i++)
+            chunk[i] = StreamByte(position+i);
+
+        size_t written = 0;
+        while(written < CHUNK_LENGTH)
+        {
+            size_t n = buffer.PushN(chunk+written, CHUNK_LENGTH-written);
+            if(!n)
+                std::this_thread::yield();
+            written += n;
+        }
+    }
+
+    bool verified = ChildSucceeded(child);
+    ReportBenchmark("SharedCyclicBuffer between processes", total/CHUNK_LENGTH, total, timer);
+    if(!verified)
+        ReportFailure("consumer process reported errors");
+}
+
+// Same stream sent through a pipe, as used before shared memory buffer.
+static void BenchmarkPipeThroughput(unsigned long long total)
+{
+    int fds[2];
+    if(pipe(fds)!=0)
+        return;
+
+    BenchmarkTimer timer;
+
+    pid_t child = fork();
+    if(child==0)
+    {
+        close(fds[1]);
+        unsigned char chunk[CHUNK_LENGTH];
+        unsigned long long position = 0, errors = 0;
+        while(position < total)
+        {
+            ssize_t n = read(fds[0], chunk, CHUNK_LENGTH);
+            if(n<=0)
+                _exit(2);
+            for(ssize_t i=0; i<n; i++)
+                errors += chunk[i]!=StreamByte(position+i);
+            position += n;
+        }
+        _exit(errors ? 1 : 0);
+    }
+    close(fds[0]);
+
+    unsigned char chunk[CHUNK_LENGTH];
+    for(unsigned long long position=0; position<total; position+=CHUNK_LENGTH)
+    {
+        for(size_t i=0; i<CHUNK_LENGTH; i++)
+            chunk[i] = StreamByte(position+i);
+        size_t written = 0;
+        while(written < CHUNK_LENGTH)
+        {
+            ssize_t n = write(fds[1], chunk+written, CHUNK_LENGTH-written);
+            if(n<=0)
+                break;
+            written += n;
+        }
+    }
+    close(fds[1]);
+
+    bool verified = child>0 && ChildSucceeded(child);
+    ReportBenchmark("pipe between processes", total/CHUNK_LENGTH, total, timer);
+    if(!verified)
+        ReportFailure("consumer process reported errors");
+}
+
+// One byte travels to the child through one ring and back through the other, both sides sleep in 'WaitForData'.
+static void BenchmarkSharedLatency(unsigned long long round_trips)
+{
+    char ping_name[128], pong_name[128];
+    SharedName("ping", ping_name, sizeof(ping_name));
+    SharedName("pong", pong_name, sizeof(pong_name));
+
+    int s1, s2;
+    SharedCyclicBuffer ping(ping_name, 4096, SharedCyclicBuffer::SHARED_CREATE, s1);
+    SharedCyclicBuffer pong(pong_name, 4096, SharedCyclicBuffer::SHARED_CREATE, s2);
+    if(s1!=CyclicBuffer::BUFFER_OK || s2!=CyclicBuffer::BUFFER_OK)
+    {
+        printf("  SharedCyclicBuffer could not be created\n");
+        return;
+    }
+
+    pid_t child = fork();
+    if(child==0)
+    {
+        SharedCyclicBuffer in(ping_name, 0, SharedCyclicBuffer::SHARED_ATTACH, s1);
+        SharedCyclicBuffer out(pong_name, 0, SharedCyclicBuffer::SHARED_ATTACH, s2);
+        if(s1!=CyclicBuffer::BUFFER_OK || s2!=CyclicBuffer::BUFFER_OK)
+            _exit(2);
+
+        unsigned char ch;
+        for(unsigned long long i=0; i<round_trips; i++)
+        {
+            in.WaitForData();
+            in.Pop(ch);
+            out.Push(ch);
+        }
+        _exit(0);
+    }
+    if(child<0)
+        return;
+
+    unsigned long long errors = 0;
+    BenchmarkTimer timer;
+    for(unsigned long long i=0; i<round_trips; i++)
+    {
+        unsigned char ch = (unsigned char)i;
+        ping.Push(ch);
+        pong.WaitForData();
+        pong.Pop(ch);
+        errors += ch!=(unsigned char)i;
+    }
+    double ns = timer.ElapsedNs();
+
+    bool verified = ChildSucceeded(child) && !errors;
+    ReportBenchmark("SharedCyclicBuffer round trip", round_trips, round_trips, timer);
+    printf("    one-way latency %.0f ns\n", ns/(double)round_trips/2.0);
+    if(!verified)
+        ReportFailure("round trip errors");
+}
+
+static void BenchmarkPipeLatency(unsigned long long round_trips)
+{
+    int ping[2], pong[2];
+    if(pipe(ping)!=0 || pipe(pong)!=0)
+        return;
+
+    pid_t child = fork();
+    if(child==0)
+    {
+        unsigned char ch;
+        for(unsigned long long i=0; i<round_trips; i++)
+        {
+            if(read(ping[0], &ch, 1)!=1 || write(pong[1], &ch, 1)!=1)
+                _exit(2);
+        }
+        _exit(0);
+    }
+    if(child<0)
+        return;
+
+    unsigned long long errors = 0;
+    BenchmarkTimer timer;
+    for(unsigned long long i=0; i<round_trips; i++)
+    {
+        unsigned char ch = (unsigned char)i;
+        if(write(ping[1], &ch, 1)!=1 || read(pong[0], &ch, 1)!=1)
+            errors++;
+        errors += ch!=(unsigned char)i;
+    }
+    double ns = timer.ElapsedNs();
+
+    bool verified = ChildSucceeded(child) && !errors;
+    ReportBenchmark("pipe round trip", round_trips, round_trips, timer);
+    printf("    one-way latency %.0f ns\n", ns/(double)round_trips/2.0);
+    if(!verified)
+        ReportFailure("round trip errors");
+
+    close(ping[0]); close(ping[1]);
+    close(pong[0]); close(pong[1]);
+}
+
+#endif
+
+static void RunSharedBenchmarks(void)
+{
+    printf("\n== Shared memory between processes vs. pipe (buffer 1 MiB, every byte verified) ==\n");
+
+#if defined(__unix__) || defined(__APPLE__)
+    const unsigned long long total = 1ull << 30;
+    BenchmarkSharedThroughput(total);
+    BenchmarkPipeThroughput(total);
+    BenchmarkSharedLatency(100000);
+    BenchmarkPipeLatency(100000);
+#else
+    printf("  shared memory benchmarks require POSIX system\n");
+#endif
+}
+
+BENCHMARK_GROUP("shared", RunSharedBenchmarks);
@@ -0,0 +1,125 @@
+#include "benchmark.h"
+#include "cyclicbuffer.h"
+#include "spsccyclicbuffer.h"
+
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Value of byte at given stream position. Neighbouring bytes differ and pattern
+// does not repeat with buffer size period, so lost or reordered bytes are detected.
+static inline unsigned char StreamByte(unsigned long long position)
+{
+    return (unsigned char)((position*131u)^(position>>8));
+}
+
+// Mutex protected CyclicBuffer as used by deployments without lock-free buffer.
+class LockedCyclicBuffer
+{
+
+public:
+
+    LockedCyclicBuffer(unsigned int buf_size, int &success) : buffer(buf_size, success)
+    {
+        buffer.SetOverflowPolicy(CyclicBuffer::BUFFER_REJECT);
+    }
+
+    size_t PushN(const unsigned char * data, size_t length)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return buffer.PushN(data, length);
+    }
+
+    size_t PopN(unsigned char * data, size_t length)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return buffer.PopN(data, length);
+    }
+
+private:
+
+    std::mutex mutex;
+    CyclicBuffer buffer;
+
+};
+
+// Producer pushes 'total' bytes in chunks of 'chunk' bytes, consumer verifies every byte.
+template <class Buffer>
+static void BenchmarkCrossThread(const char * name, Buffer &buffer, size_t chunk, unsigned long long total)
+{
+    unsigned long long errors = 0;
+
+    BenchmarkTimer timer;
+
+    std::thread producer([&]() {
+        std::vector<unsigned char> data(chunk);
+        unsigned long long position = 0;
+        while(position < total)
+        {
+            size_t length = chunk;
+            if(length > total-position)
+                length = (size_t)(total-position);
+            for(size_t i=0; i<length; i++)
+                data[i] = StreamByte(position+i);
+
+            size_t done = 0;
+            while(done < length)
+            {
+                size_t n = buffer.PushN(&data[done], length-done);
+                if(!n)
+                    std::this_thread::yield();
+                done += n;
+            }
+            position += length;
+        }
+    });
+
+    std::vector<unsigned char> data(chunk);
+    unsigned long long position = 0;
+    while(position < total)
+    {
+        size_t n = buffer.PopN(&data[0], chunk);
+        if(!n)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        for(size_t i=0; i<n; i++)
+        {
+            if(data[i]!=StreamByte(position+i))
+                errors++;
+        }
+        position += n;
+    }
+
+    producer.join();
+    double ns = timer.ElapsedNs();
+
+    char line[96];
+    snprintf(line, sizeof(line), "%s chunk=%u", name, (unsigned int)chunk);
+    ReportBenchmark(line, total, total, ns);
+    if(errors)
+        ReportFailure("%llu bytes lost or reordered", errors);
+}
+
+static void RunSpscBenchmarks(void)
+{
+    printf("\n== Cross-thread throughput (buffer 64 KiB, every byte verified) ==\n");
+
+    const unsigned long long total = 256ull<<20;
+    const size_t chunks[] = { 1, 64, 1024 };
+
+    for(unsigned int i=0; i<sizeof(chunks)/sizeof(chunks[0]); i++)
+    {
+        int s;
+        LockedCyclicBuffer locked(65536, s);
+        if(s==CyclicBuffer::BUFFER_OK)
+            BenchmarkCrossThread("mutex CyclicBuffer", locked, chunks[i], chunks[i]==1 ? total/16 : total);
+
+        SpscCyclicBuffer spsc(65536, s);
+        if(s==CyclicBuffer::BUFFER_OK)
+            BenchmarkCrossThread("SpscCyclicBuffer", spsc, chunks[i], chunks[i]==1 ? total/16 : total);
+    }
+}
+
+BENCHMARK_GROUP("spsc", RunSpscBenchmarks);
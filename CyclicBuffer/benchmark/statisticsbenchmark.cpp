@@ -0,0 +1,132 @@
+#include "benchmark.h"
+#include "bufferstatistics.h"
+#include "cyclicbuffer.h"
+
+#include <atomic>
+#include <thread>
+
+// Cost of hooks alone, as they run inside buffer operations.
+static void BenchmarkHooks(unsigned int operations)
+{
+    BufferStatistics statistics;
+
+    BenchmarkTimer timer;
+    for(unsigned int i=0; i<operations; i++)
+    {
+        statistics.RecordPush(64, 64);
+        statistics.RecordPop(64);
+    }
+    double ns = timer.ElapsedNs();
+
+    BufferStatistics::statistics_snapshot snapshot;
+    statistics.Snapshot(snapshot);
+    benchmark_sink = (unsigned int)snapshot.latency_samples;
+
+    ReportBenchmark("BufferStatistics push+pop hooks, 64 B", operations, (unsigned long long)operations*64, ns);
+}
+
+#if defined(CYCLICBUFFER_STATISTICS)
+static void PrintSnapshot(const BufferStatistics::statistics_snapshot &snapshot)
+{
+    printf("    pushed %llu B, popped %llu B, overwritten %llu B, rejected %llu B, empty pops %llu, peak %u B\n",
+           snapshot.pushed_bytes, snapshot.popped_bytes, snapshot.overwritten_bytes, snapshot.rejected_bytes,
+           snapshot.empty_pops, snapshot.peak_occupancy);
+    printf("    latency samples %llu: p50 %llu ns, p99 %llu ns, p99.9 %llu ns, max %llu ns\n", snapshot.latency_samples,
+           BufferStatistics::LatencyPercentile(snapshot, 50.0), BufferStatistics::LatencyPercentile(snapshot, 99.0),
+           BufferStatistics::LatencyPercentile(snapshot, 99.9), BufferStatistics::LatencyPercentile(snapshot, 100.0));
+}
+#endif
+
+// Producer and consumer threads with blocking policy, monitoring thread exports snapshots meanwhile.
+static void BenchmarkThreads(unsigned long long total)
+{
+    int s;
+    CyclicBuffer buffer(16384, s);
+    buffer.SetOverflowPolicy(CyclicBuffer::BUFFER_BLOCK);
+
+    std::atomic<bool> done(false);
+    unsigned long long snapshots = 0;
+
+    BenchmarkTimer timer;
+
+    std::thread consumer([&]() {
+        unsigned char chunk[256];
+        unsigned long long received = 0;
+        while(received < total)
+        {
+            size_t n = buffer.PopN(chunk, sizeof(chunk));
+            if(!n)
+                std::this_thread::yield();
+            received += n;
+        }
+    });
+
+    std::thread monitor([&]() {
+        while(!done.load())
+        {
+#if defined(CYCLICBUFFER_STATISTICS)
+            BufferStatistics::statistics_snapshot snapshot;
+            buffer.GetStatistics(snapshot);
+#endif
+            snapshots++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    unsigned char chunk[256] = {0};
+    for(unsigned long long position=0; position<total; position+=sizeof(chunk))
+        buffer.PushN(chunk, sizeof(chunk));
+
+    consumer.join();
+    double ns = timer.ElapsedNs();
+    done = true;
+    monitor.join();
+
+    ReportBenchmark("CyclicBuffer BUFFER_BLOCK, 2 threads", total/sizeof(chunk), total, ns);
+#if defined(CYCLICBUFFER_STATISTICS)
+    BufferStatistics::statistics_snapshot snapshot;
+    buffer.GetStatistics(snapshot);
+    PrintSnapshot(snapshot);
+    printf("    %llu snapshots exported during the run\n", snapshots);
+#endif
+}
+
+// Overwrite policy with slow consumer, statistics show lost data and dwell time.
+static void BenchmarkOverwrite(unsigned int rounds)
+{
+    int s;
+    CyclicBuffer buffer(4096, s);
+
+    unsigned char chunk[512] = {0};
+    BenchmarkTimer timer;
+    for(unsigned int i=0; i<rounds; i++)
+    {
+        buffer.PushN(chunk, sizeof(chunk));
+        buffer.PushN(chunk, sizeof(chunk));
+        buffer.PopN(chunk, sizeof(chunk));
+        if(!(i & 15))
+            while(buffer.PopN(chunk, sizeof(chunk))) {}
+    }
+    ReportBenchmark("CyclicBuffer overwrite, slow consumer", rounds, (unsigned long long)rounds*2*sizeof(chunk), timer);
+
+#if defined(CYCLICBUFFER_STATISTICS)
+    BufferStatistics::statistics_snapshot snapshot;
+    buffer.GetStatistics(snapshot);
+    PrintSnapshot(snapshot);
+#endif
+}
+
+static void RunStatisticsBenchmarks(void)
+{
+#if defined(CYCLICBUFFER_STATISTICS)
+    printf("\n== Traffic statistics (CYCLICBUFFER_STATISTICS enabled) ==\n");
+#else
+    printf("\n== Traffic statistics (disabled, build with DEFINES += CYCLICBUFFER_STATISTICS to compare) ==\n");
+#endif
+
+    BenchmarkHooks(10000000);
+    BenchmarkThreads(256ull << 20);
+    BenchmarkOverwrite(1000000);
+}
+
+BENCHMARK_GROUP("statistics", RunStatisticsBenchmarks);
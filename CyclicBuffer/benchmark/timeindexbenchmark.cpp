@@ -0,0 +1,119 @@
+#include "benchmark.h"
+#include "cyclicbuffer.h"
+#include "timeindexedbuffer.h"
+
+#include <cstdio>
+#include <cstring>
+
+static const size_t PACKET_LENGTH = 96;
+
+// Packet carries its timestamp in the first 8 bytes (the way deployments decode it today).
+static void FillPacket(unsigned char * packet, unsigned long long timestamp)
+{
+    memset(packet, (unsigned char)timestamp, PACKET_LENGTH);
+    memcpy(packet, &timestamp, sizeof(timestamp));
+}
+
+// Stream position of the first packet not older than 'timestamp', found by walking packets
+// from the read pointer and decoding their time field.
+static unsigned long long LinearSeek(CyclicBuffer &buffer, unsigned long long timestamp)
+{
+    unsigned int count = buffer.Available()/PACKET_LENGTH;
+    unsigned int size = buffer.GetBufferSize();
+    unsigned int start = buffer.GetPopIndex()-buffer.GetBottomIndex();
+    for(unsigned int i=0; i<count; i++)
+    {
+        unsigned long long stamp = 0;
+        for(unsigned int b=0; b<sizeof(stamp); b++)
+            stamp |= (unsigned long long)buffer.GetValueAt((unsigned int)((start+i*PACKET_LENGTH+b) % size)) << (8*b);
+        if(stamp >= timestamp)
+            return i;
+    }
+    return count;
+}
+
+// Buffer holds 'depth' packets one millisecond apart, query asks for the last 200 ms.
+static void BenchmarkWindowQuery(unsigned int depth)
+{
+    int s;
+    TimeIndexedBuffer indexed((unsigned int)(depth*PACKET_LENGTH), depth, s);
+    if(s!=CyclicBuffer::BUFFER_OK)
+        return;
+
+    // more than the depth is pushed, so the oldest packets are overwritten and pruned
+    // and the read pointer is not at the bottom border
+    unsigned char packet[PACKET_LENGTH];
+    unsigned long long now = 0;
+    for(unsigned int i=0; i<2*depth+depth/3; i++, now+=1000)
+    {
+        FillPacket(packet, now);
+        indexed.PushPacket(now, packet, PACKET_LENGTH);
+    }
+    now -= 1000;
+    unsigned long long since = now-200000;
+
+    const unsigned int queries = depth > 100000 ? 20 : 2000;
+    unsigned long long errors = 0;
+
+    BenchmarkTimer linear_timer;
+    for(unsigned int q=0; q<queries; q++)
+        errors += LinearSeek(indexed.GetBuffer(), since)!=depth-201;
+    double linear_ns = linear_timer.ElapsedNs();
+
+    TimeIndexedBuffer::time_packet window[256];
+    unsigned int found = 0;
+    const unsigned int index_queries = 200000;
+    BenchmarkTimer index_timer;
+    for(unsigned int q=0; q<index_queries; q++)
+    {
+        found = indexed.GetWindow(since, now, window, 256);
+        errors += found!=201;
+    }
+    double index_ns = index_timer.ElapsedNs();
+
+    unsigned long long stamp;
+    memcpy(&stamp, window[0].data.first, sizeof(stamp));
+    errors += stamp!=since || window[found-1].timestamp!=now;
+
+    char name[96];
+    snprintf(name, sizeof(name), "last 200 ms of %u packets, walk + decode", depth);
+    ReportBenchmark(name, queries, (unsigned long long)queries*201*PACKET_LENGTH, linear_ns);
+    snprintf(name, sizeof(name), "last 200 ms of %u packets, index seek + window", depth);
+    ReportBenchmark(name, index_queries, (unsigned long long)index_queries*201*PACKET_LENGTH, index_ns);
+    if(errors)
+        ReportFailure("%llu errors", errors);
+}
+
+// Cost of maintaining the index during pushes.
+static void BenchmarkIndexedPush(void)
+{
+    int s;
+    CyclicBuffer plain(1 << 20, s);
+    TimeIndexedBuffer indexed(1 << 20, 16384, s);
+
+    unsigned char packet[PACKET_LENGTH];
+    FillPacket(packet, 0);
+    const unsigned int packets = 4000000;
+
+    BenchmarkTimer plain_timer;
+    for(unsigned int i=0; i<packets; i++)
+        plain.PushN(packet, PACKET_LENGTH);
+    ReportBenchmark("CyclicBuffer PushN of packet", packets, (unsigned long long)packets*PACKET_LENGTH, plain_timer);
+
+    BenchmarkTimer indexed_timer;
+    for(unsigned int i=0; i<packets; i++)
+        indexed.PushPacket(i, packet, PACKET_LENGTH);
+    ReportBenchmark("TimeIndexedBuffer PushPacket", packets, (unsigned long long)packets*PACKET_LENGTH, indexed_timer);
+}
+
+static void RunTimeIndexBenchmarks(void)
+{
+    printf("\n== Time-indexed packets, 96 B (seek results verified) ==\n");
+
+    BenchmarkIndexedPush();
+    BenchmarkWindowQuery(1000);
+    BenchmarkWindowQuery(10000);
+    BenchmarkWindowQuery(100000);
+}
+
+BENCHMARK_GROUP("timeindex", RunTimeIndexBenchmarks);
@@ -0,0 +1,165 @@
+#include "benchmark.h"
+#include "cyclicbuffer.h"
+#include "typedcyclicbuffer.h"
+
+#include <cstdint>
+
+// Decoded target as produced by packet parser.
+struct TargetRecord
+{
+    unsigned short radar_id;
+    unsigned int timestamp;
+    float x;
+    float y;
+};
+
+// Value counting its constructions and destructions, so leaked or doubly destroyed slots are detected.
+struct CountedValue
+{
+    static long long live;
+    static unsigned long long moves;
+
+    unsigned int value;
+
+    CountedValue(unsigned int v = 0) : value(v) { live++; }
+    CountedValue(const CountedValue &other) : value(other.value) { live++; }
+    CountedValue(CountedValue &&other) : value(other.value) { other.value = MOVED; moves++; live++; }
+    ~CountedValue(void) { live--; }
+
+    CountedValue & operator=(const CountedValue &other) { value = other.value; return *this; }
+    CountedValue & operator=(CountedValue &&other) { value = other.value; other.value = MOVED; moves++; return *this; }
+
+    static const unsigned int MOVED = 0xFFFFFFFFu;
+};
+
+long long CountedValue::live = 0;
+unsigned long long CountedValue::moves = 0;
+
+// Value requiring more than fundamental alignment.
+struct alignas(64) AlignedValue
+{
+    unsigned int value;
+};
+
+// Fills the buffer, refused push must not construct anything, values are moved out in order
+// and 'Clear' destroys the rest. Returns the number of errors.
+template <class Buffer>
+static unsigned int CheckCountedValues(Buffer &buffer)
+{
+    unsigned int errors = 0, size = buffer.GetBufferSize(), next = 0, expected = 0;
+    long long live = CountedValue::live;
+
+    // positions wrap several times
+    for(unsigned int round=0; round<3; round++)
+    {
+        while(buffer.Emplace(next))
+            next++;
+        errors += CountedValue::live-live!=(long long)size;
+
+        CountedValue value;
+        for(unsigned int i=0; i<size/2+round; i++)
+        {
+            unsigned long long moves = CountedValue::moves;
+            if(!buffer.Pop(value) || value.value!=expected++ || CountedValue::moves!=moves+1)
+                errors++;
+        }
+    }
+    buffer.Clear();
+    errors += CountedValue::live!=live;
+
+    // values left in the buffer are destroyed by its destructor
+    while(buffer.Emplace(next))
+        next++;
+    return errors;
+}
+
+static void VerifyTyped(void)
+{
+    long long live = CountedValue::live;
+    unsigned int errors;
+    int s;
+    {
+        TypedCyclicBuffer<CountedValue> runtime(7, s);
+        errors = CheckCountedValues(runtime);
+    }
+    if(errors || CountedValue::live!=live)
+        ReportFailure("TypedCyclicBuffer<CountedValue>(7): %u errors, %lld values not destroyed", errors, CountedValue::live-live);
+
+    {
+        TypedCyclicBuffer<CountedValue, 8> fixed;
+        errors = CheckCountedValues(fixed);
+    }
+    if(errors || CountedValue::live!=live)
+        ReportFailure("TypedCyclicBuffer<CountedValue, 8>: %u errors, %lld values not destroyed", errors, CountedValue::live-live);
+
+    TypedCyclicBuffer<AlignedValue> aligned(5, s);
+    AlignedValue value = { 0 };
+    aligned.Push(value);
+    if(s!=CyclicBuffer::BUFFER_OK || (reinterpret_cast<std::uintptr_t>(aligned.Front()) % alignof(AlignedValue))!=0)
+        ReportFailure("TypedCyclicBuffer<AlignedValue> slots are not aligned to %u B", (unsigned int)alignof(AlignedValue));
+}
+
+// Pushes and pops bursts of 'burst' values, so positions wrap regularly.
+template <class Buffer, typename T>
+static void BenchmarkBursts(const char * name, Buffer &buffer, unsigned int burst, unsigned long long total)
+{
+    unsigned long long rounds = total/burst;
+    unsigned int sum = 0;
+    T value = T();
+
+    BenchmarkTimer timer;
+    for(unsigned long long r=0; r<rounds; r++)
+    {
+        for(unsigned int i=0; i<burst; i++)
+            buffer.Push(value);
+        for(unsigned int i=0; i<burst; i++)
+        {
+            buffer.Pop(value);
+            sum += (unsigned int)sizeof(value);
+        }
+    }
+    ReportBenchmark(name, rounds*burst, rounds*burst*sizeof(T), timer);
+    benchmark_sink = benchmark_sink + sum;
+}
+
+static void RunTypedBenchmarks(void)
+{
+    printf("\n== Byte Push/Pop, runtime-sized vs. fixed capacity templates ==\n");
+    VerifyTyped();
+
+    const unsigned long long total = 64ull<<20;
+    const unsigned int burst = 100;
+    int s;
+
+    // CyclicBuffer::Pop returns value, adapt it to the Pop(T &) interface
+    struct ByteCyclicBuffer
+    {
+        ByteCyclicBuffer(int &success) : buffer(4096, success) {}
+        void Push(unsigned char ch) { buffer.Push(ch); }
+        void Pop(unsigned char &ch) { ch = buffer.Pop(); }
+        CyclicBuffer buffer;
+    } byte_buffer(s);
+    BenchmarkBursts<ByteCyclicBuffer, unsigned char>("CyclicBuffer(4096)", byte_buffer, burst, total);
+
+    TypedCyclicBuffer<unsigned char> runtime_pow2(4096, s);
+    BenchmarkBursts<TypedCyclicBuffer<unsigned char>, unsigned char>("TypedCyclicBuffer<uchar>(4096)", runtime_pow2, burst, total);
+
+    TypedCyclicBuffer<unsigned char> runtime_other(4000, s);
+    BenchmarkBursts<TypedCyclicBuffer<unsigned char>, unsigned char>("TypedCyclicBuffer<uchar>(4000)", runtime_other, burst, total);
+
+    TypedCyclicBuffer<unsigned char, 4096> fixed_pow2;
+    BenchmarkBursts<TypedCyclicBuffer<unsigned char, 4096>, unsigned char>("TypedCyclicBuffer<uchar, 4096>", fixed_pow2, burst, total);
+
+    TypedCyclicBuffer<unsigned char, 4000> fixed_other;
+    BenchmarkBursts<TypedCyclicBuffer<unsigned char, 4000>, unsigned char>("TypedCyclicBuffer<uchar, 4000>", fixed_other, burst, total);
+
+    printf("\n== Target records ==\n");
+
+    TypedCyclicBuffer<TargetRecord> runtime_records(1024, s);
+    BenchmarkBursts<TypedCyclicBuffer<TargetRecord>, TargetRecord>("TypedCyclicBuffer<TargetRecord>(1024)", runtime_records, burst, total/8);
+
+    TypedCyclicBuffer<TargetRecord, 1024> fixed_records;
+    BenchmarkBursts<TypedCyclicBuffer<TargetRecord, 1024>, TargetRecord>("TypedCyclicBuffer<TargetRecord, 1024>", fixed_records, burst, total/8);
+}
+
+BENCHMARK_GROUP("typed", RunTypedBenchmarks);
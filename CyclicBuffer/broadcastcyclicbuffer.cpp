@@ -0,0 +1,231 @@
+#include "broadcastcyclicbuffer.h"
+
+#include <cstring>
+#include <new>
+
+BroadcastCyclicBuffer::BroadcastCyclicBuffer(unsigned int buf_size, unsigned int max_readers, int & success)
+    : buffer(NULL), buffer_size(0), index_mask(0), readers(NULL), reader_count(0), write_cursor(0), write_limit(0), cached_min_cursor(0)
+{
+    if(buf_size==0 || buf_size > 0x80000000u || max_readers==0)
+    {
+        success = CyclicBuffer::BUFFER_INVALID_SIZE;
+        return;
+    }
+
+    unsigned int size = 1;
+    while(size < buf_size)
+        size <<= 1;
+
+    buffer = new (std::nothrow) unsigned char[size];
+    readers = new (std::nothrow) reader_slot[max_readers];
+    if(buffer==NULL || readers==NULL)
+    {
+        success = CyclicBuffer::BUFFER_ALLOCATION_ERROR;
+        return;
+    }
+
+    memset(buffer, 0, size);
+    buffer_size = size;
+    index_mask = size-1;
+
+    for(unsigned int i=0; i<max_readers; i++)
+    {
+        readers[i].cursor.store(0);
+        readers[i].state.store(READER_FREE);
+        readers[i].lossy.store(false);
+        readers[i].overruns = 0;
+    }
+    reader_count = max_readers;
+
+    success = CyclicBuffer::BUFFER_OK;
+}
+
+BroadcastCyclicBuffer::~BroadcastCyclicBuffer()
+{
+    delete [] buffer;
+    delete [] readers;
+}
+
+int BroadcastCyclicBuffer::RegisterReader(bool lossy)
+{
+    for(unsigned int i=0; i<reader_count; i++)
+    {
+        int expected = READER_FREE;
+        if(readers[i].state.load(std::memory_order_relaxed)!=READER_FREE)
+            continue;
+
+        // slot is reserved first, so only one registering thread writes its fields
+        if(!readers[i].state.compare_exchange_strong(expected, READER_RESERVED, std::memory_order_acq_rel))
+            continue;
+
+        // cursor and mode must be set before the writer can see the slot active
+        readers[i].lossy.store(lossy, std::memory_order_relaxed);
+        readers[i].overruns = 0;
+        readers[i].cursor.store(write_cursor.load(std::memory_order_acquire), std::memory_order_relaxed);
+        readers[i].state.store(READER_ACTIVE, std::memory_order_release);
+
+        // writer may have moved before it noticed this reader, so start from current position
+        readers[i].cursor.store(write_cursor.load(std::memory_order_acquire), std::memory_order_release);
+        return (int)i;
+    }
+
+    return -1;
+}
+
+void BroadcastCyclicBuffer::UnregisterReader(int reader)
+{
+    if(IsActive(reader))
+        readers[reader].state.store(READER_FREE, std::memory_order_release);
+}
+
+size_t BroadcastCyclicBuffer::FreeSpace()
+{
+    unsigned long long w = write_cursor.load(std::memory_order_relaxed);
+    unsigned long long min_cursor = w;
+
+    // position of the slowest ordinary reader limits the writer
+    for(unsigned int i=0; i<reader_count; i++)
+    {
+        if(readers[i].state.load(std::memory_order_acquire)!=READER_ACTIVE || readers[i].lossy.load(std::memory_order_relaxed))
+            continue;
+        unsigned long long c = readers[i].cursor.load(std::memory_order_acquire);
+        if(c < min_cursor)
+            min_cursor = c;
+    }
+
+    cached_min_cursor = min_cursor;
+    return buffer_size-(size_t)(w-min_cursor);
+}
+
+size_t BroadcastCyclicBuffer::PushN(const unsigned char * data, size_t length)
+{
+    unsigned long long w = write_cursor.load(std::memory_order_relaxed);
+
+    // readers are scanned only if cached position of the slowest one does not give enough space
+    size_t free_space = buffer_size-(size_t)(w-cached_min_cursor);
+    if(length > free_space)
+    {
+        free_space = FreeSpace();
+        if(length > free_space)
+            length = free_space;
+    }
+
+    if(!length)
+        return 0;
+
+    // announce the overwritten region before touching it (as write of sequence lock)
+    write_limit.store(w+length, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    CyclicBuffer::buffer_segments segments;
+    GetSegments(w, length, segments);
+    memcpy(segments.first, data, segments.first_length);
+    memcpy(segments.second, data+segments.first_length, segments.second_length);
+
+    write_cursor.store(w+length, std::memory_order_release);
+    return length;
+}
+
+size_t BroadcastCyclicBuffer::PopN(int reader, unsigned char * data, size_t length)
+{
+    CyclicBuffer::buffer_segments segments;
+
+    for(;;)
+    {
+        length = PeekRead(reader, segments, length);
+        if(!length)
+            return 0;
+
+        memcpy(data, segments.first, segments.first_length);
+        memcpy(data+segments.first_length, segments.second, segments.second_length);
+
+        // copied data are valid only if the writer did not overwrite them meanwhile
+        if(ConsumeRead(reader, length))
+            return length;
+    }
+}
+
+size_t BroadcastCyclicBuffer::PeekRead(int reader, CyclicBuffer::buffer_segments &segments, size_t max_length)
+{
+    if(!IsActive(reader))
+        return 0;
+
+    unsigned long long c = readers[reader].cursor.load(std::memory_order_relaxed);
+    if(!ValidateRead(reader, c))
+        c = readers[reader].cursor.load(std::memory_order_relaxed);
+
+    unsigned long long w = write_cursor.load(std::memory_order_acquire);
+    size_t length = w > c ? (size_t)(w-c) : 0;
+    if(length > max_length)
+        length = max_length;
+
+    GetSegments(c, length, segments);
+    return length;
+}
+
+size_t BroadcastCyclicBuffer::ConsumeRead(int reader, size_t length)
+{
+    if(!IsActive(reader))
+        return 0;
+
+    unsigned long long c = readers[reader].cursor.load(std::memory_order_relaxed);
+    if(!ValidateRead(reader, c))
+        return 0;
+
+    unsigned long long w = write_cursor.load(std::memory_order_acquire);
+    unsigned long long unread = w > c ? w-c : 0;
+    if(length > unread)
+        length = (size_t)unread;
+
+    readers[reader].cursor.store(c+length, std::memory_order_release);
+    return length;
+}
+
+bool BroadcastCyclicBuffer::ValidateRead(int reader, unsigned long long cursor)
+{
+    // data loaded before must not be reordered after the load of the write limit
+    std::atomic_thread_fence(std::memory_order_acquire);
+    unsigned long long limit = write_limit.load(std::memory_order_relaxed);
+
+    if(limit <= cursor || limit-cursor <= buffer_size)
+        return true;
+
+    // writer lapped the reader, continue with the oldest data not touched by the writer
+    readers[reader].overruns += (limit-buffer_size)-cursor;
+    readers[reader].cursor.store(limit-buffer_size, std::memory_order_release);
+    return false;
+}
+
+unsigned long long BroadcastCyclicBuffer::GetLag(int reader)
+{
+    if(!IsActive(reader))
+        return 0;
+    return write_cursor.load(std::memory_order_acquire)-readers[reader].cursor.load(std::memory_order_relaxed);
+}
+
+unsigned long long BroadcastCyclicBuffer::GetOverruns(int reader)
+{
+    if(!IsActive(reader))
+        return 0;
+    return readers[reader].overruns;
+}
+
+void BroadcastCyclicBuffer::GetSegments(unsigned long long position, size_t length, CyclicBuffer::buffer_segments &segments)
+{
+    unsigned int index = (unsigned int)(position & index_mask);
+    size_t first = buffer_size-index;
+
+    segments.first = buffer+index;
+    segments.second = buffer;
+
+    if(first >= length)
+    {
+        segments.first_length = length;
+        segments.second_length = 0;
+    }
+    else
+    {
+        segments.first_length = first;
+        segments.second_length = length-first;
+    }
+}
@@ -0,0 +1,175 @@
+/*
+ * Author:      Peter Mikula
+ * Date:        10. 10. 2015
+ * Version:     0.1.1
+ *
+ */
+
+//! Cyclic buffer with one writer and many independent readers.
+/*!
+  Sensor stream is often needed by more consumers (tracking, logging, visualization).
+  Instead of copying every byte into separate buffers, all consumers read the same
+  memory. Every reader registers its own read cursor and reads at its own pace in its
+  own thread. The writer never overwrites data not yet read by the slowest ordinary
+  reader, pushes are refused instead. Readers registered as lossy do not hold the writer
+  back, when the writer laps them, they skip to the oldest availible data and the
+  skipped bytes are counted. One thread may push, every reader must be used by one thread.
+  */
+
+#ifndef BROADCASTCYCLICBUFFER_H
+#define BROADCASTCYCLICBUFFER_H
+
+#include <atomic>
+#include <cstddef>
+
+#include "cyclicbuffer.h"
+
+//! Size of cache line used to separate writer and reader data.
+#define BROADCAST_CACHE_LINE_SIZE 64
+
+class BroadcastCyclicBuffer
+{
+
+public:
+
+    //! Construcor of buffer class. Ensures basic initialization and memory allocation.
+    /*!
+     * \param buf_size Minimal buffer size in bytes, rounded up to power of two.
+     * \param max_readers Maximal number of readers registered at the same time.
+     * \param success if memory was allocated successfully, the return value is 0, otherwise the error code (see 'CyclicBuffer::buffer_error').
+     */
+    BroadcastCyclicBuffer(unsigned int buf_size, unsigned int max_readers, int &success);
+
+    //! Destructor of buffer class. Frees allocated memory.
+    ~BroadcastCyclicBuffer(void);
+
+    //! Function registers new reader.
+    /*!
+     * \brief Reader starts reading with data pushed after registration.
+     * \param lossy If true, writer does not wait for this reader and may overwrite data it has not read yet.
+     * \return Identifier of the reader used by reading functions, or -1 if all reader slots are used.
+     */
+    int RegisterReader(bool lossy = false);
+
+    //! Function unregisters reader, so it does not hold the writer back anymore.
+    void UnregisterReader(int reader);
+
+    //! Function pushes new value to the buffer (writer thread only).
+    /*!
+     * \return False if the value would overwrite data not read by some ordinary reader.
+     */
+    bool Push(unsigned char ch) { return PushN(&ch, 1)==1; }
+
+    //! Function pushes block of values to the buffer (writer thread only).
+    /*!
+     * \brief Data are copied with at most two memory copies. Only as many bytes are written as
+     * fit in front of the slowest ordinary (not lossy) reader.
+     * \return Number of bytes really written into buffer.
+     */
+    size_t PushN(const unsigned char * data, size_t length);
+
+    //! Function returns number of bytes that can be pushed now (writer thread only).
+    size_t FreeSpace(void);
+
+    //! Function retrieves one value for the reader.
+    /*!
+     * \return True if value was retrieved, false if there is nothing new for this reader.
+     */
+    bool Pop(int reader, unsigned char &ch) { return PopN(reader, &ch, 1)==1; }
+
+    //! Function retrieves block of values for the reader.
+    /*!
+     * \return Number of bytes really retrieved.
+     */
+    size_t PopN(int reader, unsigned char * data, size_t length);
+
+    //! Function returns data not read by the reader yet without copying them.
+    /*!
+     * \brief Regions are read in place and released by 'ConsumeRead'. For lossy reader
+     * the data may be overwritten while they are processed, 'ConsumeRead' then reports it.
+     * \return Total number of readable bytes in both regions.
+     */
+    size_t PeekRead(int reader, CyclicBuffer::buffer_segments &segments, size_t max_length = (size_t)-1);
+
+    //! Function releases bytes returned by 'PeekRead'.
+    /*!
+     * \return Number of bytes released, 0 if the data were overwritten meanwhile (lossy reader
+     * has been moved to the oldest availible data and must discard what it has read).
+     */
+    size_t ConsumeRead(int reader, size_t length);
+
+    //! Function returns number of bytes the reader is behind the writer.
+    unsigned long long GetLag(int reader);
+
+    //! Function returns number of bytes a lossy reader has missed because the writer lapped it.
+    unsigned long long GetOverruns(int reader);
+
+    //! Function returns the total bytes availible in memory for the buffer.
+    unsigned int GetBufferSize(void) const { return buffer_size; }
+
+private:
+
+    //! States of reader slot.
+    enum reader_slot_state {
+        READER_FREE = 0,
+        READER_ACTIVE = 1,
+        READER_RESERVED = 2 /*!< Slot is being set up by 'RegisterReader', writer ignores it. */
+    };
+
+    //! Read cursor and statistics of one reader, placed on its own cache line.
+    struct reader_slot {
+        std::atomic<unsigned long long> cursor; /*!< Free-running position of next byte to be read. */
+        std::atomic<int> state; /*!< Value of 'reader_slot_state'. */
+        std::atomic<bool> lossy; /*!< True if writer does not wait for this reader (slot may be registered again while writer reads it). */
+        unsigned long long overruns; /*!< Bytes missed by lossy reader. */
+        char padding[BROADCAST_CACHE_LINE_SIZE];
+    };
+
+    //! Function returns true if 'reader' is valid identifier of active reader.
+    bool IsActive(int reader) { return reader >= 0 && (unsigned int)reader < reader_count && readers[reader].state.load(std::memory_order_acquire)==READER_ACTIVE; }
+
+    //! Function checks whether data of the reader starting at 'cursor' were overwritten.
+    /*!
+     * \brief If they were, reader cursor is moved to the oldest availible data.
+     * \return True if data are still valid.
+     */
+    bool ValidateRead(int reader, unsigned long long cursor);
+
+    //! Function fills segments for 'length' bytes starting at 'position'.
+    void GetSegments(unsigned long long position, size_t length, CyclicBuffer::buffer_segments &segments);
+
+    //! Pointer to the buffer memory block.
+    unsigned char * buffer;
+
+    //! Size of buffer memory block (always power of two).
+    unsigned int buffer_size;
+
+    //! Mask converting free-running positions to buffer indexes.
+    unsigned int index_mask;
+
+    //! Reader slots.
+    reader_slot * readers;
+
+    //! Number of reader slots.
+    unsigned int reader_count;
+
+    char padding_shared[BROADCAST_CACHE_LINE_SIZE];
+
+    //! Free-running position of the next byte to be written. Written only by writer.
+    std::atomic<unsigned long long> write_cursor;
+
+    //! End of the region the writer is writing into, published before data are written.
+    /*!
+     * \brief Lossy readers compare it with their cursor after reading, to detect data overwritten
+     * during the read, even if the writer has not finished the write yet.
+     */
+    std::atomic<unsigned long long> write_limit;
+
+    //! Writer's last computed position of the slowest ordinary reader.
+    unsigned long long cached_min_cursor;
+
+    char padding_writer[BROADCAST_CACHE_LINE_SIZE];
+
+};
+
+#endif // BROADCASTCYCLICBUFFER_H
@@ -0,0 +1,178 @@
+#include "buffercrc.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BUFFERCRC_X86
+#include <nmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__)
+#define BUFFERCRC_TARGET(isa) __attribute__((target(isa)))
+#else
+#define BUFFERCRC_TARGET(isa)
+#endif
+
+namespace
+{
+
+typedef unsigned int (*crc_function)(unsigned int, const unsigned char *, size_t);
+
+// Tables for slicing-by-8, table[k][b] is CRC of byte b followed by k zero bytes.
+struct Crc32cTables
+{
+    unsigned int values[8][256];
+
+    Crc32cTables(void)
+    {
+        for(unsigned int i=0; i<256; i++)
+        {
+            unsigned int crc = i;
+            for(int bit=0; bit<8; bit++)
+                crc = (crc & 1) ? (crc >> 1) ^ 0x82F63B78u : (crc >> 1);
+            values[0][i] = crc;
+        }
+
+        for(unsigned int i=0; i<256; i++)
+        {
+            for(int k=1; k<8; k++)
+                values[k][i] = (values[k-1][i] >> 8) ^ values[0][values[k-1][i] & 0xFF];
+        }
+    }
+};
+
+const Crc32cTables & Tables(void)
+{
+    static const Crc32cTables tables;
+    return tables;
+}
+
+unsigned int Crc32cSlicing(unsigned int crc, const unsigned char * data, size_t length)
+{
+    const Crc32cTables & t = Tables();
+
+    // bytewise until data are aligned, so 8 byte blocks can be loaded efficiently
+    while(length && ((size_t)data & 7))
+    {
+        crc = t.values[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+        length--;
+    }
+
+    while(length >= 8)
+    {
+        unsigned int low, high;
+        memcpy(&low, data, 4);
+        memcpy(&high, data+4, 4);
+        low ^= crc;
+
+        // tables are built for little endian order of bytes
+        crc = t.values[7][low & 0xFF] ^ t.values[6][(low >> 8) & 0xFF] ^
+              t.values[5][(low >> 16) & 0xFF] ^ t.values[4][low >> 24] ^
+              t.values[3][high & 0xFF] ^ t.values[2][(high >> 8) & 0xFF] ^
+              t.values[1][(high >> 16) & 0xFF] ^ t.values[0][high >> 24];
+
+        data += 8;
+        length -= 8;
+    }
+
+    while(length--)
+        crc = t.values[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+
+    return crc;
+}
+
+#if defined(BUFFERCRC_X86)
+
+BUFFERCRC_TARGET("sse4.2")
+unsigned int Crc32cSse42(unsigned int crc, const unsigned char * data, size_t length)
+{
+    while(length && ((size_t)data & 7))
+    {
+        crc = _mm_crc32_u8(crc, *data++);
+        length--;
+    }
+
+#if defined(__x86_64__) || defined(_M_X64)
+    unsigned long long crc64 = crc;
+    while(length >= 8)
+    {
+        unsigned long long block;
+        memcpy(&block, data, 8);
+        crc64 = _mm_crc32_u64(crc64, block);
+        data += 8;
+        length -= 8;
+    }
+    crc = (unsigned int)crc64;
+#endif
+
+    while(length >= 4)
+    {
+        unsigned int block;
+        memcpy(&block, data, 4);
+        crc = _mm_crc32_u32(crc, block);
+        data += 4;
+        length -= 4;
+    }
+
+    while(length--)
+        crc = _mm_crc32_u8(crc, *data++);
+
+    return crc;
+}
+
+bool CpuSupportsSse42(void)
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20))!=0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+#endif // BUFFERCRC_X86
+
+struct Crc32cDispatch
+{
+    crc_function function;
+    const char * name;
+
+    Crc32cDispatch(void) : function(Crc32cSlicing), name("slicing-by-8")
+    {
+#if defined(BUFFERCRC_X86)
+        if(CpuSupportsSse42())
+        {
+            function = Crc32cSse42;
+            name = "sse4.2";
+        }
+#endif
+    }
+};
+
+const Crc32cDispatch & Dispatch(void)
+{
+    static const Crc32cDispatch dispatch;
+    return dispatch;
+}
+
+}
+
+unsigned int Crc32cUpdate(unsigned int crc, const unsigned char * data, size_t length)
+{
+    return Dispatch().function(crc, data, length);
+}
+
+unsigned int Crc32cUpdateTables(unsigned int crc, const unsigned char * data, size_t length)
+{
+    return Crc32cSlicing(crc, data, length);
+}
+
+const char * Crc32cImplementation(void)
+{
+    return Dispatch().name;
+}
@@ -0,0 +1,45 @@
+/*
+ * Author:      Peter Mikula
+ * Date:        10. 10. 2015
+ * Version:     0.1.1
+ *
+ */
+
+//! CRC-32C computation used for validation of UWB packets.
+/*!
+  CRC-32C (Castagnoli, reflected polynomial 0x82F63B78) is computed by the SSE4.2
+  'crc32' instruction if CPU supports it, otherwise by slicing-by-8 tables
+  processing 8 bytes per step. Implementation is selected at runtime.
+  Functions work with the raw CRC register, so CRC of data split into more
+  blocks (e.g. by the wrap point of buffer) is computed by successive calls.
+  Standard CRC-32C value is obtained as
+  'Crc32cUpdate(0xFFFFFFFF, data, length) ^ 0xFFFFFFFF'.
+  */
+
+#ifndef BUFFERCRC_H
+#define BUFFERCRC_H
+
+#include <cstddef>
+
+//! Initial value of CRC-32C register.
+#define CRC32C_INITIAL 0xFFFFFFFFu
+
+//! Value xored with CRC-32C register after the last byte.
+#define CRC32C_FINAL_XOR 0xFFFFFFFFu
+
+//! Function updates CRC-32C register with block of bytes.
+/*!
+ * \param crc Current value of CRC register.
+ * \param data Pointer to the memory block.
+ * \param length Length of the memory block in bytes.
+ * \return Updated value of CRC register.
+ */
+unsigned int Crc32cUpdate(unsigned int crc, const unsigned char * data, size_t length);
+
+//! Function updates CRC-32C register with block of bytes using tables only (no special instructions).
+unsigned int Crc32cUpdateTables(unsigned int crc, const unsigned char * data, size_t length);
+
+//! Function returns the name of selected implementation ("sse4.2" or "slicing-by-8").
+const char * Crc32cImplementation(void);
+
+#endif // BUFFERCRC_H
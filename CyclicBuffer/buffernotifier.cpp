@@ -0,0 +1,88 @@
+#include "buffernotifier.h"
+#include "bytesearch.h"
+
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#define NOTIFIER_POSIX
+#endif
+
+BufferNotifier::BufferNotifier(int &success)
+    : read_fd(-1), write_fd(-1), threshold(1), terminator(-1), armed(true), signals(0)
+{
+#if defined(__linux__)
+    read_fd = write_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    success = read_fd>=0 ? CyclicBuffer::BUFFER_OK : CyclicBuffer::BUFFER_FILE_ERROR;
+#elif defined(NOTIFIER_POSIX)
+    int fds[2];
+    if(pipe(fds)!=0)
+    {
+        success = CyclicBuffer::BUFFER_FILE_ERROR;
+        return;
+    }
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+    read_fd = fds[0];
+    write_fd = fds[1];
+    success = CyclicBuffer::BUFFER_OK;
+#else
+    success = CyclicBuffer::BUFFER_FILE_ERROR;
+#endif
+}
+
+BufferNotifier::~BufferNotifier()
+{
+#if defined(NOTIFIER_POSIX)
+    if(read_fd>=0)
+        close(read_fd);
+    if(write_fd>=0 && write_fd!=read_fd)
+        close(write_fd);
+#endif
+}
+
+void BufferNotifier::CheckArmed(const CyclicBuffer::buffer_segments &data, size_t available)
+{
+    bool ready = threshold!=0 && available>=threshold;
+    if(!ready && terminator>=0)
+    {
+        unsigned char value = (unsigned char)terminator;
+        ready = (data.first_length && FindByte(data.first, data.first_length, value)!=NULL) ||
+                (data.second_length && FindByte(data.second, data.second_length, value)!=NULL);
+    }
+
+    // only one signal per arming, concurrent 'Check' calls do not signal twice
+    if(!ready || !armed.exchange(false, std::memory_order_acq_rel))
+        return;
+
+    signals.fetch_add(1, std::memory_order_relaxed);
+#if defined(NOTIFIER_POSIX)
+    // counter of eventfd (or one byte in pipe) only needs to become nonzero
+    unsigned long long one = 1;
+    ssize_t written = write(write_fd, &one, write_fd==read_fd ? sizeof(one) : 1);
+    (void)written;
+#endif
+}
+
+void BufferNotifier::Rearm()
+{
+#if defined(NOTIFIER_POSIX)
+    // reading eventfd resets its counter, pipe has to be drained
+    unsigned long long counter[8];
+    if(write_fd==read_fd)
+    {
+        ssize_t length = read(read_fd, counter, sizeof(counter[0]));
+        (void)length;
+    }
+    else
+    {
+        while(read(read_fd, counter, sizeof(counter)) > 0)
+            ;
+    }
+#endif
+    armed.store(true, std::memory_order_relaxed);
+    // orders the flag before the following check of unread data (pairs with 'Check')
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
@@ -0,0 +1,110 @@
+/*
+ * Author:      Peter Mikula
+ * Date:        10. 10. 2015
+ * Version:     0.1.1
+ *
+ */
+
+//! Readiness notification of buffer through waitable file descriptor.
+/*!
+  Instead of spinning on 'Pop' or sleeping for a fixed time, the consumer can
+  wait for the buffer in its epoll (or poll/select) loop next to the serial
+  port descriptor. The notifier owns an 'eventfd' (a pipe on other POSIX
+  systems) that becomes readable once at least the threshold number of bytes
+  is availible, or once a terminator byte (end of packet) has been pushed.
+
+  Notifications are coalesced: after signalling, the notifier is disarmed
+  and following pushes only check a flag, until the consumer calls
+  'AcknowledgeNotification' of the buffer. Acknowledging clears the descriptor,
+  arms the notifier again and signals at once if unread data still satisfy the
+  condition, so no packet is missed between draining and re-arming.
+
+  The notifier is attached to a buffer by 'SetNotifier' of 'CyclicBuffer'
+  or 'SpscCyclicBuffer'; one notifier serves one buffer.
+  */
+
+#ifndef BUFFERNOTIFIER_H
+#define BUFFERNOTIFIER_H
+
+#include <atomic>
+#include <cstddef>
+
+#include "cyclicbuffer.h"
+
+class BufferNotifier
+{
+
+public:
+
+    //! Constructor creates the descriptor, notifier is armed with threshold 1 byte and no terminator.
+    /*!
+     * \param success BUFFER_OK, or BUFFER_FILE_ERROR if descriptor could not be created (see 'CyclicBuffer::buffer_error').
+     */
+    BufferNotifier(int &success);
+
+    //! Destructor closes the descriptor.
+    ~BufferNotifier(void);
+
+    //! Function returns the descriptor to be waited for readability (for example by 'epoll_wait').
+    int GetDescriptor(void) const { return read_fd; }
+
+    //! Function sets number of availible bytes that makes the buffer ready (0 disables the condition).
+    void SetThreshold(size_t min_length) { threshold = min_length; }
+
+    //! Function sets byte terminating packets, pushing it makes the buffer ready (negative value disables the condition).
+    void SetTerminator(int value) { terminator = value; }
+
+    //! Function returns number of bytes that makes the buffer ready.
+    size_t GetThreshold(void) const { return threshold; }
+
+    //! Function returns packet terminator or negative value if it is not used.
+    int GetTerminator(void) const { return terminator; }
+
+    //! Function returns number of signals written to the descriptor.
+    unsigned long long GetSignalCount(void) const { return signals.load(std::memory_order_relaxed); }
+
+    //! Function checks new data and signals if buffer became ready (producer side, called by buffer).
+    /*!
+     * \param data Segments to be searched for terminator.
+     * \param available Number of bytes availible for reading.
+     */
+    void Check(const CyclicBuffer::buffer_segments &data, size_t available)
+    {
+        // orders publishing of data before reading the flag (pairs with 'Rearm')
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(armed.load(std::memory_order_relaxed))
+            CheckArmed(data, available);
+    }
+
+    //! Function clears the descriptor and arms the notifier (consumer side, called by buffer).
+    /*!
+     * \brief Buffer has to call 'Check' with all unread data afterwards.
+     */
+    void Rearm(void);
+
+private:
+
+    //! Function evaluates conditions and signals once.
+    void CheckArmed(const CyclicBuffer::buffer_segments &data, size_t available);
+
+    //! Descriptor waited by consumer.
+    int read_fd;
+
+    //! Descriptor written by producer (the same as 'read_fd' for eventfd).
+    int write_fd;
+
+    //! Number of availible bytes that makes the buffer ready.
+    size_t threshold;
+
+    //! Byte terminating packets or negative value.
+    int terminator;
+
+    //! True if the next ready condition is signalled.
+    std::atomic<bool> armed;
+
+    //! Number of signals written.
+    std::atomic<unsigned long long> signals;
+
+};
+
+#endif // BUFFERNOTIFIER_H
@@ -0,0 +1,116 @@
+#include "bufferstatistics.h"
+
+BufferStatistics::BufferStatistics(unsigned int interval)
+    : write_position(0), read_position(0)
+{
+    SetMarkInterval(interval);
+    Reset();
+}
+
+void BufferStatistics::AddMark()
+{
+    latency_mark &mark = marks[(mark_first+mark_count) % STATISTICS_MARKS];
+    mark.position = write_position-1;
+    mark.time = std::chrono::steady_clock::now();
+    mark_count++;
+
+    next_mark = write_position-1+mark_interval;
+}
+
+void BufferStatistics::CompleteMarks(bool measure)
+{
+    std::chrono::steady_clock::time_point now;
+    if(measure)
+        now = std::chrono::steady_clock::now();
+
+    while(mark_count && marks[mark_first].position < read_position)
+    {
+        if(measure)
+        {
+            long long elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now-marks[mark_first].time).count();
+            unsigned int index = BucketIndex(elapsed > 0 ? (unsigned long long)elapsed : 0);
+            Add(latency_histogram[index], 1);
+            Add(latency_samples, 1);
+        }
+
+        mark_first = (mark_first+1) % STATISTICS_MARKS;
+        mark_count--;
+    }
+}
+
+void BufferStatistics::Snapshot(statistics_snapshot &snapshot) const
+{
+    snapshot.pushed_bytes = pushed_bytes.load(std::memory_order_relaxed);
+    snapshot.popped_bytes = popped_bytes.load(std::memory_order_relaxed);
+    snapshot.overwritten_bytes = overwritten_bytes.load(std::memory_order_relaxed);
+    snapshot.rejected_bytes = rejected_bytes.load(std::memory_order_relaxed);
+    snapshot.empty_pops = empty_pops.load(std::memory_order_relaxed);
+    snapshot.peak_occupancy = peak_occupancy.load(std::memory_order_relaxed);
+    snapshot.latency_samples = latency_samples.load(std::memory_order_relaxed);
+
+    for(unsigned int i=0; i<STATISTICS_HISTOGRAM_BUCKETS; i++)
+        snapshot.latency_histogram[i] = latency_histogram[i].load(std::memory_order_relaxed);
+}
+
+void BufferStatistics::Reset()
+{
+    pushed_bytes.store(0, std::memory_order_relaxed);
+    overwritten_bytes.store(0, std::memory_order_relaxed);
+    rejected_bytes.store(0, std::memory_order_relaxed);
+    peak_occupancy.store(0, std::memory_order_relaxed);
+    popped_bytes.store(0, std::memory_order_relaxed);
+    empty_pops.store(0, std::memory_order_relaxed);
+    latency_samples.store(0, std::memory_order_relaxed);
+
+    for(unsigned int i=0; i<STATISTICS_HISTOGRAM_BUCKETS; i++)
+        latency_histogram[i].store(0, std::memory_order_relaxed);
+
+    // unread bytes of the buffer keep their positions
+    write_position -= read_position;
+    read_position = 0;
+    next_mark = write_position;
+    mark_first = 0;
+    mark_count = 0;
+}
+
+unsigned int BufferStatistics::BucketIndex(unsigned long long nanoseconds)
+{
+    if(nanoseconds < STATISTICS_SUB_BUCKETS)
+        return (unsigned int)nanoseconds;
+
+    // position of the highest set bit selects power of two, next 4 bits select sub-bucket
+    unsigned int msb = 0;
+    while((nanoseconds >> msb) > 1)
+        msb++;
+
+    unsigned int index = (msb-3)*STATISTICS_SUB_BUCKETS+(unsigned int)((nanoseconds >> (msb-4))-STATISTICS_SUB_BUCKETS);
+    return index < STATISTICS_HISTOGRAM_BUCKETS ? index : STATISTICS_HISTOGRAM_BUCKETS-1;
+}
+
+unsigned long long BufferStatistics::BucketLowerBound(unsigned int index)
+{
+    if(index < STATISTICS_SUB_BUCKETS)
+        return index;
+
+    unsigned int msb = index/STATISTICS_SUB_BUCKETS+3;
+    unsigned long long sub = index % STATISTICS_SUB_BUCKETS+STATISTICS_SUB_BUCKETS;
+    return sub << (msb-4);
+}
+
+unsigned long long BufferStatistics::LatencyPercentile(const statistics_snapshot &snapshot, double percentile)
+{
+    if(!snapshot.latency_samples)
+        return 0;
+
+    unsigned long long limit = (unsigned long long)(percentile/100.0*(double)snapshot.latency_samples);
+    unsigned long long count = 0;
+
+    for(unsigned int i=0; i<STATISTICS_HISTOGRAM_BUCKETS; i++)
+    {
+        count += snapshot.latency_histogram[i];
+        if(count > limit || count==snapshot.latency_samples)
+            return (i+1 < STATISTICS_HISTOGRAM_BUCKETS) ? BucketLowerBound(i+1) : BucketLowerBound(i);
+    }
+
+    return BucketLowerBound(STATISTICS_HISTOGRAM_BUCKETS-1);
+}
@@ -0,0 +1,170 @@
+/*
+ * Author:      Peter Mikula
+ * Date:        10. 10. 2015
+ * Version:     0.1.1
+ *
+ */
+
+//! Counters and latency histogram describing traffic of one buffer.
+/*!
+  Statistics are collected by 'CyclicBuffer' only if the project is built with
+  'CYCLICBUFFER_STATISTICS' defined, otherwise the buffer does not contain them at all.
+  Every counter has exactly one writer (producer side or consumer side), so it is
+  updated by relaxed load and store without any locked instruction, and may be read
+  by monitoring thread at any time ('Snapshot').
+
+  Latency from push to pop is measured on samples: at most one pushed byte per
+  'mark interval' bytes is marked with the time of push. When consumer pops that
+  byte, the elapsed time is added to histogram with logarithmic buckets of
+  'STATISTICS_SUB_BUCKETS' linear sub-buckets each (HDR histogram style, relative
+  error below 1/16). Marked bytes that are overwritten are not measured.
+  */
+
+#ifndef BUFFERSTATISTICS_H
+#define BUFFERSTATISTICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+//! Number of linear sub-buckets in every power of two of latency histogram.
+#define STATISTICS_SUB_BUCKETS 16
+
+//! Number of histogram buckets, covering latencies up to 2^40 ns (about 18 minutes).
+#define STATISTICS_HISTOGRAM_BUCKETS (37*STATISTICS_SUB_BUCKETS)
+
+//! Maximal number of marked bytes waiting for pop.
+#define STATISTICS_MARKS 64
+
+class BufferStatistics
+{
+
+public:
+
+    //! Copy of all statistics taken at one moment.
+    struct statistics_snapshot {
+        unsigned long long pushed_bytes; /*!< Bytes stored into buffer. */
+        unsigned long long popped_bytes; /*!< Bytes read from buffer. */
+        unsigned long long overwritten_bytes; /*!< Unread bytes overwritten by 'BUFFER_OVERWRITE_OLDEST' policy. */
+        unsigned long long rejected_bytes; /*!< Bytes not stored because buffer was full (rejected, timed out or skipped input). */
+        unsigned long long empty_pops; /*!< Pop calls that found nothing to read. */
+        unsigned int peak_occupancy; /*!< Highest number of unread bytes. */
+        unsigned long long latency_samples; /*!< Number of measured latencies. */
+        unsigned long long latency_histogram[STATISTICS_HISTOGRAM_BUCKETS]; /*!< Counts of latencies per bucket (see 'BucketLowerBound'). */
+    };
+
+    //! Constructor of statistics, all counters are zero.
+    /*!
+     * \param interval Minimal distance (in bytes) of two bytes marked for latency measurement.
+     */
+    BufferStatistics(unsigned int interval = 4096);
+
+    //! Function records bytes stored into buffer (producer side).
+    void RecordPush(size_t length, unsigned int occupancy)
+    {
+        Add(pushed_bytes, length);
+        if(occupancy > peak_occupancy.load(std::memory_order_relaxed))
+            peak_occupancy.store(occupancy, std::memory_order_relaxed);
+
+        write_position += length;
+        if(length && write_position > next_mark && mark_count < STATISTICS_MARKS)
+            AddMark();
+    }
+
+    //! Function records bytes read from buffer (consumer side).
+    void RecordPop(size_t length)
+    {
+        Add(popped_bytes, length);
+        read_position += length;
+        if(mark_count && marks[mark_first].position < read_position)
+            CompleteMarks(true);
+    }
+
+    //! Function records pop that found nothing to read (consumer side).
+    void RecordEmptyPop(void) { Add(empty_pops, 1); }
+
+    //! Function records unread bytes overwritten by new data (producer side).
+    void RecordOverwrite(size_t length)
+    {
+        Add(overwritten_bytes, length);
+        read_position += length;
+        if(mark_count && marks[mark_first].position < read_position)
+            CompleteMarks(false);
+    }
+
+    //! Function records bytes that could not be stored (producer side).
+    void RecordReject(size_t length) { Add(rejected_bytes, length); }
+
+    //! Function records that pointers were moved by other means than push and pop.
+    /*!
+     * \brief Pending latency marks are dropped, so stale marks are never measured.
+     * \param unread Number of unread bytes after the change.
+     */
+    void RecordDiscard(unsigned int unread) { read_position = write_position-unread; mark_count = 0; next_mark = write_position; }
+
+    //! Function copies current statistics (may be called from any thread).
+    void Snapshot(statistics_snapshot &snapshot) const;
+
+    //! Function sets all counters to zero (must not run concurrently with buffer operations).
+    void Reset(void);
+
+    //! Function sets minimal distance of two bytes marked for latency measurement.
+    void SetMarkInterval(unsigned int interval) { mark_interval = interval ? interval : 1; }
+
+    //! Function returns index of histogram bucket for latency in nanoseconds.
+    static unsigned int BucketIndex(unsigned long long nanoseconds);
+
+    //! Function returns the smallest latency (in nanoseconds) counted in bucket.
+    static unsigned long long BucketLowerBound(unsigned int index);
+
+    //! Function returns latency (in nanoseconds) below which 'percentile' percent of samples lie.
+    /*!
+     * \brief The value is the upper bound of the bucket containing the percentile.
+     * \return Latency in nanoseconds, 0 if there are no samples.
+     */
+    static unsigned long long LatencyPercentile(const statistics_snapshot &snapshot, double percentile);
+
+private:
+
+    //! Latency mark of one pushed byte.
+    struct latency_mark {
+        unsigned long long position; /*!< Stream position of the marked byte. */
+        std::chrono::steady_clock::time_point time; /*!< Time of push. */
+    };
+
+    //! Function adds 'value' to counter with single writer.
+    static void Add(std::atomic<unsigned long long> &counter, size_t value)
+    {
+        counter.store(counter.load(std::memory_order_relaxed)+value, std::memory_order_relaxed);
+    }
+
+    //! Function marks the last pushed byte with current time.
+    void AddMark(void);
+
+    //! Function removes marks of bytes that were read or overwritten, 'measure' adds their latency to histogram.
+    void CompleteMarks(bool measure);
+
+    // producer side
+    std::atomic<unsigned long long> pushed_bytes;
+    std::atomic<unsigned long long> overwritten_bytes;
+    std::atomic<unsigned long long> rejected_bytes;
+    std::atomic<unsigned int> peak_occupancy;
+    unsigned long long write_position;
+    unsigned long long next_mark;
+    unsigned int mark_interval;
+
+    // consumer side
+    std::atomic<unsigned long long> popped_bytes;
+    std::atomic<unsigned long long> empty_pops;
+    std::atomic<unsigned long long> latency_samples;
+    std::atomic<unsigned long long> latency_histogram[STATISTICS_HISTOGRAM_BUCKETS];
+    unsigned long long read_position;
+
+    //! Marked bytes waiting for pop, used cyclically.
+    latency_mark marks[STATISTICS_MARKS];
+    unsigned int mark_first;
+    unsigned int mark_count;
+
+};
+
+#endif // BUFFERSTATISTICS_H
@@ -0,0 +1,200 @@
+#include "bytesearch.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BYTESEARCH_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__)
+#define BYTESEARCH_TARGET(isa) __attribute__((target(isa)))
+#else
+#define BYTESEARCH_TARGET(isa)
+#endif
+
+namespace
+{
+
+typedef const unsigned char * (*find_byte_function)(const unsigned char *, size_t, unsigned char);
+
+const unsigned char * FindByteScalar(const unsigned char * data, size_t length, unsigned char value)
+{
+    return (const unsigned char *)memchr(data, value, length);
+}
+
+#if defined(BYTESEARCH_X86)
+
+inline unsigned int LowestBit(unsigned int mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (unsigned int)index;
+#else
+    return (unsigned int)__builtin_ctz(mask);
+#endif
+}
+
+BYTESEARCH_TARGET("sse2")
+const unsigned char * FindByteSse2(const unsigned char * data, size_t length, unsigned char value)
+{
+    const __m128i pattern = _mm_set1_epi8((char)value);
+    size_t i = 0;
+
+    for(; i+16 <= length; i+=16)
+    {
+        __m128i block = _mm_loadu_si128((const __m128i *)(data+i));
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(block, pattern));
+        if(mask)
+            return data+i+LowestBit(mask);
+    }
+
+    for(; i<length; i++)
+    {
+        if(data[i]==value)
+            return data+i;
+    }
+    return NULL;
+}
+
+BYTESEARCH_TARGET("avx2")
+const unsigned char * FindByteAvx2(const unsigned char * data, size_t length, unsigned char value)
+{
+    const __m256i pattern = _mm256_set1_epi8((char)value);
+    size_t i = 0;
+
+    // two vectors per iteration, so the loop is not limited by the branch
+    for(; i+64 <= length; i+=64)
+    {
+        __m256i first = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(data+i)), pattern);
+        __m256i second = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(data+i+32)), pattern);
+        if(!_mm256_testz_si256(_mm256_or_si256(first, second), _mm256_or_si256(first, second)))
+        {
+            unsigned int mask = (unsigned int)_mm256_movemask_epi8(first);
+            if(mask)
+                return data+i+LowestBit(mask);
+            return data+i+32+LowestBit((unsigned int)_mm256_movemask_epi8(second));
+        }
+    }
+
+    for(; i+32 <= length; i+=32)
+    {
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(data+i)), pattern));
+        if(mask)
+            return data+i+LowestBit(mask);
+    }
+
+    for(; i<length; i++)
+    {
+        if(data[i]==value)
+            return data+i;
+    }
+    return NULL;
+}
+
+bool CpuSupportsAvx2(void)
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if(info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    // OSXSAVE and AVX, then operating system must save YMM registers
+    if((info[2] & (1 << 27))==0 || (info[2] & (1 << 28))==0)
+        return false;
+    if((_xgetbv(0) & 6)!=6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5))!=0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+bool CpuSupportsSse2(void)
+{
+#if defined(_M_X64) || defined(__x86_64__)
+    return true;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26))!=0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+#endif
+}
+
+#endif // BYTESEARCH_X86
+
+struct FindByteDispatch
+{
+    find_byte_function function;
+    const char * name;
+
+    FindByteDispatch(void) : function(FindByteScalar), name("scalar")
+    {
+        Select(NULL);
+    }
+
+    // NULL selects the best implementation supported by the CPU
+    bool Select(const char * requested)
+    {
+        if(requested!=NULL && strcmp(requested, "scalar")==0)
+        {
+            function = FindByteScalar;
+            name = "scalar";
+            return true;
+        }
+#if defined(BYTESEARCH_X86)
+        bool any = requested==NULL;
+        if((any || strcmp(requested, "avx2")==0) && CpuSupportsAvx2())
+        {
+            function = FindByteAvx2;
+            name = "avx2";
+            return true;
+        }
+        if((any || strcmp(requested, "sse2")==0) && CpuSupportsSse2())
+        {
+            function = FindByteSse2;
+            name = "sse2";
+            return true;
+        }
+#endif
+        if(requested!=NULL)
+            return false;
+
+        function = FindByteScalar;
+        name = "scalar";
+        return true;
+    }
+};
+
+FindByteDispatch & Dispatch(void)
+{
+    static FindByteDispatch dispatch;
+    return dispatch;
+}
+
+}
+
+const unsigned char * FindByte(const unsigned char * data, size_t length, unsigned char value)
+{
+    return Dispatch().function(data, length, value);
+}
+
+const char * FindByteImplementation(void)
+{
+    return Dispatch().name;
+}
+
+bool SelectFindByteImplementation(const char * name)
+{
+    return Dispatch().Select(name);
+}
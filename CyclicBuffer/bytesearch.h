@@ -0,0 +1,40 @@
+/*
+ * Author:      Peter Mikula
+ * Date:        10. 10. 2015
+ * Version:     0.1.1
+ *
+ */
+
+//! Vectorized search of bytes in memory block.
+/*!
+  Functions used by buffer classes for searching packet terminators and sync
+  words. The implementation is selected at runtime according to the CPU:
+  AVX2, SSE2 or scalar fallback.
+  */
+
+#ifndef BYTESEARCH_H
+#define BYTESEARCH_H
+
+#include <cstddef>
+
+//! Function finds the first occurrence of 'value' in memory block.
+/*!
+ * \param data Pointer to the memory block.
+ * \param length Length of the memory block in bytes.
+ * \param value Byte to be found.
+ * \return Pointer to the first occurrence or NULL if value is not present.
+ */
+const unsigned char * FindByte(const unsigned char * data, size_t length, unsigned char value);
+
+//! Function returns the name of selected implementation ("avx2", "sse2" or "scalar").
+const char * FindByteImplementation(void);
+
+//! Function selects implementation by name, so every one can be verified (tests and benchmarks only).
+/*!
+ * \brief Must not be called while other threads search.
+ * \param name Name of implementation ("avx2", "sse2" or "scalar"), NULL selects the best one again.
+ * \return False if the CPU does not support the implementation, selection is then not changed.
+ */
+bool SelectFindByteImplementation(const char * name);
+
+#endif // BYTESEARCH_H
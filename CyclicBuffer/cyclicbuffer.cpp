@@ -1,8 +1,36 @@
 #include "cyclicbuffer.h"
+#include "bytesearch.h"
+#include "buffernotifier.h"
 
-CyclicBuffer::CyclicBuffer(unsigned int buf_size, int & success)
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <new>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <sys/uio.h>
+#include <unistd.h>
+#define CYCLICBUFFER_POSIX_IO
+#endif
+
+// statistics hooks disappear entirely unless they are enabled at compile time
+#if defined(CYCLICBUFFER_STATISTICS)
+#define CYCLICBUFFER_STATISTIC(call) statistics.call
+#else
+#define CYCLICBUFFER_STATISTIC(call)
+#endif
+
+CyclicBuffer::CyclicBuffer(unsigned int buf_size, int & success, bool mirrored)
 {
-    buffer_error_code = BUFFER_UNDEFINED_ERROR;
+    InitializeMembers();
+    mirror_requested = mirrored;
 
     // check if buf_size is reasonable number
     if(buf_size==0)
@@ -11,8 +39,9 @@ CyclicBuffer::CyclicBuffer(unsigned int buf_size, int & success)
         return;
     }
 
-    buffer = new unsigned char[buf_size];
     // try to allocate requested memory
+    mirrored_storage = mirror_requested;
+    buffer = AllocateStorage(buf_size, mirrored_storage);
     if(buffer==NULL)
     {
         success = buffer_error_code = BUFFER_ALLOCATION_ERROR;
@@ -26,32 +55,125 @@ CyclicBuffer::CyclicBuffer(unsigned int buf_size, int & success)
     // set the initial buffer size
     buffer_size = buf_size;
 
-    // prepare buffer
+    write_ptr = read_ptr = 0;
+
+    // prepare buffer (new memory is cleared lazily)
     ClearBuffer();
 
+    success = BUFFER_OK;
+}
+
+CyclicBuffer::CyclicBuffer(unsigned char * storage, unsigned int buf_size, int & success)
+{
+    InitializeMembers();
+
+    if(storage==NULL || buf_size==0)
+    {
+        success = buffer_error_code = BUFFER_INVALID_SIZE;
+        return;
+    }
+
+    // memory is owned by the caller (e.g. 'CyclicBufferPool')
+    buffer = storage;
+    external_storage = true;
+    bottom_index = 0;
+    top_index = buf_size-1;
+    buffer_size = buf_size;
     write_ptr = read_ptr = 0;
 
+    // recycled memory may hold old data, it is cleared lazily
+    ClearBuffer();
+
     success = BUFFER_OK;
 }
 
+void CyclicBuffer::InitializeMembers()
+{
+    buffer_error_code = BUFFER_UNDEFINED_ERROR;
+    buffer = NULL;
+    buffer_size = 0;
+    mirrored_storage = false;
+    mirror_requested = false;
+    external_storage = false;
+    used_bytes = 0;
+    overflow_policy = BUFFER_OVERWRITE_OLDEST;
+    block_timeout_ms = 0;
+    dropped_bytes = 0;
+    blocked_producers = 0;
+    running_crc_enabled = false;
+    running_crc = CRC32C_INITIAL;
+    pushed_bytes = 0;
+    high_water_mark = 0;
+    sample_peak = 0;
+    sample_pushed = 0;
+    window_next = 0;
+    window_count = 0;
+    autosize_enabled = false;
+    autosize_resizes = 0;
+    autosize_reallocations = 0;
+    notifier = NULL;
+    push_hook = NULL;
+    push_hook_context = NULL;
+    valid_limit = 0;
+    bottom_index = top_index = 0;
+    write_ptr = read_ptr = 0;
+}
+
 CyclicBuffer::~CyclicBuffer()
 {
-    delete buffer;
+    if(!external_storage)
+        ReleaseStorage(buffer, buffer_size, mirrored_storage);
 }
 
-void CyclicBuffer::Push(unsigned char ch)
+CyclicBuffer::buffer_error CyclicBuffer::Push(unsigned char ch)
 {
+    if(overflow_policy==BUFFER_BLOCK)
+        return (PushBlocking(&ch, 1)==1) ? BUFFER_OK : buffer_error_code;
+
+    if(used_bytes==GetBufferSize())
+    {
+        if(overflow_policy==BUFFER_REJECT)
+        {
+            CYCLICBUFFER_STATISTIC(RecordReject(1));
+            buffer_error_code = BUFFER_FULL;
+            return buffer_error_code;
+        }
+
+        // the oldest unread byte is going to be overwritten
+        if(++read_ptr > top_index)
+            read_ptr = bottom_index;
+        used_bytes--;
+        dropped_bytes++;
+        CYCLICBUFFER_STATISTIC(RecordOverwrite(1));
+    }
+
+    if(running_crc_enabled)
+        running_crc = Crc32cUpdate(running_crc, &ch, 1);
+
+    MarkWritten(write_ptr, 1);
     buffer[write_ptr] = ch;
     if(++write_ptr > top_index)
         write_ptr = bottom_index;
+    used_bytes++;
+    RecordPush(1);
+
+    return BUFFER_OK;
 }
 
 unsigned char CyclicBuffer::Pop()
 {
-    // Since write_ptr points to first space to be overwritten in next push call,
-    // this position does not contain fresh data. There is nothing to read.
-    if(read_ptr==write_ptr)
+    PolicyLock lock(*this);
+
+    // There is nothing to read.
+    if(!used_bytes)
+    {
+        CYCLICBUFFER_STATISTIC(RecordEmptyPop());
         return (unsigned char)NULL;
+    }
+
+    used_bytes--;
+    CYCLICBUFFER_STATISTIC(RecordPop(1));
+    NotifyProducers();
 
     if(read_ptr == top_index)
     {
@@ -62,8 +184,423 @@ unsigned char CyclicBuffer::Pop()
     return buffer[read_ptr++];
 }
 
+size_t CyclicBuffer::PushN(const unsigned char * data, size_t length)
+{
+    if(overflow_policy==BUFFER_BLOCK)
+        return PushBlocking(data, length);
+
+    size_t free_space = FreeSpace();
+    if(length <= free_space)
+        return WriteFree(data, length);
+
+    // block is never stored partially, so the consumer does not get a cut packet
+    if(overflow_policy==BUFFER_REJECT)
+    {
+        buffer_error_code = BUFFER_FULL;
+        CYCLICBUFFER_STATISTIC(RecordReject(length));
+        return 0;
+    }
+
+    // only the newest bytes fitting into buffer are stored, the rest is dropped
+    unsigned int size = GetBufferSize();
+    if(length > size)
+    {
+        buffer_error_code = BUFFER_FULL;
+        dropped_bytes += length-size;
+        CYCLICBUFFER_STATISTIC(RecordReject(length-size));
+        data += length-size;
+        length = size;
+    }
+
+    size_t overwritten = length-free_space;
+    if(overwritten > used_bytes)
+        overwritten = used_bytes;
+    read_ptr = AdvanceIndex(read_ptr, overwritten);
+    used_bytes -= (unsigned int)overwritten;
+    dropped_bytes += overwritten;
+    CYCLICBUFFER_STATISTIC(RecordOverwrite(overwritten));
+
+    return WriteFree(data, length);
+}
+
+size_t CyclicBuffer::PopN(unsigned char * data, size_t length)
+{
+    PolicyLock lock(*this);
+
+    if(length > used_bytes)
+    {
+        if(!used_bytes)
+        {
+            CYCLICBUFFER_STATISTIC(RecordEmptyPop());
+            return 0;
+        }
+        length = used_bytes;
+    }
+
+    buffer_segments segments;
+    GetSegments(read_ptr, length, segments);
+
+    memcpy(data, segments.first, segments.first_length);
+    if(segments.second_length)
+        memcpy(data+segments.first_length, segments.second, segments.second_length);
+
+    read_ptr = AdvanceIndex(read_ptr, length);
+    used_bytes -= (unsigned int)length;
+    CYCLICBUFFER_STATISTIC(RecordPop(length));
+    NotifyProducers();
+
+    return length;
+}
+
+size_t CyclicBuffer::PrepareWrite(buffer_segments &segments, size_t max_length)
+{
+    PolicyLock lock(*this);
+
+    // do not lap the reader
+    size_t length = FreeSpace();
+    if(length > max_length)
+        length = max_length;
+
+    GetSegments(write_ptr, length, segments);
+    return length;
+}
+
+size_t CyclicBuffer::CommitWrite(size_t length)
+{
+    PolicyLock lock(*this);
+
+    size_t free_space = FreeSpace();
+    if(length > free_space)
+        length = free_space;
+
+    buffer_segments segments;
+    GetSegments(write_ptr, length, segments);
+    MarkSegments(segments, true);
+
+    if(running_crc_enabled)
+    {
+        running_crc = Crc32cUpdate(running_crc, segments.first, segments.first_length);
+        running_crc = Crc32cUpdate(running_crc, segments.second, segments.second_length);
+    }
+
+    write_ptr = AdvanceIndex(write_ptr, length);
+    used_bytes += (unsigned int)length;
+    RecordPush(length);
+    return length;
+}
+
+size_t CyclicBuffer::PeekRead(buffer_segments &segments, size_t max_length)
+{
+    PolicyLock lock(*this);
+
+    size_t length = used_bytes;
+    if(length > max_length)
+        length = max_length;
+
+    GetSegments(read_ptr, length, segments);
+    return length;
+}
+
+size_t CyclicBuffer::ConsumeRead(size_t length)
+{
+    PolicyLock lock(*this);
+
+    if(length > used_bytes)
+        length = used_bytes;
+
+    read_ptr = AdvanceIndex(read_ptr, length);
+    used_bytes -= (unsigned int)length;
+    CYCLICBUFFER_STATISTIC(RecordPop(length));
+    NotifyProducers();
+    return length;
+}
+
+CyclicBuffer::buffer_error CyclicBuffer::FillFromFd(int fd, size_t &transferred, size_t max_length)
+{
+    transferred = 0;
+
+#if defined(CYCLICBUFFER_POSIX_IO)
+    buffer_segments segments;
+    if(!PrepareWrite(segments, max_length))
+    {
+        buffer_error_code = BUFFER_FULL;
+        return buffer_error_code;
+    }
+
+    struct iovec vectors[2];
+    vectors[0].iov_base = segments.first;
+    vectors[0].iov_len = segments.first_length;
+    vectors[1].iov_base = segments.second;
+    vectors[1].iov_len = segments.second_length;
+
+    ssize_t length;
+    do
+        length = readv(fd, vectors, segments.second_length ? 2 : 1);
+    while(length<0 && errno==EINTR);
+
+    if(length<0)
+    {
+        buffer_error_code = (errno==EAGAIN || errno==EWOULDBLOCK) ? BUFFER_OK : BUFFER_FILE_ERROR;
+        return buffer_error_code;
+    }
+    if(length==0)
+    {
+        buffer_error_code = BUFFER_END_OF_FILE;
+        return buffer_error_code;
+    }
+
+    transferred = CommitWrite((size_t)length);
+    buffer_error_code = BUFFER_OK;
+#else
+    (void)fd;
+    (void)max_length;
+    buffer_error_code = BUFFER_FILE_ERROR;
+#endif
+    return buffer_error_code;
+}
+
+CyclicBuffer::buffer_error CyclicBuffer::DrainToFd(int fd, size_t &transferred, size_t max_length)
+{
+    transferred = 0;
+
+#if defined(CYCLICBUFFER_POSIX_IO)
+    buffer_segments segments;
+    if(!PeekRead(segments, max_length))
+    {
+        buffer_error_code = BUFFER_OK;
+        return buffer_error_code;
+    }
+
+    struct iovec vectors[2];
+    vectors[0].iov_base = segments.first;
+    vectors[0].iov_len = segments.first_length;
+    vectors[1].iov_base = segments.second;
+    vectors[1].iov_len = segments.second_length;
+
+    ssize_t length;
+    do
+        length = writev(fd, vectors, segments.second_length ? 2 : 1);
+    while(length<0 && errno==EINTR);
+
+    if(length<0)
+    {
+        buffer_error_code = (errno==EAGAIN || errno==EWOULDBLOCK) ? BUFFER_OK : BUFFER_FILE_ERROR;
+        return buffer_error_code;
+    }
+
+    transferred = ConsumeRead((size_t)length);
+    buffer_error_code = BUFFER_OK;
+#else
+    (void)fd;
+    (void)max_length;
+    buffer_error_code = BUFFER_FILE_ERROR;
+#endif
+    return buffer_error_code;
+}
+
+size_t CyclicBuffer::Find(unsigned char value, size_t from)
+{
+    PolicyLock lock(*this);
+
+    buffer_segments segments;
+    GetSegments(read_ptr, used_bytes, segments);
+
+    return FindInSegments(segments, value, from);
+}
+
+size_t CyclicBuffer::Find(const unsigned char * sequence, size_t length, size_t from)
+{
+    PolicyLock lock(*this);
+
+    if(!length)
+        return (from <= used_bytes) ? from : BUFFER_NOT_FOUND;
+
+    buffer_segments segments;
+    GetSegments(read_ptr, used_bytes, segments);
+
+    // find candidates by the first byte, then compare the rest (possibly across the wrap point)
+    while(from+length <= used_bytes)
+    {
+        size_t candidate = FindInSegments(segments, sequence[0], from);
+        if(candidate==BUFFER_NOT_FOUND || candidate+length > used_bytes)
+            return BUFFER_NOT_FOUND;
+
+        size_t i = 1;
+        for(; i<length; i++)
+        {
+            size_t offset = candidate+i;
+            unsigned char ch = (offset < segments.first_length) ? segments.first[offset] : segments.second[offset-segments.first_length];
+            if(ch!=sequence[i])
+                break;
+        }
+
+        if(i==length)
+            return candidate;
+
+        from = candidate+1;
+    }
+
+    return BUFFER_NOT_FOUND;
+}
+
+CyclicBuffer::buffer_error CyclicBuffer::ComputeCrc(unsigned int index, size_t length, unsigned int &crc)
+{
+    PolicyLock lock(*this);
+
+    if(index > top_index)
+    {
+        buffer_error_code = BUFFER_INDEX_GREATER;
+        return buffer_error_code;
+    }
+    else if(index < bottom_index)
+    {
+        buffer_error_code = BUFFER_INDEX_LESS;
+        return buffer_error_code;
+    }
+    else if(length > GetBufferSize())
+    {
+        buffer_error_code = BUFFER_INCORRECT_SIZE;
+        return buffer_error_code;
+    }
+
+    buffer_segments segments;
+    GetSegments(index, length, segments);
+
+    crc = UpdateCrc(CRC32C_INITIAL, segments.first, segments.first_length);
+    crc = UpdateCrc(crc, segments.second, segments.second_length);
+    crc ^= CRC32C_FINAL_XOR;
+
+    buffer_error_code = BUFFER_OK;
+    return buffer_error_code;
+}
+
+size_t CyclicBuffer::FindInSegments(const buffer_segments &segments, unsigned char value, size_t from)
+{
+    if(from < segments.first_length)
+    {
+        const unsigned char * found = FindByte(segments.first+from, segments.first_length-from, value);
+        if(found!=NULL)
+            return (size_t)(found-segments.first);
+        from = segments.first_length;
+    }
+
+    size_t second_from = from-segments.first_length;
+    if(second_from < segments.second_length)
+    {
+        const unsigned char * found = FindByte(segments.second+second_from, segments.second_length-second_from, value);
+        if(found!=NULL)
+            return segments.first_length+(size_t)(found-segments.second);
+    }
+
+    return BUFFER_NOT_FOUND;
+}
+
+size_t CyclicBuffer::WriteFree(const unsigned char * data, size_t length)
+{
+    size_t free_space = FreeSpace();
+    if(length > free_space)
+        length = free_space;
+
+    buffer_segments segments;
+    GetSegments(write_ptr, length, segments);
+
+    memcpy(segments.first, data, segments.first_length);
+    if(segments.second_length)
+        memcpy(segments.second, data+segments.first_length, segments.second_length);
+    MarkSegments(segments, true);
+
+    if(running_crc_enabled)
+        running_crc = Crc32cUpdate(running_crc, data, length);
+
+    write_ptr = AdvanceIndex(write_ptr, length);
+    used_bytes += (unsigned int)length;
+    RecordPush(length);
+    return length;
+}
+
+size_t CyclicBuffer::PushBlocking(const unsigned char * data, size_t length)
+{
+    std::unique_lock<std::mutex> lock(policy_mutex);
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now()+std::chrono::milliseconds(block_timeout_ms);
+    size_t written = 0;
+
+    while(written < length)
+    {
+        if(used_bytes==GetBufferSize())
+        {
+            // wait until consumer frees some space
+            bool freed = true;
+            blocked_producers++;
+            if(block_timeout_ms)
+                freed = space_freed.wait_until(lock, deadline, [this]() { return used_bytes < GetBufferSize(); });
+            else
+                space_freed.wait(lock, [this]() { return used_bytes < GetBufferSize(); });
+            blocked_producers--;
+
+            if(!freed)
+            {
+                CYCLICBUFFER_STATISTIC(RecordReject(length-written));
+                buffer_error_code = BUFFER_TIMEOUT;
+                break;
+            }
+        }
+
+        written += WriteFree(data+written, length-written);
+    }
+
+    return written;
+}
+
+void CyclicBuffer::GetSegments(unsigned int index, size_t length, buffer_segments &segments)
+{
+    // first segment ends at the top border, the rest continues from the bottom border
+    size_t first = (top_index-index)+1;
+
+    segments.first = buffer+index;
+    segments.second = buffer+bottom_index;
+
+    // mirrored memory continues behind the top border with bytes from the bottom border
+    if(first >= length || IsMirrored())
+    {
+        segments.first_length = length;
+        segments.second_length = 0;
+    }
+    else
+    {
+        segments.first_length = first;
+        segments.second_length = length-first;
+    }
+}
+
+void CyclicBuffer::RecountUsedBytes()
+{
+    if(write_ptr >= read_ptr)
+        used_bytes = write_ptr-read_ptr;
+    else
+        used_bytes = GetBufferSize()-(read_ptr-write_ptr);
+
+    // bytes that became unread without being written are read as NULL characters
+    buffer_segments segments;
+    GetSegments(read_ptr, used_bytes, segments);
+    MarkSegments(segments, false);
+
+    CYCLICBUFFER_STATISTIC(RecordDiscard(used_bytes));
+}
+
+unsigned int CyclicBuffer::AdvanceIndex(unsigned int index, size_t length)
+{
+    size_t first = (top_index-index)+1;
+
+    if(length < first)
+        return index+(unsigned int)length;
+
+    return bottom_index+(unsigned int)(length-first);
+}
+
 CyclicBuffer::buffer_error CyclicBuffer::SetPopIndex(unsigned int index)
 {
+    PolicyLock lock(*this);
+
     // check if index is not outside the range
     if(index > top_index)
     {
@@ -76,13 +613,21 @@ CyclicBuffer::buffer_error CyclicBuffer::SetPopIndex(unsigned int index)
         return buffer_error_code;
     }
 
-    read_ptr = index;
+    // unchanged pointer keeps the occupancy (full buffer has both pointers at the same byte)
+    if(index!=read_ptr)
+    {
+        read_ptr = index;
+        RecountUsedBytes();
+    }
+    NotifyProducers();
     buffer_error_code = BUFFER_OK;
     return buffer_error_code;
 }
 
 CyclicBuffer::buffer_error CyclicBuffer::SetPushIndex(unsigned int index)
 {
+    PolicyLock lock(*this);
+
     // check if index is not outside the range
     if(index > top_index)
     {
@@ -95,13 +640,20 @@ CyclicBuffer::buffer_error CyclicBuffer::SetPushIndex(unsigned int index)
         return buffer_error_code;
     }
 
-    write_ptr = index;
+    if(index!=write_ptr)
+    {
+        write_ptr = index;
+        RecountUsedBytes();
+    }
+    NotifyProducers();
     buffer_error_code = BUFFER_OK;
     return buffer_error_code;
 }
 
 CyclicBuffer::buffer_error CyclicBuffer::SetTopIndex(unsigned int index)
 {
+    PolicyLock lock(*this);
+
     // check if new index is not more than allocated array
     if(index > (buffer_size-1))
     {
@@ -116,28 +668,15 @@ CyclicBuffer::buffer_error CyclicBuffer::SetTopIndex(unsigned int index)
         return buffer_error_code;
     }
 
-    // clear bytes that are to be added
-    if(top_index < index)
-    {
-        for(unsigned int i = (top_index+1); i<=index; i++)
-            buffer[i] = (unsigned char)NULL;
-    }
-
-    // now everything should be OK to set
-    top_index = index;
-
-    // make correction of other pointers
-    if(write_ptr > top_index)
-        write_ptr = bottom_index; // so the "new" last byte will not be rewritten twice
-    if(read_ptr > top_index)
-        read_ptr = bottom_index; // so the "new" last byte will not be read twice
-
-    buffer_error_code = BUFFER_OK;
+    buffer_error_code = MoveBorders(bottom_index, index);
+    NotifyProducers();
     return buffer_error_code;
 }
 
 CyclicBuffer::buffer_error CyclicBuffer::SetBottomIndex(unsigned int index)
 {
+    PolicyLock lock(*this);
+
     // check if new index is not more than allocated array
     if(index > (buffer_size-1))
     {
@@ -152,27 +691,80 @@ CyclicBuffer::buffer_error CyclicBuffer::SetBottomIndex(unsigned int index)
         return buffer_error_code;
     }
 
-    // clear bytes that are to be added
-    if(index < bottom_index)
+    buffer_error_code = MoveBorders(index, top_index);
+    NotifyProducers();
+    return buffer_error_code;
+}
+
+CyclicBuffer::buffer_error CyclicBuffer::MoveBorders(unsigned int new_bottom, unsigned int new_top)
+{
+    // unread data are never dropped by moving borders
+    unsigned int unread = used_bytes;
+    if(unread > (new_top-new_bottom)+1)
+        return BUFFER_INCORRECT_SIZE;
+
+    // clear bytes that are to be added (bytes above 'valid_limit' are clear already)
+    if(top_index < new_top && top_index+1 < valid_limit)
+        ClearRange(top_index+1, (new_top < valid_limit ? new_top+1 : valid_limit)-(top_index+1));
+    if(new_bottom < bottom_index && new_bottom < valid_limit)
+        ClearRange(new_bottom, (bottom_index < valid_limit ? bottom_index : valid_limit)-new_bottom);
+
+    unsigned int wrapped = unread > (top_index-read_ptr)+1 ? unread-((top_index-read_ptr)+1) : 0;
+
+    if(!unread)
+    {
+        // empty buffer only needs pointers inside the borders
+        if(read_ptr < new_bottom || read_ptr > new_top)
+            read_ptr = new_bottom;
+    }
+    else if(!wrapped && read_ptr >= new_bottom && read_ptr+unread <= new_top+1)
+    {
+        // unread data stay where they are
+    }
+    else if(wrapped && new_bottom==bottom_index && new_top==top_index)
     {
-        for(unsigned int i = index; i<=(bottom_index-1); i++)
-            buffer[i] = (unsigned char)NULL;
+        // borders are not moved
     }
+    else if(wrapped && new_bottom==bottom_index && new_top > top_index && wrapped <= new_top-top_index)
+    {
+        // wrapped part of unread data is moved behind the old top border
+        memcpy(buffer+top_index+1, buffer+bottom_index, wrapped);
+        MarkWritten(top_index+1, wrapped);
+    }
+    else
+    {
+        if(wrapped)
+        {
+            // unread data are unwrapped in place, so they start at the bottom border
+            ExtendValid(bottom_index, top_index+1, true);
+            std::rotate(buffer+bottom_index, buffer+read_ptr, buffer+top_index+1);
+            read_ptr = bottom_index;
+        }
 
-    // now everything should be OK to set
-    bottom_index = index;
+        // contiguous data which would be cut off are moved to the new bottom border
+        if(read_ptr < new_bottom || read_ptr+unread > new_top+1)
+        {
+            memmove(buffer+new_bottom, buffer+read_ptr, unread);
+            MarkWritten(new_bottom, unread);
+            read_ptr = new_bottom;
+        }
+    }
 
-    // make correction of other pointers
-    if(write_ptr < bottom_index)
-        write_ptr = bottom_index;
-    if(read_ptr < bottom_index)
-        read_ptr = bottom_index;
+    // now everything should be OK to set
+    bottom_index = new_bottom;
+    top_index = new_top;
+    write_ptr = AdvanceIndex(read_ptr, unread);
 
-    buffer_error_code = BUFFER_OK;
-    return buffer_error_code;
+    return BUFFER_OK;
 }
 
 CyclicBuffer::buffer_error CyclicBuffer::ReallocBuffer(unsigned int size)
+{
+    PolicyLock lock(*this);
+    return ReallocStorage(size);
+}
+
+CyclicBuffer::buffer_error CyclicBuffer::ReallocStorage(unsigned int size, bool relocate)
 {
     // check if size is natural number
     if(!size)
@@ -182,14 +774,27 @@ CyclicBuffer::buffer_error CyclicBuffer::ReallocBuffer(unsigned int size)
     }
 
     // if size is equal to current size, no special operations are needed
-    if(size==buffer_size)
+    if(size==buffer_size && !relocate)
     {
         buffer_error_code = BUFFER_OK;
         return buffer_error_code;
     }
 
+    // top border placed at the end of memory block follows the end of the new block
+    unsigned int highest_index = (size-1);
+    unsigned int new_top = (top_index==buffer_size-1 || top_index > highest_index) ? highest_index : top_index;
+    unsigned int new_bottom = bottom_index > new_top ? new_top : bottom_index;
+
+    // unread data must fit between new borders
+    if(used_bytes > (new_top-new_bottom)+1)
+    {
+        buffer_error_code = BUFFER_INCORRECT_SIZE;
+        return buffer_error_code;
+    }
+
     // try to allocate new block of memory for buffer
-    unsigned char * temp_buf_ptr = (unsigned char * )realloc(buffer, sizeof(unsigned char)*size);
+    bool temp_mirrored = mirror_requested;
+    unsigned char * temp_buf_ptr = AllocateStorage(size, temp_mirrored);
 
     if(temp_buf_ptr==NULL)
     {
@@ -198,48 +803,380 @@ CyclicBuffer::buffer_error CyclicBuffer::ReallocBuffer(unsigned int size)
         return buffer_error_code;
     }
 
-    // now the allocation was successful
+    // move unread data in order to the bottom border (even if they wrap), the rest is cleared
+    buffer_segments segments;
+    GetSegments(read_ptr, used_bytes, segments);
+
+    // bytes behind unread data are cleared lazily
+    memset(temp_buf_ptr, 0, new_bottom);
+    memcpy(temp_buf_ptr+new_bottom, segments.first, segments.first_length);
+    memcpy(temp_buf_ptr+new_bottom+segments.first_length, segments.second, segments.second_length);
+
+    // external memory is left to its owner, from now on the buffer owns its memory
+    if(!external_storage)
+        ReleaseStorage(buffer, buffer_size, mirrored_storage);
+    external_storage = false;
+
     buffer = temp_buf_ptr;
     buffer_size = size;
+    mirrored_storage = temp_mirrored;
+    valid_limit = new_bottom+used_bytes;
 
     // make correction on pointers/indexes
-    unsigned int highest_index = (buffer_size-1);
+    top_index = new_top;
+    bottom_index = new_bottom;
+    read_ptr = new_bottom;
+    write_ptr = AdvanceIndex(new_bottom, used_bytes);
+
+    // grown buffer may have room for blocked producers
+    NotifyProducers();
 
-    if(top_index > highest_index)
-        top_index = highest_index;
+    buffer_error_code = BUFFER_OK;
+    return buffer_error_code;
+}
 
-    if(bottom_index > highest_index)
-        bottom_index = highest_index;
+void CyclicBuffer::SetNotifier(BufferNotifier *buffer_notifier)
+{
+    PolicyLock lock(*this);
+    notifier = buffer_notifier;
+}
 
-    if(read_ptr > highest_index)
-        read_ptr = bottom_index;
+void CyclicBuffer::SetPushHook(buffer_push_hook hook, void *context)
+{
+    PolicyLock lock(*this);
+    push_hook = hook;
+    push_hook_context = context;
+}
+
+void CyclicBuffer::AcknowledgeNotification()
+{
+    if(notifier==NULL)
+        return;
+
+    notifier->Rearm();
+
+    // data pushed before arming would not be signalled by the producer
+    PolicyLock lock(*this);
+    buffer_segments segments;
+    GetSegments(read_ptr, used_bytes, segments);
+    notifier->Check(segments, used_bytes);
+}
+
+void CyclicBuffer::NotifyPushed(size_t length)
+{
+    // pushed bytes end at 'write_ptr'
+    buffer_segments segments;
+    GetSegments(AdvanceIndex(write_ptr, GetBufferSize()-length), length, segments);
+    if(notifier!=NULL)
+        notifier->Check(segments, used_bytes);
+    if(push_hook!=NULL)
+        push_hook(push_hook_context, segments, used_bytes);
+}
+
+CyclicBuffer::buffer_error CyclicBuffer::SampleOccupancy()
+{
+    PolicyLock lock(*this);
+
+    // close the sample
+    window[window_next].peak = sample_peak;
+    window[window_next].pushed = pushed_bytes-sample_pushed;
+    window_next = (window_next+1) % BUFFER_WINDOW_SAMPLES;
+    if(window_count < BUFFER_WINDOW_SAMPLES)
+        window_count++;
+
+    // occupancy carried over into the next sample
+    sample_peak = used_bytes;
+    sample_pushed = pushed_bytes;
+
+    if(!autosize_enabled)
+        return BUFFER_OK;
+
+    unsigned int capacity = GetBufferSize();
+    unsigned int new_capacity = capacity;
+
+    // grow if the latest samples are all above threshold
+    if(window_count >= autosize_policy.grow_samples && capacity < autosize_policy.max_capacity)
+    {
+        unsigned long long threshold = (unsigned long long)capacity*autosize_policy.grow_percent/100;
+        unsigned int i;
+        for(i=1; i<=autosize_policy.grow_samples; i++)
+        {
+            if(window[(window_next+BUFFER_WINDOW_SAMPLES-i) % BUFFER_WINDOW_SAMPLES].peak < threshold)
+                break;
+        }
+        if(i > autosize_policy.grow_samples)
+            new_capacity = capacity > autosize_policy.max_capacity/2 ? autosize_policy.max_capacity : capacity*2;
+    }
+
+    // shrink if the whole window is below threshold
+    if(new_capacity==capacity && window_count==BUFFER_WINDOW_SAMPLES && capacity > autosize_policy.min_capacity)
+    {
+        unsigned long long threshold = (unsigned long long)capacity*autosize_policy.shrink_percent/100;
+        unsigned int i;
+        for(i=0; i<BUFFER_WINDOW_SAMPLES; i++)
+        {
+            if(window[i].peak > threshold)
+                break;
+        }
+        if(i==BUFFER_WINDOW_SAMPLES)
+            new_capacity = capacity/2 < autosize_policy.min_capacity ? autosize_policy.min_capacity : capacity/2;
+    }
 
-    if(write_ptr > highest_index)
-        write_ptr = 0;
+    if(new_capacity==capacity)
+        return BUFFER_OK;
+
+    // if unread data do not fit yet, shrinking is tried again with the next sample
+    buffer_error error = ResizeCapacity(new_capacity);
+    if(error==BUFFER_FULL)
+        return BUFFER_OK;
+    if(error!=BUFFER_OK)
+        return error;
+
+    autosize_resizes++;
+    window_count = 0;
+    return BUFFER_OK;
+}
+
+//! Ratio of memory block size to capacity reserved by auto-sizing when it has to reallocate.
+static const unsigned int AUTOSIZE_HEADROOM = 4;
+
+CyclicBuffer::buffer_error CyclicBuffer::ResizeCapacity(unsigned int capacity)
+{
+    // data that do not fit are never dropped, shrinking waits for the consumer
+    if(used_bytes >= capacity)
+        return BUFFER_FULL;
+
+    // empty buffer can start at the bottom border, so it does not wrap
+    if(!used_bytes)
+        read_ptr = write_ptr = bottom_index;
+
+    unsigned long long new_top = (unsigned long long)bottom_index+capacity-1;
+    bool linear = !used_bytes || read_ptr < write_ptr;
+    unsigned int wrapped = used_bytes > (top_index-read_ptr)+1 ? used_bytes-((top_index-read_ptr)+1) : 0;
+
+    if(capacity > GetBufferSize() && new_top < buffer_size && wrapped <= new_top-top_index)
+    {
+        // grow in place, wrapped part of unread data is copied into added memory
+        MoveBorders(bottom_index, (unsigned int)new_top);
+    }
+    else if(capacity < GetBufferSize() && linear && write_ptr <= new_top+1)
+    {
+        // shrink in place, unread data do not wrap so top border may be moved anywhere above them
+        MoveBorders(bottom_index, (unsigned int)new_top);
+
+        // memory block much larger than needed is returned, keeping room for growth
+        if(buffer_size/(4*AUTOSIZE_HEADROOM) > new_top)
+        {
+            if(ReallocStorage(bottom_index+AUTOSIZE_HEADROOM*capacity)!=BUFFER_OK)
+                return buffer_error_code;
+            autosize_reallocations++;
+        }
+    }
+    else if(capacity < GetBufferSize())
+    {
+        // wrapped data are not moved just to shrink, consumer unwraps them soon
+        return BUFFER_FULL;
+    }
+    else
+    {
+        // growing reserves room for next growths, so they can be done without reallocation
+        unsigned long long size = (unsigned long long)bottom_index+(unsigned long long)AUTOSIZE_HEADROOM*capacity;
+        if(size > (unsigned long long)bottom_index+autosize_policy.max_capacity)
+            size = (unsigned long long)bottom_index+autosize_policy.max_capacity;
+        if(size < (unsigned long long)bottom_index+capacity)
+            size = (unsigned long long)bottom_index+capacity;
+        if(size > 0xFFFFFFFFull)
+            return BUFFER_INCORRECT_SIZE;
+
+        // block of the same size is replaced as well when wrapped data do not fit into added memory
+        if(ReallocStorage((unsigned int)size, true)!=BUFFER_OK)
+            return buffer_error_code;
+
+        // unread data are now at the bottom border
+        MoveBorders(bottom_index, bottom_index+capacity-1);
+        autosize_reallocations++;
+    }
+
+    NotifyProducers();
+    return BUFFER_OK;
+}
+
+void CyclicBuffer::GetTelemetry(buffer_telemetry &telemetry)
+{
+    PolicyLock lock(*this);
+
+    telemetry.capacity = GetBufferSize();
+    telemetry.high_water_mark = high_water_mark;
+    telemetry.window_peak = 0;
+    telemetry.window_pushed = 0;
+    telemetry.window_samples = window_count;
+    telemetry.resizes = autosize_resizes;
+    telemetry.reallocations = autosize_reallocations;
+
+    unsigned long long peak_sum = 0;
+    for(unsigned int i=1; i<=window_count; i++)
+    {
+        const occupancy_sample &sample = window[(window_next+BUFFER_WINDOW_SAMPLES-i) % BUFFER_WINDOW_SAMPLES];
+        if(sample.peak > telemetry.window_peak)
+            telemetry.window_peak = sample.peak;
+        telemetry.window_pushed += sample.pushed;
+        peak_sum += sample.peak;
+    }
+    telemetry.window_mean_peak = window_count ? (unsigned int)(peak_sum/window_count) : 0;
+}
+
+CyclicBuffer::buffer_error CyclicBuffer::SetAutoSizePolicy(const buffer_autosize_policy &policy)
+{
+    PolicyLock lock(*this);
+
+    if(!policy.min_capacity || policy.min_capacity > policy.max_capacity || !policy.grow_samples ||
+       policy.grow_samples > BUFFER_WINDOW_SAMPLES || policy.shrink_percent >= policy.grow_percent)
+    {
+        buffer_error_code = BUFFER_INCORRECT_SIZE;
+        return buffer_error_code;
+    }
+
+    autosize_policy = policy;
+    autosize_enabled = true;
+    window_count = 0;
 
     buffer_error_code = BUFFER_OK;
     return buffer_error_code;
 }
 
-void CyclicBuffer::ResetBuffer()
+void CyclicBuffer::ResetBuffer(bool immediate)
 {
+    PolicyLock lock(*this);
+
     top_index = buffer_size-1;
     read_ptr = write_ptr = bottom_index = 0;
+    used_bytes = 0;
+    CYCLICBUFFER_STATISTIC(RecordDiscard(0));
+
+    // whole memory block is never written now
+    if(immediate)
+    {
+        ClearRange(0, buffer_size);
+        valid_limit = buffer_size;
+    }
+    else
+        valid_limit = 0;
 
-    for(unsigned int i = 0; i <= top_index; i++)
-        buffer[i] = (unsigned char)NULL;
+    NotifyProducers();
 }
 
-void CyclicBuffer::ClearBuffer()
+void CyclicBuffer::ClearBuffer(bool immediate)
 {
-    for(unsigned int i=bottom_index; i<top_index; i++)
+    PolicyLock lock(*this);
+
+    // lowering the limit would clear also bytes above 'top_index', which must stay untouched
+    if(!immediate && (top_index==buffer_size-1 || valid_limit <= top_index+1))
     {
-        buffer[i] = (unsigned char)NULL;
+        if(valid_limit > bottom_index)
+            valid_limit = bottom_index;
     }
+    else if(bottom_index < valid_limit)
+        ClearRange(bottom_index, (top_index < valid_limit ? top_index+1 : valid_limit)-bottom_index);
+
+    // unread data are zeroed at once, they have to stay below the limit
+    buffer_segments segments;
+    GetSegments(read_ptr, used_bytes, segments);
+    MarkSegments(segments, false);
+}
+
+void CyclicBuffer::MarkSegments(const buffer_segments &segments, bool written)
+{
+    unsigned int index = (unsigned int)(segments.first-buffer);
+    size_t first = segments.first_length;
+
+    // region of mirrored memory behind the end of block continues at its beginning
+    if(index+first > buffer_size)
+    {
+        ExtendValid(0, (unsigned int)(index+first-buffer_size), !written);
+        first = buffer_size-index;
+    }
+
+    if(index+first > valid_limit)
+        ExtendValid(index, (unsigned int)(index+first), !written);
+
+    index = (unsigned int)(segments.second-buffer);
+    if(index+segments.second_length > valid_limit)
+        ExtendValid(index, (unsigned int)(index+segments.second_length), !written);
+}
+
+void CyclicBuffer::ExtendValid(unsigned int index, unsigned int end, bool clear_all)
+{
+    // bytes skipped between the limit and written region were never written
+    unsigned int clear_end = clear_all ? end : index;
+    if(clear_end > valid_limit)
+        ClearRange(valid_limit, clear_end-valid_limit);
+
+    if(end > valid_limit)
+        valid_limit = end;
+}
+
+unsigned int CyclicBuffer::UpdateCrc(unsigned int crc, const unsigned char * data, size_t length)
+{
+    static const unsigned char zeros[256] = { 0 };
+    unsigned int index = (unsigned int)(data-buffer);
+
+    while(length)
+    {
+        // region of mirrored memory behind the end of block continues at its beginning
+        if(index >= buffer_size)
+            index -= buffer_size;
+
+        size_t piece;
+        if(index < valid_limit)
+        {
+            piece = valid_limit-index < length ? valid_limit-index : length;
+            crc = Crc32cUpdate(crc, buffer+index, piece);
+        }
+        else
+        {
+            // query does not clear never written bytes, their value is known to be zero
+            piece = buffer_size-index < length ? buffer_size-index : length;
+            if(piece > sizeof(zeros))
+                piece = sizeof(zeros);
+            crc = Crc32cUpdate(crc, zeros, piece);
+        }
+        index += (unsigned int)piece;
+        length -= piece;
+    }
+    return crc;
+}
+
+//! Size of region from which clearing returns whole pages to the system instead of writing them.
+static const size_t CLEAR_MADVISE_THRESHOLD = 1 << 20;
+
+void CyclicBuffer::ClearRange(unsigned int index, size_t length)
+{
+    unsigned char * start = buffer+index;
+
+#if defined(__linux__)
+    // whole pages of large heap region are replaced by zero pages, only partial pages are written
+    long page_size = sysconf(_SC_PAGESIZE);
+    // external memory may be backed by huge pages, which must not be split
+    if(!mirrored_storage && !external_storage && length >= CLEAR_MADVISE_THRESHOLD && page_size > 0)
+    {
+        uintptr_t first_page = ((uintptr_t)start+(uintptr_t)page_size-1) & ~((uintptr_t)page_size-1);
+        uintptr_t last_page = ((uintptr_t)start+length) & ~((uintptr_t)page_size-1);
+        if(last_page > first_page && madvise((void *)first_page, last_page-first_page, MADV_DONTNEED)==0)
+        {
+            memset(start, 0, first_page-(uintptr_t)start);
+            memset((unsigned char *)last_page, 0, (uintptr_t)start+length-last_page);
+            return;
+        }
+    }
+#endif
+
+    memset(start, 0, length);
 }
 
 unsigned char CyclicBuffer::GetValueAt(unsigned int index, bool use_offset, bool look_outside_borders)
 {
+    PolicyLock lock(*this);
+
     unsigned int index_t = index;
 
     // make correction of index if needed
@@ -254,11 +1191,17 @@ unsigned char CyclicBuffer::GetValueAt(unsigned int index, bool use_offset, bool
     if(!look_outside_borders && (index_t>top_index || index_t<bottom_index))
         return (unsigned char)NULL;
 
+    // never written byte is not read from memory
+    if(index_t >= valid_limit)
+        return (unsigned char)NULL;
+
     return buffer[index_t];
 }
 
 CyclicBuffer::buffer_error CyclicBuffer::SetValueAt(unsigned int index, unsigned char value, bool use_offset, bool look_outside_borders)
 {
+    PolicyLock lock(*this);
+
     unsigned int index_t = index;
 
     // make correction of index if needed
@@ -273,7 +1216,68 @@ CyclicBuffer::buffer_error CyclicBuffer::SetValueAt(unsigned int index, unsigned
     if(!look_outside_borders && (index_t>top_index || index_t<bottom_index))
         return BUFFER_INDEX_OUT_OF_RANGE;
 
+    MarkWritten(index_t, 1);
     buffer[index_t] = value;
 
     return BUFFER_OK;
 }
+
+unsigned char * CyclicBuffer::AllocateStorage(unsigned int size, bool &mirrored)
+{
+#if defined(__linux__) && defined(SYS_memfd_create)
+    long page_size = sysconf(_SC_PAGESIZE);
+
+    // mirrored mapping is possible only for whole pages
+    if(mirrored && page_size > 0 && (size % (unsigned long)page_size)==0)
+    {
+        int fd = (int)syscall(SYS_memfd_create, "cyclicbuffer", 1u /* MFD_CLOEXEC */);
+        if(fd >= 0)
+        {
+            unsigned char * storage = NULL;
+
+            if(ftruncate(fd, (off_t)size)==0)
+            {
+                // reserve address space for both copies, then map the same file into each half
+                void * base = mmap(NULL, 2*(size_t)size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if(base!=MAP_FAILED)
+                {
+                    unsigned char * lower = (unsigned char *)base;
+                    if(mmap(lower, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0)!=MAP_FAILED &&
+                       mmap(lower+size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0)!=MAP_FAILED)
+                        storage = lower;
+                    else
+                        munmap(base, 2*(size_t)size);
+                }
+            }
+
+            close(fd);
+
+            if(storage!=NULL)
+                return storage;
+        }
+    }
+#endif
+
+    // fall back to ordinary heap memory
+    mirrored = false;
+    return new (std::nothrow) unsigned char[size];
+}
+
+void CyclicBuffer::ReleaseStorage(unsigned char * storage, unsigned int size, bool mirrored)
+{
+    if(storage==NULL)
+        return;
+
+#if defined(__linux__)
+    if(mirrored)
+    {
+        munmap(storage, 2*(size_t)size);
+        return;
+    }
+#else
+    (void)size;
+    (void)mirrored;
+#endif
+
+    delete [] storage;
+}
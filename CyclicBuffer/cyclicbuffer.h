@@ -22,6 +22,14 @@
 
 #include <cstdlib>
 #include <cstddef>
+#include <cstring>
+#include <mutex>
+#include <condition_variable>
+
+#include "buffercrc.h"
+#include "bufferstatistics.h"
+
+class BufferNotifier;
 
 class CyclicBuffer
 {
@@ -44,17 +52,97 @@ public:
         BUFFER_INDEX_COLLISION_GREATER = 6, /*! If user specify new bottom index greater than current top index */
         BUFFER_INCORRECT_SIZE = 7, /*!< Occures when user gives unallowed or 0 buffer size in reallocation function */
         BUFFER_INDEX_OUT_OF_RANGE = 8, /*!< Used when program request to set new value on index that is not present in range of indexes of bordered area or buffer memory block. */
+        BUFFER_FULL = 9, /*!< Returned when push is rejected because buffer is full and 'BUFFER_REJECT' overflow policy is selected. */
+        BUFFER_TIMEOUT = 10, /*!< Returned when push could not be finished in time with 'BUFFER_BLOCK' overflow policy. */
+        BUFFER_FILE_ERROR = 11, /*!< File or shared memory backing the buffer could not be opened, resized or mapped. */
+        BUFFER_INCOMPATIBLE = 12, /*!< Existing backing file or shared memory has unknown format, version or inconsistent header. */
+        BUFFER_END_OF_FILE = 13, /*!< Returned when file descriptor reached end of file (peer closed pipe, socket or terminal). */
+        BUFFER_TIMESTAMP_ORDER = 14, /*!< Returned when packet timestamp is older than timestamp of the previous packet. */
         BUFFER_UNDEFINED_ERROR = 999 /*!< If this value is present, program catched the error, but could not identify its source (also initial error code set up in constructor). */
     };
 
+    //! Enumeration of possible reactions on push into full buffer.
+    /*!
+      Selected policy is used by 'Push' and 'PushN' functions. Reservation functions
+      ('PrepareWrite', 'CommitWrite') never overwrite unread data nor block regardless of policy.
+     */
+    enum buffer_overflow_policy {
+        BUFFER_OVERWRITE_OLDEST = 0, /*!< Oldest unread bytes are overwritten, 'read_ptr' is moved and dropped bytes are counted (default). */
+        BUFFER_REJECT = 1, /*!< Block that does not fit into free space is not written at all and 'BUFFER_FULL' is reported. */
+        BUFFER_BLOCK = 2 /*!< Producer waits (with timeout) until consumer frees space. Buffer operations are then internally synchronized. */
+    };
+
+    //! Structure describing up to two contiguous regions of buffer memory.
+    /*!
+      Region of the cyclic buffer between two pointers may cross the 'top_index'
+      border. In that case the first segment ends at 'top_index' and the second one
+      starts at 'bottom_index'. If the region is contiguous, second segment is empty.
+     */
+    struct buffer_segments {
+        unsigned char * first; /*!< Pointer to the first contiguous region. */
+        size_t first_length; /*!< Number of bytes in the first region. */
+        unsigned char * second; /*!< Pointer to the second contiguous region (continuation after the wrap). */
+        size_t second_length; /*!< Number of bytes in the second region (0 if region does not wrap). */
+    };
+
+    //! Value returned by search functions if nothing was found.
+    static const size_t BUFFER_NOT_FOUND = (size_t)-1;
+
+    //! Number of samples kept in the sliding window of occupancy telemetry.
+    static const unsigned int BUFFER_WINDOW_SAMPLES = 16;
+
+    //! Occupancy telemetry returned by 'GetTelemetry'.
+    struct buffer_telemetry {
+        unsigned int capacity; /*!< Current buffer size ('GetBufferSize'). */
+        unsigned int high_water_mark; /*!< Highest occupancy since construction or 'ResetHighWaterMark'. */
+        unsigned int window_peak; /*!< Highest occupancy within the sliding window. */
+        unsigned int window_mean_peak; /*!< Mean of per-sample peaks within the sliding window. */
+        unsigned long long window_pushed; /*!< Bytes pushed within the sliding window (fill rate). */
+        unsigned int window_samples; /*!< Number of samples currently in the sliding window. */
+        unsigned long long resizes; /*!< Capacity changes made by auto-sizing. */
+        unsigned long long reallocations; /*!< Auto-sizing changes that needed new memory block. */
+    };
+
+    //! Rules of automatic capacity changes evaluated by 'SampleOccupancy'.
+    /*!
+      Capacity is doubled when the peak occupancy of the last 'grow_samples' samples stays
+      at or above 'grow_percent' of capacity, and halved when the peak occupancy of the whole
+      window stays at or below 'shrink_percent'. Capacity stays between 'min_capacity' and
+      'max_capacity'.
+     */
+    struct buffer_autosize_policy {
+        unsigned int min_capacity; /*!< Smallest capacity shrinking may reach. */
+        unsigned int max_capacity; /*!< Largest capacity growing may reach. */
+        unsigned int grow_percent; /*!< Occupancy threshold for growing, in percent of capacity. */
+        unsigned int grow_samples; /*!< Number of consecutive samples above threshold needed to grow (at most 'BUFFER_WINDOW_SAMPLES'). */
+        unsigned int shrink_percent; /*!< Occupancy threshold for shrinking, in percent of capacity. */
+    };
+
     //! Construcor of buffer class. Ensures basic initialization and memory allocation.
     /*!
      * \brief The constructor will initialize all internal pointers to zero and
      * allocates required memory for data storage.
      * \param buffer_size an integer number representing the buffer size in bytes.
      * \param success if memory was allocated successfully, the return value is 0, otherwise the error code.
+     * \param mirrored if true (Linux only), memory block is mapped twice back-to-back in virtual memory,
+     * so any readable or writable region is one contiguous range (see 'IsMirrored'). If the size is not
+     * multiple of page size or mapping fails, ordinary heap memory is used instead.
      */
-    CyclicBuffer(unsigned int buf_size, int &success);
+    CyclicBuffer(unsigned int buf_size, int &success, bool mirrored = false);
+
+    //! Constructor of buffer class using memory block provided by the caller.
+    /*!
+     * \brief Memory is not freed by the buffer and must outlive it (see 'CyclicBufferPool').
+     * If the buffer is reallocated ('ReallocBuffer', auto-sizing), new memory is allocated
+     * on heap and owned by the buffer, the provided block is left to the caller.
+     * \param storage Memory block of at least 'buf_size' bytes.
+     * \param buf_size Size of memory block in bytes.
+     * \param success BUFFER_OK, or BUFFER_INVALID_SIZE if block is missing or empty.
+     */
+    CyclicBuffer(unsigned char * storage, unsigned int buf_size, int &success);
+
+    //! Function returns true if buffer uses memory block provided by the caller.
+    bool IsExternalStorage(void) { return external_storage; }
 
     //! Destructor of buffer class. Deletes all buffered data and frees memory.
     /*!
@@ -66,10 +154,13 @@ public:
     //! Function is about to push new value to the buffer.
     /*!
      * \brief The function will write new character to the buffer while incrementing pointer from
-     * the lastly written character to the new empty place.
+     * the lastly written character to the new empty place. If the buffer is full, selected
+     * overflow policy is applied (see 'SetOverflowPolicy'). By default the oldest unread
+     * byte is overwritten and 'read_ptr' is moved to the next oldest one.
      * \param ch New value to be written into buffer.
+     * \return BUFFER_OK if value was written, BUFFER_FULL or BUFFER_TIMEOUT if it was not accepted because of overflow policy.
      */
-    void Push(unsigned char ch);
+    buffer_error Push(unsigned char ch);
 
     //! Function is about to retrieve the value from the buffer.
     /*!
@@ -79,6 +170,144 @@ public:
      */
     unsigned char Pop(void);
 
+    //! Function is about to push block of values to the buffer.
+    /*!
+     * \brief The function will copy up to 'length' bytes into the buffer with at most two
+     * memory copies (one up to 'top_index' and one from 'bottom_index' after the wrap).
+     * The 'write_ptr' is moved the same way as if 'Push' was called for every written byte.
+     * If data do not fit into free space, selected overflow policy decides: oldest unread
+     * bytes are dropped ('BUFFER_OVERWRITE_OLDEST'), nothing is written ('BUFFER_REJECT')
+     * or function waits for the consumer ('BUFFER_BLOCK').
+     * \param data Pointer to the values to be written into buffer.
+     * \param length Number of bytes requested to be written.
+     * \return Number of bytes stored in buffer: 'length', or 0 if block was rejected. With 'BUFFER_OVERWRITE_OLDEST',
+     * block longer than buffer size is stored without its oldest bytes, so buffer size is returned. If less than
+     * 'length', the reason is stored as the latest error code.
+     */
+    size_t PushN(const unsigned char * data, size_t length);
+
+    //! Function is about to retrieve block of values from the buffer.
+    /*!
+     * \brief This function will copy up to 'length' unread bytes from the buffer into 'data'
+     * with at most two memory copies. After the operation is done, 'read_ptr' is moved the
+     * same way as if 'Pop' was called for every retrieved byte.
+     * \param data Pointer to the memory where retrieved values will be stored.
+     * \param length Maximal number of bytes to be retrieved.
+     * \return Number of bytes really retrieved from buffer.
+     */
+    size_t PopN(unsigned char * data, size_t length);
+
+    //! Function reserves free space in the buffer for direct writing.
+    /*!
+     * \brief Instead of copying data through 'Push' calls, producer (e.g. serial port 'read()')
+     * can write directly into the buffer memory. This function returns up to two contiguous
+     * regions starting at 'write_ptr' that can be written without overwriting unread data.
+     * Written bytes become readable only after 'CommitWrite' is called. Regions are valid
+     * until next call changing pointers, indexes or buffer memory.
+     * \param segments Structure filled with writable regions.
+     * \param max_length Maximal number of bytes to be reserved.
+     * \return Total number of writable bytes in both regions.
+     */
+    size_t PrepareWrite(buffer_segments &segments, size_t max_length = (size_t)-1);
+
+    //! Function publishes bytes written into regions obtained by 'PrepareWrite'.
+    /*!
+     * \brief The 'write_ptr' is moved forward by 'length' bytes (wrapping at 'top_index').
+     * \param length Number of bytes written into reserved regions.
+     * \return Number of bytes really committed (never more than free space).
+     */
+    size_t CommitWrite(size_t length);
+
+    //! Function returns unread data of the buffer without copying them.
+    /*!
+     * \brief Consumer (e.g. packet parser) can scan bytes in place. This function returns up to
+     * two contiguous regions starting at 'read_ptr'. The 'read_ptr' is not moved, call 'ConsumeRead'
+     * to release the bytes. Regions are valid until next call changing pointers, indexes or buffer memory.
+     * \param segments Structure filled with readable regions.
+     * \param max_length Maximal number of bytes to be returned.
+     * \return Total number of readable bytes in both regions.
+     */
+    size_t PeekRead(buffer_segments &segments, size_t max_length = (size_t)-1);
+
+    //! Function releases bytes returned by 'PeekRead'.
+    /*!
+     * \brief The 'read_ptr' is moved forward by 'length' bytes (wrapping at 'top_index').
+     * \param length Number of bytes to be released.
+     * \return Number of bytes really released (never more than unread bytes).
+     */
+    size_t ConsumeRead(size_t length);
+
+    //! Function reads data from file descriptor directly into free space of the buffer.
+    /*!
+     * \brief Both free regions are passed to one 'readv' call, so bytes from serial port, pipe
+     * or socket cross the wrap point without temporary array. Unread data are never overwritten
+     * regardless of overflow policy (as with 'PrepareWrite' and 'CommitWrite'). Availible on POSIX systems.
+     * \param fd File descriptor to be read (may be non-blocking).
+     * \param transferred Number of bytes read into the buffer (0 if descriptor would block).
+     * \param max_length Maximal number of bytes to be read.
+     * \return BUFFER_OK, BUFFER_FULL if there is no free space, BUFFER_END_OF_FILE if descriptor
+     * reached end of file, or BUFFER_FILE_ERROR if 'readv' failed ('errno' is kept).
+     */
+    buffer_error FillFromFd(int fd, size_t &transferred, size_t max_length = (size_t)-1);
+
+    //! Function writes unread data directly from the buffer into file descriptor.
+    /*!
+     * \brief Both unread regions are passed to one 'writev' call (recording to file, relaying to
+     * socket). Written bytes are released as if they were popped. Availible on POSIX systems.
+     * \param fd File descriptor to be written (may be non-blocking).
+     * \param transferred Number of bytes written and released (0 if nothing to write or descriptor would block).
+     * \param max_length Maximal number of bytes to be written.
+     * \return BUFFER_OK, or BUFFER_FILE_ERROR if 'writev' failed ('errno' is kept).
+     */
+    buffer_error DrainToFd(int fd, size_t &transferred, size_t max_length = (size_t)-1);
+
+    //! Function searches unread data for the byte value.
+    /*!
+     * \brief Unread region between 'read_ptr' and 'write_ptr' is searched with vectorized
+     * instructions (AVX2 or SSE2 if CPU supports them). The wrap point is crossed correctly.
+     * This is much faster than calling 'GetValueAt' for every byte.
+     * \param value Byte to be found (e.g. packet terminator).
+     * \param from Offset from 'read_ptr' where the search starts.
+     * \return Offset of the found byte from 'read_ptr' or BUFFER_NOT_FOUND.
+     */
+    size_t Find(unsigned char value, size_t from = 0);
+
+    //! Function searches unread data for the sequence of bytes.
+    /*!
+     * \brief Works the same way as 'Find' for single byte, the sequence may be split by the wrap point.
+     * \param sequence Bytes to be found (e.g. sync word).
+     * \param length Length of the sequence.
+     * \param from Offset from 'read_ptr' where the search starts.
+     * \return Offset of the first byte of found sequence from 'read_ptr' or BUFFER_NOT_FOUND.
+     */
+    size_t Find(const unsigned char * sequence, size_t length, size_t from = 0);
+
+    //! Function computes CRC-32C over range of the buffer.
+    /*!
+     * \brief Range starts at buffer index 'index' and continues through 'top_index' to 'bottom_index'
+     * if needed, so packets crossing the wrap point are handled without copying. CRC is computed
+     * with SSE4.2 instruction if availible, otherwise with slicing-by-8 tables (see 'buffercrc.h').
+     * \param index Buffer index of the first byte (e.g. 'GetPopIndex()').
+     * \param length Number of bytes in range (at most 'GetBufferSize()').
+     * \param crc Computed CRC-32C value (initial value and final xor 0xFFFFFFFF).
+     * \return Error code if range is outside the borders, otherwise BUFFER_OK.
+     */
+    buffer_error ComputeCrc(unsigned int index, size_t length, unsigned int &crc);
+
+    //! Function enables or disables CRC computation of all pushed bytes.
+    /*!
+     * \brief When enabled, CRC-32C register is updated by every push or commit, so CRC
+     * of the stream is availible without reading the data again. Enabling resets the CRC.
+     * \param enable True to enable incremental CRC.
+     */
+    void EnableRunningCrc(bool enable) { running_crc_enabled = enable; running_crc = CRC32C_INITIAL; }
+
+    //! Function restarts incremental CRC computation (e.g. at the beginning of the packet).
+    void ResetRunningCrc(void) { running_crc = CRC32C_INITIAL; }
+
+    //! Function returns CRC-32C value of bytes pushed since enabling or resetting incremental CRC.
+    unsigned int GetRunningCrc(void) { return running_crc ^ CRC32C_FINAL_XOR; }
+
     //! Function will set new index for pop function.
     /*!
      * \brief This function will set new 'read_ptr' value so in next pop function call
@@ -105,9 +334,11 @@ public:
      * all new array and copying values. This function will move the top border of buffer
      * to desired position. Note that if new memory is added by shifting, new bytes will be
      * automatically zeroed. If some bytes are cut off, cut bytes are remaining untouched.
-     * Function will automatically modify 'read_ptr' and 'write_ptr' if they stay outside the range.
+     * Unread data are kept in order: if the border would cut them off or split them (wrapped
+     * data when memory is added), they are moved inside the new borders and pointers follow them.
      * \param index new index to be set into 'top_index'.
-     * \return If function correctly shifts the index, return value is BUFFER_OK, otherwise will return error code.
+     * \return If function correctly shifts the index, return value is BUFFER_OK, BUFFER_INCORRECT_SIZE
+     * if unread data do not fit between new borders, otherwise index error code.
      */
     buffer_error SetTopIndex(unsigned int index);
 
@@ -118,22 +349,25 @@ public:
      * all new array and copying values. This function will move the bottom border of buffer
      * to desired position. Note that if new memory is added by shifting, new bytes will be
      * automatically zeroed. If some bytes are cut off, cut bytes are remaining untouched.
-     * Function will automatically modify 'read_ptr' and 'write_ptr' if they stay outside the range.
+     * Unread data are kept in order: if the border would cut them off or split them (wrapped
+     * data when memory is added), they are moved inside the new borders and pointers follow them.
      * \param index new index to be set into 'bottom_index'.
-     * \return If function correctly shifts the index, return value is BUFFER_OK, otherwise will return error code.
+     * \return If function correctly shifts the index, return value is BUFFER_OK, BUFFER_INCORRECT_SIZE
+     * if unread data do not fit between new borders, otherwise index error code.
      */
     buffer_error SetBottomIndex(unsigned int index);
 
     //! Function will resize total memory block availible to buffer.
     /*!
      * \brief This realloc function ensures that the currently used memory block availible to buffer
-     * will be resized to desired size. Top and bottom indexes as well as read and write pointers
-     * will be updated automatically. If size is less than top or bottom indexes, these are set
-     * to maximal availible index in new memory block. If size is less than read or write pointer
-     * indexes, those will be automatically set back to smallest index possible. Top and bottom borders
-     * are updated firstly.
+     * will be resized to desired size. Unread data are preserved in order (even if they wrap) and moved
+     * to the bottom border, so read pointer is set to bottom border and write pointer just behind
+     * the unread data. The rest of the new memory block is cleared. Top border placed at the end
+     * of memory block follows the end of the new block, otherwise it is kept. If size is less than
+     * top or bottom indexes, these are set to maximal availible index in new memory block.
      * \param size contains new desired size for buffer memory block
-     * \return The return value is error code if allocation problems occures or BUFFER_OK otherwise.
+     * \return The return value is error code if allocation problems occures, BUFFER_INCORRECT_SIZE if
+     * size is 0 or unread data would not fit between new borders, or BUFFER_OK otherwise.
      */
     buffer_error ReallocBuffer(unsigned int size);
 
@@ -143,15 +377,21 @@ public:
      * indexes is needed (e.g. after 'ReallocBuffer' function). It will set maximal/minimal
      * indexes (borders of memory block), read and write pointers to fit currently availible
      * memory block. Function will also put all bytes to zero.
+     * \param immediate If false (default), bytes are cleared lazily in constant time: memory is
+     * marked as never written and zeroed only when pushing reaches it. If true, memory is zeroed
+     * at once (large regions are returned to the system by 'madvise').
      */
-    void ResetBuffer(void);
+    void ResetBuffer(bool immediate = false);
 
     //! Function will clear the buffer.
     /*!
      * \brief This function will replace all availible values in buffer with NULL
      * character. Note that only indexes from 'bottom_index' to 'top_index' are cleared.
+     * Pointers are not moved, unread bytes are read as NULL characters.
+     * \param immediate If false (default), bytes above unread data are cleared lazily (see 'ResetBuffer')
+     * when borders allow it. If true, memory is zeroed at once.
      */
-    void ClearBuffer(void);
+    void ClearBuffer(bool immediate = false);
 
     //! Function will return value at index specified.
     /*!
@@ -218,6 +458,23 @@ public:
      */
     unsigned int GetPushIndex(void) { return write_ptr; }
 
+    //! Function returns the number of bytes waiting for reading.
+    /*!
+     * \brief Occupancy of the buffer is tracked on every push and pop, so this function
+     * does not need to compute anything from pointer positions.
+     * \return Number of unread bytes.
+     */
+    unsigned int Available(void) { PolicyLock lock(*this); return used_bytes; }
+
+    //! Function returns the number of bytes that can be pushed without overwriting unread data.
+    unsigned int FreeSpace(void) { return GetBufferSize()-used_bytes; }
+
+    //! Function returns true if there is nothing to read.
+    bool IsEmpty(void) { return used_bytes==0; }
+
+    //! Function returns true if next push will overwrite unread data.
+    bool IsFull(void) { return used_bytes==GetBufferSize(); }
+
     //! Function will return the smallest index of buffer memory array currently in use.
     /*!
      * \brief Buffer can be set up so not all availible allocated memory is being used.
@@ -236,6 +493,112 @@ public:
      */
     unsigned int GetTopIndex(void) { return top_index; }
 
+    //! Function selects the reaction on push into full buffer.
+    /*!
+     * \brief With 'BUFFER_BLOCK' policy, producer and consumer may run in different threads,
+     * since push, pop, reservation, peek, index setting and reset functions are then synchronized by internal mutex.
+     * Policy should be selected before the buffer is shared between threads.
+     * \param policy New overflow policy.
+     * \param timeout_ms Maximal time in milliseconds the producer waits for space with 'BUFFER_BLOCK' policy (0 waits forever).
+     */
+    void SetOverflowPolicy(buffer_overflow_policy policy, unsigned int timeout_ms = 0) { overflow_policy = policy; block_timeout_ms = timeout_ms; }
+
+    //! Function returns currently selected overflow policy.
+    buffer_overflow_policy GetOverflowPolicy(void) { return overflow_policy; }
+
+    //! Function returns the number of unread bytes lost by 'BUFFER_OVERWRITE_OLDEST' policy.
+    unsigned long long GetDroppedBytes(void) { return dropped_bytes; }
+
+    //! Function returns the latest error code caught by buffer functions.
+    buffer_error GetLastError(void) { return buffer_error_code; }
+
+    //! Function attaches readiness notifier signalled by pushes (NULL detaches it).
+    /*!
+     * \brief Notifier should be attached before the buffer is shared between threads and must
+     * outlive the buffer or be detached. Buffer shared between threads needs 'BUFFER_BLOCK' policy.
+     * \param buffer_notifier Notifier whose descriptor becomes readable when buffer is ready (see 'BufferNotifier').
+     */
+    void SetNotifier(BufferNotifier * buffer_notifier);
+
+    //! Function acknowledges notification after consumer has read the data (consumer side).
+    /*!
+     * \brief Descriptor of the notifier is cleared and notifier is armed again. If unread data
+     * still satisfy its condition, descriptor becomes readable at once.
+     */
+    void AcknowledgeNotification(void);
+
+    //! Function called by the buffer after bytes were pushed or committed (see 'SetPushHook').
+    /*!
+     * \param context Pointer given to 'SetPushHook'.
+     * \param pushed Bytes just pushed.
+     * \param available Number of unread bytes including the pushed ones.
+     */
+    typedef void (*buffer_push_hook)(void * context, const buffer_segments &pushed, size_t available);
+
+    //! Function attaches function called after every push (NULL detaches it).
+    /*!
+     * \brief Hook runs in the producer thread inside the push function (with internal mutex locked
+     * if 'BUFFER_BLOCK' policy is selected), so it must not call functions of the buffer. It is meant
+     * to wake up or schedule the consumer (see 'AsyncCyclicBuffer').
+     * \param hook Function to be called.
+     * \param context Pointer passed to the hook.
+     */
+    void SetPushHook(buffer_push_hook hook, void * context);
+
+    //! Function closes one sample of occupancy telemetry and applies auto-sizing policy.
+    /*!
+     * \brief Function should be called periodically (e.g. from the timer of the receiving thread).
+     * Peak occupancy and number of pushed bytes since the previous call are stored into sliding
+     * window of 'BUFFER_WINDOW_SAMPLES' samples. If auto-sizing is enabled, capacity is changed
+     * by moving the top border ('SetTopIndex') within the allocated memory block. Memory block is
+     * reallocated (with room for further growth) only if it is too small for the new capacity, or
+     * returned if it is much larger than needed. Shrinking is postponed while unread data wrap or
+     * do not fit. After every capacity change the window is cleared.
+     * \return BUFFER_OK, or error code of failed reallocation.
+     */
+    buffer_error SampleOccupancy(void);
+
+    //! Function fills 'telemetry' with current occupancy statistics.
+    void GetTelemetry(buffer_telemetry &telemetry);
+
+    //! Function sets high-water mark to current occupancy.
+    void ResetHighWaterMark(void) { high_water_mark = used_bytes; }
+
+#if defined(CYCLICBUFFER_STATISTICS)
+    //! Function copies traffic statistics (may be called from any thread).
+    /*!
+     * \brief Available only if built with 'CYCLICBUFFER_STATISTICS' defined.
+     */
+    void GetStatistics(BufferStatistics::statistics_snapshot &snapshot) const { statistics.Snapshot(snapshot); }
+
+    //! Function sets all traffic statistics to zero.
+    void ResetStatistics(void) { PolicyLock lock(*this); statistics.Reset(); }
+
+    //! Function sets minimal distance (in bytes) of two pushed bytes whose latency is measured.
+    void SetLatencyMarkInterval(unsigned int interval) { PolicyLock lock(*this); statistics.SetMarkInterval(interval); }
+#endif
+
+    //! Function enables auto-sizing with given policy (see 'buffer_autosize_policy').
+    /*!
+     * \return BUFFER_INCORRECT_SIZE if limits or thresholds are inconsistent, otherwise BUFFER_OK.
+     */
+    buffer_error SetAutoSizePolicy(const buffer_autosize_policy &policy);
+
+    //! Function disables auto-sizing, telemetry is still collected.
+    void DisableAutoSize(void) { autosize_enabled = false; }
+
+    //! Function returns true if auto-sizing is enabled.
+    bool IsAutoSizeEnabled(void) { return autosize_enabled; }
+
+    //! Function returns true if buffer regions are always contiguous.
+    /*!
+     * \brief If buffer memory block is mirrored in virtual memory and buffer borders cover the whole
+     * memory block, regions returned by 'PrepareWrite' and 'PeekRead' never wrap, since bytes after the
+     * end of memory block are the same bytes as at its beginning. Second segment is then always empty.
+     * \return True if mirrored memory is in use and borders are not shifted.
+     */
+    bool IsMirrored(void) { return mirrored_storage && bottom_index==0 && top_index==buffer_size-1; }
+
     //! Function is the same as 'Push' function.
     void operator<<(unsigned char ch) { Push(ch); }
 
@@ -244,6 +607,120 @@ public:
 
 private:
 
+    //! Function sets all members to the state of buffer without memory (used by constructors).
+    void InitializeMembers(void);
+
+    //! Function computes 'used_bytes' from positions of 'read_ptr' and 'write_ptr'.
+    /*!
+     * \brief This function is called when user moves one of the pointers ('SetPopIndex',
+     * 'SetPushIndex'). If both pointers point to the same byte, buffer is considered to be empty.
+     */
+    void RecountUsedBytes(void);
+
+    //! Function moves both borders keeping unread data (see 'SetTopIndex').
+    /*!
+     * \brief Indexes must be already checked against memory block.
+     * \return BUFFER_OK, or BUFFER_INCORRECT_SIZE if unread data do not fit between new borders.
+     */
+    buffer_error MoveBorders(unsigned int new_bottom, unsigned int new_top);
+
+    //! Function searches 'segments' for 'value' starting at offset 'from'.
+    static size_t FindInSegments(const buffer_segments &segments, unsigned char value, size_t from);
+
+    //! Function copies up to 'length' bytes into free space without applying overflow policy or locking.
+    size_t WriteFree(const unsigned char * data, size_t length);
+
+    //! Function implements 'PushN' for 'BUFFER_BLOCK' policy.
+    size_t PushBlocking(const unsigned char * data, size_t length);
+
+    //! Function implements 'ReallocBuffer' without locking.
+    /*!
+     * \param relocate If true, memory block is replaced even if its size does not change, so unread
+     * data are copied in order to the bottom border.
+     */
+    buffer_error ReallocStorage(unsigned int size, bool relocate = false);
+
+    //! Function changes capacity to 'capacity' bytes keeping unread data (lock must be held).
+    /*!
+     * \return BUFFER_OK if capacity was changed, BUFFER_FULL if unread data do not fit into
+     * new capacity, or error code of failed reallocation.
+     */
+    buffer_error ResizeCapacity(unsigned int capacity);
+
+    //! Function updates telemetry after bytes were pushed.
+    void RecordPush(size_t length)
+    {
+        pushed_bytes += length;
+        if(used_bytes > sample_peak)
+        {
+            sample_peak = used_bytes;
+            if(used_bytes > high_water_mark)
+                high_water_mark = used_bytes;
+        }
+#if defined(CYCLICBUFFER_STATISTICS)
+        statistics.RecordPush(length, used_bytes);
+#endif
+        if(notifier!=NULL || push_hook!=NULL)
+            NotifyPushed(length);
+    }
+
+    //! Function passes bytes just pushed (ending at 'write_ptr') to the notifier and push hook.
+    void NotifyPushed(size_t length);
+
+    //! Function marks 'length' bytes written at 'index', clearing skipped never written bytes.
+    void MarkWritten(unsigned int index, size_t length)
+    {
+        if(index+length > valid_limit)
+            ExtendValid(index, (unsigned int)(index+length), false);
+    }
+
+    //! Function marks regions of 'segments' as written, or clears their never written bytes ('written' false).
+    void MarkSegments(const buffer_segments &segments, bool written);
+
+    //! Function continues CRC register over buffer memory, never written bytes are taken as zeros without touching them.
+    unsigned int UpdateCrc(unsigned int crc, const unsigned char * data, size_t length);
+
+    //! Function moves 'valid_limit' up to 'end', zeroing bytes below 'index' (or below 'end' if 'clear_all' is true).
+    void ExtendValid(unsigned int index, unsigned int end, bool clear_all);
+
+    //! Function zeroes 'length' bytes of memory block at 'index' (large heap regions by 'madvise').
+    void ClearRange(unsigned int index, size_t length);
+
+    //! Function wakes up producers waiting for free space (if there are any).
+    void NotifyProducers(void) { if(blocked_producers) space_freed.notify_all(); }
+
+    //! Lock held by public functions while 'BUFFER_BLOCK' policy is selected.
+    /*!
+      With other policies the buffer is not synchronized and lock does nothing.
+     */
+    class PolicyLock
+    {
+    public:
+        PolicyLock(CyclicBuffer &buf) : mutex(buf.overflow_policy==BUFFER_BLOCK ? &buf.policy_mutex : NULL) { if(mutex) mutex->lock(); }
+        ~PolicyLock(void) { if(mutex) mutex->unlock(); }
+    private:
+        std::mutex * mutex;
+    };
+
+    //! Function fills segments describing 'length' bytes starting at buffer index 'index'.
+    void GetSegments(unsigned int index, size_t length, buffer_segments &segments);
+
+    //! Function returns buffer index 'length' bytes after 'index' (wrapping at 'top_index').
+    unsigned int AdvanceIndex(unsigned int index, size_t length);
+
+    //! Function allocates memory block for buffer.
+    /*!
+     * \brief If mirrored memory is requested and possible, the block of 'size' bytes is mapped
+     * twice back-to-back, otherwise it is allocated on heap.
+     * \param size Size of memory block in bytes.
+     * \param mirrored Requests mirrored mapping, on return contains true if mirrored mapping was really used.
+     * \return Pointer to memory block or NULL if allocation failed.
+     */
+    static unsigned char * AllocateStorage(unsigned int size, bool &mirrored);
+
+    //! Function frees memory block allocated by 'AllocateStorage'.
+    static void ReleaseStorage(unsigned char * storage, unsigned int size, bool mirrored);
+
     //! Variable which stores the latest error code availible.
     /*!
       This variable is storing the latest error code catched by some of the
@@ -259,6 +736,15 @@ private:
      */
     unsigned char * buffer;
 
+    //! True if 'buffer' is mapped twice back-to-back in virtual memory.
+    bool mirrored_storage;
+
+    //! True if user requested mirrored memory in constructor (used also when reallocating).
+    bool mirror_requested;
+
+    //! True if 'buffer' is owned by the caller and is not freed.
+    bool external_storage;
+
     //! Variable for total amount of bytes availible.
     /*!
       This variable stores the total number of bytes currently availible in memory
@@ -299,6 +785,99 @@ private:
      */
     unsigned int read_ptr;
 
+    //! Number of bytes that were pushed but not read yet.
+    /*!
+      Since 'read_ptr' equal to 'write_ptr' can mean both empty and full buffer,
+      the occupancy is tracked explicitly. It is updated by every push and pop
+      and recomputed whenever pointers or borders are moved.
+     */
+    unsigned int used_bytes;
+
+    //! Index of memory block above which no byte was written since the last clearing.
+    /*!
+      Bytes at and above this index are read as NULL characters, whatever the memory
+      holds, so clearing of the buffer only lowers the limit. Writes beyond the limit
+      first zero the skipped bytes and then raise it. Unread data are always below it.
+     */
+    unsigned int valid_limit;
+
+    //! Reaction on push into full buffer.
+    buffer_overflow_policy overflow_policy;
+
+    //! Maximal time the producer waits for free space with 'BUFFER_BLOCK' policy (0 means forever).
+    unsigned int block_timeout_ms;
+
+    //! Number of unread bytes overwritten (or never stored) because of full buffer.
+    unsigned long long dropped_bytes;
+
+    //! Mutex synchronizing buffer operations with 'BUFFER_BLOCK' policy.
+    std::mutex policy_mutex;
+
+    //! Condition signalled by consumer when space is freed.
+    std::condition_variable space_freed;
+
+    //! Number of producers waiting on 'space_freed' condition.
+    unsigned int blocked_producers;
+
+    //! True if CRC of pushed bytes is computed incrementally.
+    bool running_crc_enabled;
+
+    //! CRC-32C register of bytes pushed since enabling or resetting incremental CRC.
+    unsigned int running_crc;
+
+    //! Total number of bytes pushed into buffer.
+    unsigned long long pushed_bytes;
+
+    //! Highest occupancy since construction or 'ResetHighWaterMark'.
+    unsigned int high_water_mark;
+
+    //! Highest occupancy since the last call of 'SampleOccupancy'.
+    unsigned int sample_peak;
+
+    //! Value of 'pushed_bytes' at the last call of 'SampleOccupancy'.
+    unsigned long long sample_pushed;
+
+    //! One closed sample of the sliding window.
+    struct occupancy_sample {
+        unsigned int peak; /*!< Highest occupancy during the sample. */
+        unsigned long long pushed; /*!< Bytes pushed during the sample. */
+    };
+
+    //! Sliding window of samples, used cyclically.
+    occupancy_sample window[BUFFER_WINDOW_SAMPLES];
+
+    //! Index in 'window' where the next sample is stored.
+    unsigned int window_next;
+
+    //! Number of valid samples in 'window'.
+    unsigned int window_count;
+
+    //! True if 'SampleOccupancy' changes capacity.
+    bool autosize_enabled;
+
+    //! Rules of auto-sizing.
+    buffer_autosize_policy autosize_policy;
+
+    //! Number of capacity changes made by auto-sizing.
+    unsigned long long autosize_resizes;
+
+    //! Number of auto-sizing changes that needed new memory block.
+    unsigned long long autosize_reallocations;
+
+    //! Readiness notifier or NULL.
+    BufferNotifier * notifier;
+
+    //! Function called after pushes or NULL.
+    buffer_push_hook push_hook;
+
+    //! Context passed to 'push_hook'.
+    void * push_hook_context;
+
+#if defined(CYCLICBUFFER_STATISTICS)
+    //! Traffic counters and latency histogram.
+    BufferStatistics statistics;
+#endif
+
 };
 
 #endif // CYCLICBUFFER_H
@@ -0,0 +1,303 @@
+#include "cyclicbufferpool.h"
+
+#include <new>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define POOL_LINUX
+#endif
+
+//! Memory policy preferring one node (value of Linux 'MPOL_PREFERRED', libnuma is not required).
+static const int POOL_MPOL_PREFERRED = 1;
+
+//! Number of NUMA nodes the pool is able to bind to.
+static const int POOL_MAX_NUMA_NODES = 1024;
+
+//! Function rounds 'value' up to multiple of 'granularity'.
+static size_t RoundUp(size_t value, size_t granularity)
+{
+    return ((value+granularity-1)/granularity)*granularity;
+}
+
+CyclicBufferPool::CyclicBufferPool(size_t size, pool_page_mode mode, int &success)
+    : arena(NULL), arena_allocation(NULL), allocation_size(0), arena_size(0), arena_next(0), page_granularity(POOL_CACHE_LINE_SIZE),
+      page_mode(POOL_NORMAL_PAGES), arena_mapped(false), used_bytes(0), bind_failures(0)
+{
+    if(size==0)
+    {
+        success = CyclicBuffer::BUFFER_INVALID_SIZE;
+        return;
+    }
+
+    if(!MapArena(size, mode))
+    {
+        success = CyclicBuffer::BUFFER_ALLOCATION_ERROR;
+        return;
+    }
+
+    success = CyclicBuffer::BUFFER_OK;
+}
+
+CyclicBufferPool::~CyclicBufferPool()
+{
+    for(std::map<CyclicBuffer*, pool_block>::iterator it = used_blocks.begin(); it!=used_blocks.end(); ++it)
+        delete it->first;
+
+#if defined(POOL_LINUX)
+    if(arena_mapped)
+    {
+        munmap(arena_allocation, allocation_size);
+        return;
+    }
+#endif
+    delete [] arena_allocation;
+}
+
+bool CyclicBufferPool::MapArena(size_t size, pool_page_mode mode)
+{
+#if defined(POOL_LINUX)
+    long page_size = sysconf(_SC_PAGESIZE);
+    if(page_size <= 0)
+        page_size = 4096;
+
+#if defined(MAP_HUGETLB)
+    if(mode==POOL_EXPLICIT_HUGE_PAGES)
+    {
+        size_t length = RoundUp(size, POOL_HUGE_PAGE_SIZE);
+        void * memory = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if(memory!=MAP_FAILED)
+        {
+            arena = arena_allocation = (unsigned char *)memory;
+            allocation_size = arena_size = length;
+            page_granularity = POOL_HUGE_PAGE_SIZE;
+            page_mode = POOL_EXPLICIT_HUGE_PAGES;
+            arena_mapped = true;
+            return true;
+        }
+    }
+#endif
+
+    if(mode!=POOL_NORMAL_PAGES)
+    {
+        // no huge pages are reserved, arena aligned to huge page can still get transparent ones
+        size_t length = RoundUp(size, POOL_HUGE_PAGE_SIZE);
+        void * memory = mmap(NULL, length+POOL_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(memory==MAP_FAILED)
+            return false;
+
+        // unmap the parts before and behind the aligned arena
+        unsigned char * start = (unsigned char *)memory;
+        unsigned char * aligned = (unsigned char *)RoundUp((size_t)start, POOL_HUGE_PAGE_SIZE);
+        if(aligned!=start)
+            munmap(start, aligned-start);
+        if((size_t)(aligned-start)!=POOL_HUGE_PAGE_SIZE)
+            munmap(aligned+length, POOL_HUGE_PAGE_SIZE-(aligned-start));
+
+        arena = arena_allocation = aligned;
+        allocation_size = arena_size = length;
+        arena_mapped = true;
+        page_granularity = (size_t)page_size;
+        page_mode = POOL_NORMAL_PAGES;
+
+#if defined(MADV_HUGEPAGE)
+        if(madvise(arena, arena_size, MADV_HUGEPAGE)==0)
+        {
+            page_granularity = POOL_HUGE_PAGE_SIZE;
+            page_mode = POOL_TRANSPARENT_HUGE_PAGES;
+        }
+#endif
+        return true;
+    }
+
+    size_t length = RoundUp(size, (size_t)page_size);
+    void * memory = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(memory==MAP_FAILED)
+        return false;
+
+    arena = arena_allocation = (unsigned char *)memory;
+    allocation_size = arena_size = length;
+    page_granularity = (size_t)page_size;
+    page_mode = POOL_NORMAL_PAGES;
+    arena_mapped = true;
+    return true;
+#else
+    (void)mode;
+
+    // heap block aligned to cache line, pages of default size
+    size_t length = RoundUp(size, POOL_CACHE_LINE_SIZE);
+    arena_allocation = new (std::nothrow) unsigned char[length+POOL_CACHE_LINE_SIZE];
+    if(arena_allocation==NULL)
+        return false;
+
+    allocation_size = length+POOL_CACHE_LINE_SIZE;
+    arena = (unsigned char *)RoundUp((size_t)arena_allocation, POOL_CACHE_LINE_SIZE);
+    arena_size = length;
+    page_granularity = POOL_CACHE_LINE_SIZE;
+    page_mode = POOL_NORMAL_PAGES;
+    return true;
+#endif
+}
+
+CyclicBuffer * CyclicBufferPool::Acquire(unsigned int buf_size, int &success, int numa_node)
+{
+    if(buf_size==0)
+    {
+        success = CyclicBuffer::BUFFER_INVALID_SIZE;
+        return NULL;
+    }
+
+    if(numa_node < 0)
+        numa_node = -1;
+
+    // block size keeps the next block aligned to cache line too
+    size_t size = RoundUp(buf_size, POOL_CACHE_LINE_SIZE);
+    std::pair<size_t, int> key(size, numa_node);
+
+    std::lock_guard<std::mutex> lock(pool_mutex);
+
+    size_t offset;
+    std::map<std::pair<size_t, int>, std::vector<size_t> >::iterator recycled = free_blocks.find(key);
+    if(recycled!=free_blocks.end() && !recycled->second.empty())
+    {
+        offset = recycled->second.back();
+        recycled->second.pop_back();
+    }
+    else if(!CarveBlock(size, numa_node, offset))
+    {
+        success = CyclicBuffer::BUFFER_ALLOCATION_ERROR;
+        return NULL;
+    }
+
+    CyclicBuffer * buffer = new (std::nothrow) CyclicBuffer(arena+offset, buf_size, success);
+    if(buffer==NULL || success!=CyclicBuffer::BUFFER_OK)
+    {
+        delete buffer;
+        free_blocks[key].push_back(offset);
+        success = CyclicBuffer::BUFFER_ALLOCATION_ERROR;
+        return NULL;
+    }
+
+    pool_block block;
+    block.offset = offset;
+    block.size = size;
+    block.node = numa_node;
+    used_blocks[buffer] = block;
+    used_bytes += size;
+
+    return buffer;
+}
+
+void CyclicBufferPool::Release(CyclicBuffer *buffer)
+{
+    if(buffer==NULL)
+        return;
+
+    std::lock_guard<std::mutex> lock(pool_mutex);
+
+    std::map<CyclicBuffer*, pool_block>::iterator it = used_blocks.find(buffer);
+    if(it==used_blocks.end())
+        return;
+
+    // memory stays mapped (and resident), next ring of the same size and node reuses it
+    pool_block block = it->second;
+    used_blocks.erase(it);
+    delete buffer;
+
+    free_blocks[std::make_pair(block.size, block.node)].push_back(block.offset);
+    used_bytes -= block.size;
+}
+
+bool CyclicBufferPool::CarveBlock(size_t size, int node, size_t &offset)
+{
+    if(node < 0)
+    {
+        if(arena_size-arena_next < size)
+            return false;
+
+        offset = arena_next;
+        arena_next += size;
+        return true;
+    }
+
+    std::map<int, pool_chunk>::iterator it = node_chunks.find(node);
+    if(it!=node_chunks.end() && it->second.end-it->second.next >= size)
+    {
+        offset = it->second.next;
+        it->second.next += size;
+        return true;
+    }
+
+    // new chunk of whole pages, rest of the previous chunk of this node stays unused
+    size_t start = RoundUp(arena_next, page_granularity);
+    size_t chunk_size = RoundUp(size, page_granularity);
+    if(start > arena_size || arena_size-start < chunk_size)
+        return false;
+
+    arena_next = start+chunk_size;
+    if(!BindToNode(arena+start, chunk_size, node))
+        bind_failures++;
+
+    pool_chunk chunk;
+    chunk.next = start+size;
+    chunk.end = start+chunk_size;
+    node_chunks[node] = chunk;
+
+    offset = start;
+    return true;
+}
+
+bool CyclicBufferPool::BindToNode(unsigned char *memory, size_t length, int node)
+{
+#if defined(POOL_LINUX) && defined(SYS_mbind)
+    if(node >= POOL_MAX_NUMA_NODES)
+        return false;
+
+    const int bits = 8*sizeof(unsigned long);
+    unsigned long mask[POOL_MAX_NUMA_NODES/(8*sizeof(unsigned long))] = { 0 };
+    mask[node/bits] |= 1UL << (node%bits);
+
+    // chunk is not touched yet, so its pages are allocated on the node when they are first written
+    return syscall(SYS_mbind, memory, length, POOL_MPOL_PREFERRED, mask, (unsigned long)POOL_MAX_NUMA_NODES+1, 0)==0;
+#else
+    (void)memory;
+    (void)length;
+    (void)node;
+    return false;
+#endif
+}
+
+int CyclicBufferPool::CurrentNumaNode()
+{
+#if defined(POOL_LINUX) && defined(SYS_getcpu)
+    unsigned int cpu, node;
+    if(syscall(SYS_getcpu, &cpu, &node, NULL)==0)
+        return (int)node;
+#endif
+    return 0;
+}
+
+size_t CyclicBufferPool::GetUsedBytes()
+{
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    return used_bytes;
+}
+
+size_t CyclicBufferPool::GetRemainingBytes()
+{
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    return arena_size-arena_next;
+}
+
+size_t CyclicBufferPool::GetBufferCount()
+{
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    return used_blocks.size();
+}
+
+unsigned long long CyclicBufferPool::GetBindFailures()
+{
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    return bind_failures;
+}
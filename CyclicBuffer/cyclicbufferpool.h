@@ -0,0 +1,176 @@
+/*
+ * Author:      Peter Mikula
+ * Date:        10. 10. 2015
+ * Version:     0.1.1
+ *
+ */
+
+//! Pool of cyclic buffers carved out of one memory arena.
+/*!
+  Receiver handling hundreds of sensors keeps one ring per sensor. Allocating
+  every ring separately scatters them over the heap and over small pages, so
+  round-robin traffic over all rings pays a TLB miss on almost every access.
+  The pool maps one arena (backed by transparent or explicit huge pages where
+  possible) and places rings into it side by side, each one aligned to the
+  cache line, so neighbouring rings never share a line.
+
+  Ring can be bound to a NUMA node (typically the node of its consumer
+  thread, see 'CurrentNumaNode'). Rings of one node are carved from arena
+  chunks of whole (huge) pages bound to that node, so binding never splits
+  a huge page. Released rings return their memory to a free list of the pool
+  and the same block is reused by the next ring of the same size and node,
+  memory is returned to the system only when the pool is destroyed.
+  */
+
+#ifndef CYCLICBUFFERPOOL_H
+#define CYCLICBUFFERPOOL_H
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "cyclicbuffer.h"
+
+//! Alignment of ring memory blocks (size of cache line).
+#define POOL_CACHE_LINE_SIZE 64
+
+//! Size of huge page used for the arena.
+#define POOL_HUGE_PAGE_SIZE (2u << 20)
+
+class CyclicBufferPool
+{
+
+public:
+
+    //! Kind of pages backing the arena.
+    enum pool_page_mode {
+        POOL_NORMAL_PAGES = 0, /*!< Arena uses pages of default size. */
+        POOL_TRANSPARENT_HUGE_PAGES = 1, /*!< Arena is aligned to huge page and kernel is advised to back it by transparent huge pages. */
+        POOL_EXPLICIT_HUGE_PAGES = 2 /*!< Arena is mapped from reserved huge pages (hugetlbfs), transparent huge pages are used if none are reserved. */
+    };
+
+    //! Constructor maps the arena.
+    /*!
+     * \brief Huge pages are not available on every system, the pool then falls back to transparent
+     * huge pages and to normal pages. Mode really used is returned by 'GetPageMode'.
+     * \param size Size of the arena in bytes, rounded up to the page size of requested mode.
+     * \param mode Requested kind of pages.
+     * \param success BUFFER_OK, BUFFER_INVALID_SIZE if size is 0, or BUFFER_ALLOCATION_ERROR (see 'CyclicBuffer::buffer_error').
+     */
+    CyclicBufferPool(size_t size, pool_page_mode mode, int &success);
+
+    //! Destructor deletes rings that were not released and unmaps the arena.
+    ~CyclicBufferPool(void);
+
+    //! Function creates new ring with memory from the arena.
+    /*!
+     * \brief Ring memory is aligned to 'POOL_CACHE_LINE_SIZE'. Block of released ring with the same size
+     * and node is reused first. Returned ring is ordinary 'CyclicBuffer' (not mirrored), if it is
+     * reallocated later, its new memory is taken from heap and the block stays reserved until 'Release'.
+     * Function is thread safe.
+     * \param buf_size Size of the ring in bytes.
+     * \param success BUFFER_OK, BUFFER_INVALID_SIZE if size is 0, or BUFFER_ALLOCATION_ERROR if arena is exhausted.
+     * \param numa_node Node the memory is preferably placed on, negative value keeps default placement.
+     * Binding is only a hint, if the system has no NUMA support the ring is created anyway.
+     * \return New ring or NULL. It must be returned to the pool by 'Release', not deleted.
+     */
+    CyclicBuffer * Acquire(unsigned int buf_size, int &success, int numa_node = -1);
+
+    //! Function deletes the ring and keeps its memory for next rings (thread safe).
+    /*!
+     * \param buffer Ring created by 'Acquire' of this pool, NULL is ignored.
+     */
+    void Release(CyclicBuffer * buffer);
+
+    //! Function returns NUMA node of the CPU the calling thread runs on (0 if it is not known).
+    static int CurrentNumaNode(void);
+
+    //! Function returns kind of pages really backing the arena.
+    pool_page_mode GetPageMode(void) const { return page_mode; }
+
+    //! Function returns size of the arena in bytes.
+    size_t GetArenaSize(void) const { return arena_size; }
+
+    //! Function returns number of arena bytes held by live rings (including alignment).
+    size_t GetUsedBytes(void);
+
+    //! Function returns number of arena bytes not carved yet (memory of released rings is not included).
+    size_t GetRemainingBytes(void);
+
+    //! Function returns number of live rings.
+    size_t GetBufferCount(void);
+
+    //! Function returns number of failed requests to bind memory to NUMA node.
+    unsigned long long GetBindFailures(void);
+
+private:
+
+    //! Memory block of one ring.
+    struct pool_block {
+        size_t offset; /*!< Offset of the block in the arena. */
+        size_t size; /*!< Size of the block (multiple of 'POOL_CACHE_LINE_SIZE'). */
+        int node; /*!< NUMA node the block is bound to, or -1. */
+    };
+
+    //! Part of the arena bound to one NUMA node, rings of the node are carved from it.
+    struct pool_chunk {
+        size_t next; /*!< Offset of the first free byte. */
+        size_t end; /*!< Offset behind the chunk. */
+    };
+
+    //! Function carves new block out of the arena (called with locked mutex).
+    bool CarveBlock(size_t size, int node, size_t &offset);
+
+    //! Function maps the arena with requested kind of pages, or weaker one.
+    bool MapArena(size_t size, pool_page_mode mode);
+
+    //! Function binds memory range to NUMA node, returns false if it was not possible.
+    static bool BindToNode(unsigned char * memory, size_t length, int node);
+
+    //! Arena memory (aligned to page granularity).
+    unsigned char * arena;
+
+    //! Start of allocation holding the arena (differs from 'arena' if it was aligned).
+    unsigned char * arena_allocation;
+
+    //! Size of the allocation holding the arena.
+    size_t allocation_size;
+
+    //! Size of the usable arena.
+    size_t arena_size;
+
+    //! Offset of the first arena byte never carved.
+    size_t arena_next;
+
+    //! Granularity of NUMA binding (page size backing the arena).
+    size_t page_granularity;
+
+    //! Kind of pages really backing the arena.
+    pool_page_mode page_mode;
+
+    //! True if arena is mapped by 'mmap', otherwise it is heap block.
+    bool arena_mapped;
+
+    //! Released blocks sorted by their size and node.
+    std::map<std::pair<size_t, int>, std::vector<size_t> > free_blocks;
+
+    //! Blocks of live rings.
+    std::map<CyclicBuffer*, pool_block> used_blocks;
+
+    //! Chunks of nodes the rings are currently carved from.
+    std::map<int, pool_chunk> node_chunks;
+
+    //! Arena bytes held by live rings.
+    size_t used_bytes;
+
+    //! Number of failed 'BindToNode' calls.
+    unsigned long long bind_failures;
+
+    //! Mutex guarding all pool bookkeeping.
+    std::mutex pool_mutex;
+
+};
+
+#endif // CYCLICBUFFERPOOL_H
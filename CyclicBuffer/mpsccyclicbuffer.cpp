@@ -0,0 +1,142 @@
+#include "mpsccyclicbuffer.h"
+
+#include <cstring>
+#include <new>
+#include <thread>
+
+MpscCyclicBuffer::MpscCyclicBuffer(unsigned int buf_size, int & success)
+    : buffer(NULL), buffer_size(0), index_mask(0), write_cursor(0), read_cursor(0)
+{
+    static_assert(sizeof(std::atomic<unsigned int>)==sizeof(unsigned int), "packet header requires plain atomic word");
+
+    if(buf_size==0 || buf_size > 0x80000000u)
+    {
+        success = CyclicBuffer::BUFFER_INVALID_SIZE;
+        return;
+    }
+
+    // round size up to power of two, so headers (8 byte aligned) never wrap
+    unsigned int size = 64;
+    while(size < buf_size)
+        size <<= 1;
+
+    // allocated as 8 byte words for alignment of headers
+    buffer = reinterpret_cast<unsigned char *>(new (std::nothrow) unsigned long long[size/8]);
+    if(buffer==NULL)
+    {
+        success = CyclicBuffer::BUFFER_ALLOCATION_ERROR;
+        return;
+    }
+
+    // all headers must read as not committed
+    memset(buffer, 0, size);
+    buffer_size = size;
+    index_mask = size-1;
+
+    success = CyclicBuffer::BUFFER_OK;
+}
+
+MpscCyclicBuffer::~MpscCyclicBuffer()
+{
+    delete [] reinterpret_cast<unsigned long long *>(buffer);
+}
+
+bool MpscCyclicBuffer::Reserve(size_t length, packet_slot &slot)
+{
+    if(length > GetMaxPacketLength())
+        return false;
+
+    unsigned long long size = PacketSize(length);
+    unsigned long long position = write_cursor.fetch_add(size, std::memory_order_relaxed);
+
+    // wait until consumer releases space of the previous lap
+    while(position+size-read_cursor.load(std::memory_order_acquire) > buffer_size)
+        std::this_thread::yield();
+
+    slot.position = position;
+    slot.length = length;
+    GetSegments(position+MPSC_HEADER_SIZE, length, slot.segments);
+    return true;
+}
+
+void MpscCyclicBuffer::Commit(const packet_slot &slot)
+{
+    Header(slot.position).store(MPSC_COMMITTED | (unsigned int)slot.length, std::memory_order_release);
+}
+
+bool MpscCyclicBuffer::Push(const unsigned char * data, size_t length)
+{
+    packet_slot slot;
+    if(!Reserve(length, slot))
+        return false;
+
+    memcpy(slot.segments.first, data, slot.segments.first_length);
+    memcpy(slot.segments.second, data+slot.segments.first_length, slot.segments.second_length);
+
+    Commit(slot);
+    return true;
+}
+
+bool MpscCyclicBuffer::Peek(packet_slot &slot)
+{
+    unsigned long long position = read_cursor.load(std::memory_order_relaxed);
+    unsigned int state = Header(position).load(std::memory_order_acquire);
+
+    // next packet is not reserved or not committed yet
+    if(!(state & MPSC_COMMITTED))
+        return false;
+
+    slot.position = position;
+    slot.length = state & ~MPSC_COMMITTED;
+    GetSegments(position+MPSC_HEADER_SIZE, slot.length, slot.segments);
+    return true;
+}
+
+void MpscCyclicBuffer::Release(const packet_slot &slot)
+{
+    // any header of the next lap may be placed inside this packet, so the whole
+    // packet space is cleared before it is handed back to producers
+    unsigned long long size = PacketSize(slot.length);
+    CyclicBuffer::buffer_segments segments;
+    GetSegments(slot.position, (size_t)size, segments);
+    memset(segments.first, 0, segments.first_length);
+    memset(segments.second, 0, segments.second_length);
+
+    read_cursor.store(slot.position+size, std::memory_order_release);
+}
+
+bool MpscCyclicBuffer::Pop(unsigned char * data, size_t max_length, size_t &length)
+{
+    packet_slot slot;
+    if(!Peek(slot))
+        return false;
+
+    length = slot.length;
+    size_t copy = length < max_length ? length : max_length;
+    size_t first = copy < slot.segments.first_length ? copy : slot.segments.first_length;
+    memcpy(data, slot.segments.first, first);
+    memcpy(data+first, slot.segments.second, copy-first);
+
+    Release(slot);
+    return true;
+}
+
+void MpscCyclicBuffer::GetSegments(unsigned long long position, size_t length, CyclicBuffer::buffer_segments &segments)
+{
+    unsigned int index = (unsigned int)(position & index_mask);
+    size_t first = buffer_size-index;
+
+    segments.first = buffer+index;
+    segments.second = buffer;
+
+    if(first >= length)
+    {
+        segments.first_length = length;
+        segments.second_length = 0;
+    }
+    else
+    {
+        segments.first_length = first;
+        segments.second_length = length-first;
+    }
+}
@@ -0,0 +1,141 @@
+/*
+ * Author:      Peter Mikula
+ * Date:        10. 10. 2015
+ * Version:     0.1.1
+ *
+ */
+
+//! Lock-free cyclic buffer for many producer threads and one consumer thread.
+/*!
+  When several serial links (one per sensor cluster) feed one processing
+  pipeline, every link is drained by its own thread. This class lets these
+  threads push whole packets concurrently without mutex. Producer reserves
+  space for the packet by atomic fetch-add on the write cursor, copies the
+  packet and commits it by setting the flag in the packet header. Packets
+  from different producers therefore never interleave bytewise. Consumer takes
+  packets in the order their space was reserved, each of them only after it
+  was committed. If the buffer is full, producer waits (yields) until the
+  consumer frees the space.
+  Every packet occupies 8 byte header plus payload rounded up to 8 bytes.
+  */
+
+#ifndef MPSCCYCLICBUFFER_H
+#define MPSCCYCLICBUFFER_H
+
+#include <atomic>
+#include <cstddef>
+
+#include "cyclicbuffer.h"
+
+//! Size of cache line used to separate producer and consumer data.
+#define MPSC_CACHE_LINE_SIZE 64
+
+class MpscCyclicBuffer
+{
+
+public:
+
+    //! Structure describing space reserved for one packet.
+    struct packet_slot {
+        CyclicBuffer::buffer_segments segments; /*!< Regions of buffer memory for packet payload. */
+        unsigned long long position; /*!< Position of packet header (used by 'Commit'). */
+        size_t length; /*!< Length of packet payload. */
+    };
+
+    //! Construcor of buffer class. Ensures basic initialization and memory allocation.
+    /*!
+     * \param buf_size Minimal buffer size in bytes, rounded up to power of two (at least 64).
+     * \param success if memory was allocated successfully, the return value is 0, otherwise the error code (see 'CyclicBuffer::buffer_error').
+     */
+    MpscCyclicBuffer(unsigned int buf_size, int &success);
+
+    //! Destructor of buffer class. Frees allocated memory.
+    ~MpscCyclicBuffer(void);
+
+    //! Function reserves space for one packet (any producer thread).
+    /*!
+     * \brief Space is claimed by atomic fetch-add, so producers never wait for each other.
+     * If the buffer is full, function waits until the consumer frees enough space. Packet
+     * is not visible to the consumer until 'Commit' is called and it blocks consumer
+     * of all later packets until then, so it should be committed as soon as possible.
+     * \param length Length of packet payload (at most 'GetMaxPacketLength()').
+     * \param slot Structure filled with reserved regions.
+     * \return False if packet is too long for this buffer, otherwise true.
+     */
+    bool Reserve(size_t length, packet_slot &slot);
+
+    //! Function publishes the packet written into reserved slot.
+    void Commit(const packet_slot &slot);
+
+    //! Function pushes whole packet (any producer thread). Returns false if packet is too long.
+    bool Push(const unsigned char * data, size_t length);
+
+    //! Function returns the next committed packet without copying it (consumer thread only).
+    /*!
+     * \param slot Structure filled with regions containing the packet payload.
+     * \return True if packet is availible, false if next packet is not committed yet or buffer is empty.
+     */
+    bool Peek(packet_slot &slot);
+
+    //! Function releases the packet returned by 'Peek' (consumer thread only).
+    void Release(const packet_slot &slot);
+
+    //! Function copies the next committed packet out of the buffer (consumer thread only).
+    /*!
+     * \param data Pointer to memory for packet payload.
+     * \param max_length Size of memory pointed by 'data'. Longer packet is truncated.
+     * \param length Length of the packet payload.
+     * \return True if packet was retrieved.
+     */
+    bool Pop(unsigned char * data, size_t max_length, size_t &length);
+
+    //! Function returns maximal payload length of one packet.
+    size_t GetMaxPacketLength(void) const { return buffer_size-MPSC_HEADER_SIZE; }
+
+    //! Function returns total bytes availible in memory for the buffer.
+    unsigned int GetBufferSize(void) const { return buffer_size; }
+
+    //! Function returns the number of bytes reserved by producers and not released by consumer yet.
+    unsigned long long GetUsedBytes(void) const { return write_cursor.load(std::memory_order_relaxed)-read_cursor.load(std::memory_order_relaxed); }
+
+private:
+
+    //! Size of packet header.
+    static const unsigned int MPSC_HEADER_SIZE = 8;
+
+    //! Flag set in packet header when the packet is committed.
+    static const unsigned int MPSC_COMMITTED = 0x80000000u;
+
+    //! Function returns the space occupied by packet with given payload length.
+    static unsigned long long PacketSize(size_t length) { return (MPSC_HEADER_SIZE+length+7) & ~(unsigned long long)7; }
+
+    //! Function returns the state word in the packet header at 'position'.
+    std::atomic<unsigned int> & Header(unsigned long long position) { return *reinterpret_cast<std::atomic<unsigned int> *>(buffer+(position & index_mask)); }
+
+    //! Function fills segments for 'length' bytes starting at 'position'.
+    void GetSegments(unsigned long long position, size_t length, CyclicBuffer::buffer_segments &segments);
+
+    //! Pointer to the buffer memory block (aligned to 8 bytes).
+    unsigned char * buffer;
+
+    //! Size of buffer memory block (always power of two).
+    unsigned int buffer_size;
+
+    //! Mask converting free-running positions to buffer indexes.
+    unsigned int index_mask;
+
+    char padding_shared[MPSC_CACHE_LINE_SIZE];
+
+    //! Free-running position where the next packet will be reserved. Advanced by producers.
+    std::atomic<unsigned long long> write_cursor;
+
+    char padding_producers[MPSC_CACHE_LINE_SIZE-sizeof(std::atomic<unsigned long long>)];
+
+    //! Free-running position of the next packet to be read. Written only by consumer.
+    std::atomic<unsigned long long> read_cursor;
+
+    char padding_consumer[MPSC_CACHE_LINE_SIZE-sizeof(std::atomic<unsigned long long>)];
+
+};
+
+#endif // MPSCCYCLICBUFFER_H
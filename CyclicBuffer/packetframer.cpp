@@ -0,0 +1,138 @@
+#include "packetframer.h"
+#include "buffercrc.h"
+
+#include <cstring>
+
+PacketFramer::PacketFramer(CyclicBuffer &buf, unsigned char end_character, unsigned int crc_size, unsigned int max_frame_length)
+    : buffer(buf), end_char(end_character), crc_bytes(crc_size > 4 ? 4 : crc_size), max_length(max_frame_length),
+      crc_update(Crc32cUpdate), crc_initial(CRC32C_INITIAL), crc_final_xor(CRC32C_FINAL_XOR),
+      scanned_bytes(0), frame_count(0), crc_failures(0), dropped_bytes(0)
+{
+}
+
+void PacketFramer::SetCrcFunction(crc_function function, unsigned int initial, unsigned int final_xor)
+{
+    crc_update = function;
+    crc_initial = initial;
+    crc_final_xor = final_xor;
+}
+
+bool PacketFramer::NextFrame(frame_view &frame)
+{
+    CyclicBuffer::buffer_segments segments;
+
+    for(;;)
+    {
+        size_t available = buffer.PeekRead(segments);
+
+        // frame can not be longer than the buffer, full buffer is decided at once
+        size_t limit = max_length < buffer.GetBufferSize() ? max_length : buffer.GetBufferSize();
+
+        // ending character may be a byte of CRC or payload, so every one within the limit is tried
+        // CRC register runs over payload of all candidates, each of them extends the previous one
+        size_t end, length = 0, crc_length = 0;
+        unsigned int crc = crc_initial;
+        for(size_t from = scanned_bytes; ; from = end+1)
+        {
+            end = buffer.Find(end_char, from);
+            if(end==CyclicBuffer::BUFFER_NOT_FOUND || end >= limit)
+                break;
+
+            // producer may have added data between peek and search
+            if(end >= available)
+                available = buffer.PeekRead(segments);
+
+            if(end >= crc_bytes && (!crc_bytes || ValidateCrc(segments, end-crc_bytes, crc, crc_length)))
+            {
+                length = end+1;
+                break;
+            }
+        }
+
+        if(length)
+        {
+            // frame starts at 'read_ptr', take view of its bytes only
+            frame.length = length;
+            frame.payload_length = length-1-crc_bytes;
+            frame.segments = segments;
+            if(frame.segments.first_length >= length)
+            {
+                frame.segments.first_length = length;
+                frame.segments.second_length = 0;
+            }
+            else
+                frame.segments.second_length = length-frame.segments.first_length;
+
+            scanned_bytes = 0;
+            frame_count++;
+            return true;
+        }
+
+        // frame may still be completed by next data, candidates scanned so far are not tried again
+        if(end==CyclicBuffer::BUFFER_NOT_FOUND && available < limit)
+        {
+            scanned_bytes = available;
+            return false;
+        }
+
+        size_t first = buffer.Find(end_char);
+        if(first==CyclicBuffer::BUFFER_NOT_FOUND || first >= limit)
+        {
+            // no ending character within the limit, only bytes that can not start a frame are dropped
+            Drop((first==CyclicBuffer::BUFFER_NOT_FOUND ? available : first)-limit+1);
+            continue;
+        }
+
+        // no frame starting at the first byte ends within the limit, next frame can start only
+        // behind an ending character, so the invalid frame is dropped at once instead of byte by byte
+        crc_failures++;
+        Drop(first+1);
+    }
+}
+
+void PacketFramer::ReleaseFrame(const frame_view &frame)
+{
+    buffer.ConsumeRead(frame.length);
+    scanned_bytes = 0;
+}
+
+void PacketFramer::CopyPayload(const frame_view &frame, unsigned char * data)
+{
+    size_t first = frame.segments.first_length < frame.payload_length ? frame.segments.first_length : frame.payload_length;
+    memcpy(data, frame.segments.first, first);
+    memcpy(data+first, frame.segments.second, frame.payload_length-first);
+}
+
+bool PacketFramer::ValidateCrc(const CyclicBuffer::buffer_segments &segments, size_t payload_length, unsigned int &crc, size_t &crc_length)
+{
+    // only bytes not covered by the register yet are processed
+    if(crc_length < segments.first_length)
+    {
+        size_t first_end = segments.first_length < payload_length ? segments.first_length : payload_length;
+        crc = crc_update(crc, segments.first+crc_length, first_end-crc_length);
+        crc_length = first_end;
+    }
+    if(crc_length < payload_length)
+    {
+        crc = crc_update(crc, segments.second+(crc_length-segments.first_length), payload_length-crc_length);
+        crc_length = payload_length;
+    }
+    unsigned int value = crc ^ crc_final_xor;
+
+    // stored CRC is little endian, it may be split by the wrap point as well
+    for(unsigned int i=0; i<crc_bytes; i++)
+    {
+        size_t offset = payload_length+i;
+        unsigned char stored = (offset < segments.first_length) ? segments.first[offset] : segments.second[offset-segments.first_length];
+        if(stored!=(unsigned char)(value >> (8*i)))
+            return false;
+    }
+
+    return true;
+}
+
+void PacketFramer::Drop(size_t length)
+{
+    dropped_bytes += buffer.ConsumeRead(length);
+    scanned_bytes = 0;
+}
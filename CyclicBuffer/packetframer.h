@@ -0,0 +1,136 @@
+/*
+ * Author:      Peter Mikula
+ * Date:        10. 10. 2015
+ * Version:     0.1.1
+ *
+ */
+
+//! Framing layer extracting complete UWB packets from 'CyclicBuffer'.
+/*!
+  Every packet coming from UWB sensor network ends with CRC and ending character.
+  Instead of popping bytes until the ending character is found, this class scans
+  unread data of the buffer in place (with vectorized 'CyclicBuffer::Find'), validates
+  CRC of found frame and returns view of the frame without copying it. Ending
+  character may also appear in payload or CRC, so when CRC does not match, next
+  ending characters within maximal frame length are tried. When none of them matches,
+  bytes up to the first ending character are dropped as invalid frame, so the framer
+  resynchronizes on the frame following it.
+  Expected frame layout is: payload, CRC (little endian, 'crc_size' bytes), ending character.
+  */
+
+#ifndef PACKETFRAMER_H
+#define PACKETFRAMER_H
+
+#include <cstddef>
+
+#include "cyclicbuffer.h"
+
+class PacketFramer
+{
+
+public:
+
+    //! Function type computing CRC register over block of bytes.
+    /*!
+      Function continues from register value 'crc' and returns updated register,
+      so CRC of data split into two segments can be computed by two calls.
+     */
+    typedef unsigned int (*crc_function)(unsigned int crc, const unsigned char * data, size_t length);
+
+    //! Structure describing one complete frame inside the buffer.
+    struct frame_view {
+        CyclicBuffer::buffer_segments segments; /*!< Regions of buffer memory containing the frame (including CRC and ending character). */
+        size_t length; /*!< Total length of the frame. */
+        size_t payload_length; /*!< Length of the frame without CRC and ending character. */
+    };
+
+    //! Constructor of framer working on given buffer.
+    /*!
+     * \param buf Buffer from which the frames are read. Framer is the only reader of this buffer.
+     * \param end_character Character terminating every frame.
+     * \param crc_size Number of CRC bytes preceding the ending character (0 to 4, 0 disables CRC validation).
+     * \param max_frame_length Maximal length of the frame. Longer data without ending character are dropped as garbage.
+     */
+    PacketFramer(CyclicBuffer &buf, unsigned char end_character, unsigned int crc_size = 4, unsigned int max_frame_length = 1024);
+
+    //! Function sets the CRC algorithm used for validation.
+    /*!
+     * \brief Default algorithm is CRC-32C (Castagnoli, 'Crc32cUpdate') with initial value and final xor 0xFFFFFFFF.
+     * Only lowest 'crc_size' bytes of the final value are compared.
+     * \param function Function updating CRC register.
+     * \param initial Initial value of CRC register.
+     * \param final_xor Value xored with CRC register after all bytes are processed.
+     */
+    void SetCrcFunction(crc_function function, unsigned int initial, unsigned int final_xor);
+
+    //! Function finds next valid frame at the beginning of unread data.
+    /*!
+     * \brief Invalid frames and garbage in front of the next valid frame are removed
+     * from the buffer. Unread data are dropped up to the first ending character only when no frame
+     * starting at the first byte ends within maximal frame length (or buffer size), so invalid data
+     * delay frames behind them until that many bytes arrive. Next frame is expected right behind
+     * the dropped ending character, valid frame preceded by garbage without ending character is lost. The returned frame stays in the buffer until 'ReleaseFrame' is called,
+     * it must be released before next call of this function.
+     * \param frame Structure filled with the frame view.
+     * \return True if complete valid frame was found, false if more data are needed.
+     */
+    bool NextFrame(frame_view &frame);
+
+    //! Function removes the frame returned by 'NextFrame' from the buffer.
+    void ReleaseFrame(const frame_view &frame);
+
+    //! Function copies frame payload to continuous memory (for frames split by the wrap point).
+    static void CopyPayload(const frame_view &frame, unsigned char * data);
+
+    //! Function returns the number of valid frames found.
+    unsigned long long GetFrameCount(void) { return frame_count; }
+
+    //! Function returns the number of invalid frames dropped because no matching CRC was found.
+    unsigned long long GetCrcFailures(void) { return crc_failures; }
+
+    //! Function returns the number of bytes dropped (invalid frames and garbage).
+    unsigned long long GetDroppedBytes(void) { return dropped_bytes; }
+
+private:
+
+    //! Function returns true if CRC stored in the frame matches its payload.
+    /*!
+     * \param crc CRC register covering first 'crc_length' bytes, it is extended to the whole payload.
+     * \param crc_length Number of bytes covered by 'crc', payload must not be shorter.
+     */
+    bool ValidateCrc(const CyclicBuffer::buffer_segments &segments, size_t payload_length, unsigned int &crc, size_t &crc_length);
+
+    //! Function removes 'length' bytes from the buffer as dropped.
+    void Drop(size_t length);
+
+    //! Buffer from which frames are read.
+    CyclicBuffer &buffer;
+
+    //! Character terminating every frame.
+    unsigned char end_char;
+
+    //! Number of CRC bytes preceding ending character.
+    unsigned int crc_bytes;
+
+    //! Maximal length of the frame.
+    unsigned int max_length;
+
+    //! CRC algorithm and its parameters.
+    crc_function crc_update;
+    unsigned int crc_initial;
+    unsigned int crc_final_xor;
+
+    //! Number of unread bytes already scanned without finding ending character.
+    /*!
+      When the frame is not complete yet, next call continues scanning from this offset
+      instead of scanning the whole frame again.
+     */
+    size_t scanned_bytes;
+
+    unsigned long long frame_count;
+    unsigned long long crc_failures;
+    unsigned long long dropped_bytes;
+
+};
+
+#endif // PACKETFRAMER_H
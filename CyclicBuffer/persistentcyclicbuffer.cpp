@@ -0,0 +1,254 @@
+#include "persistentcyclicbuffer.h"
+
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define PERSISTENT_POSIX
+#endif
+
+PersistentCyclicBuffer::PersistentCyclicBuffer(const char * path, unsigned int buf_size, int &success, bool reset)
+    : file(-1), header(NULL), buffer(NULL), mapping_size(0), reattached(false), bottom_index(0), top_index(0),
+      read_position(0), write_position(0), read_ptr(0), write_ptr(0), overflow_policy(CyclicBuffer::BUFFER_OVERWRITE_OLDEST),
+      dropped_bytes(0), sync_interval(0), sync_synchronous(false), unsynced_bytes(0)
+{
+#if defined(PERSISTENT_POSIX)
+    success = CyclicBuffer::BUFFER_OK;
+
+    file = open(path, O_RDWR | O_CREAT, 0644);
+    if(file<0)
+    {
+        success = CyclicBuffer::BUFFER_FILE_ERROR;
+        return;
+    }
+
+    struct stat info;
+    if(fstat(file, &info)!=0)
+    {
+        success = CyclicBuffer::BUFFER_FILE_ERROR;
+        return;
+    }
+
+    bool create = reset || info.st_size==0;
+    size_t file_size = (size_t)info.st_size;
+
+    if(create)
+    {
+        if(buf_size==0 || buf_size > 0x80000000u)
+        {
+            success = CyclicBuffer::BUFFER_INVALID_SIZE;
+            return;
+        }
+        file_size = PERSISTENT_HEADER_SIZE+(size_t)buf_size;
+        // old content is dropped, new file is filled by zeros
+        if(ftruncate(file, 0)!=0 || ftruncate(file, (off_t)file_size)!=0)
+        {
+            success = CyclicBuffer::BUFFER_FILE_ERROR;
+            return;
+        }
+    }
+    else if(file_size < PERSISTENT_HEADER_SIZE)
+    {
+        success = CyclicBuffer::BUFFER_INCOMPATIBLE;
+        return;
+    }
+
+    void * mapping = mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    if(mapping==MAP_FAILED)
+    {
+        success = CyclicBuffer::BUFFER_FILE_ERROR;
+        return;
+    }
+    mapping_size = file_size;
+    header = static_cast<persistent_header*>(mapping);
+    buffer = static_cast<unsigned char*>(mapping)+PERSISTENT_HEADER_SIZE;
+
+    if(create)
+    {
+        header->header_size = PERSISTENT_HEADER_SIZE;
+        header->buffer_size = buf_size;
+        header->bottom_index = 0;
+        header->top_index = buf_size-1;
+        header->read_position.store(0, std::memory_order_relaxed);
+        header->write_position.store(0, std::memory_order_relaxed);
+        header->version = PERSISTENT_VERSION;
+        // magic is written last, half-initialized file is not recognized as valid
+        std::atomic_thread_fence(std::memory_order_release);
+        header->magic = PERSISTENT_MAGIC;
+    }
+    else
+    {
+        if(header->magic!=PERSISTENT_MAGIC || header->version!=PERSISTENT_VERSION || header->header_size!=PERSISTENT_HEADER_SIZE)
+        {
+            success = CyclicBuffer::BUFFER_INCOMPATIBLE;
+            return;
+        }
+
+        unsigned long long read = header->read_position.load(std::memory_order_acquire);
+        unsigned long long write = header->write_position.load(std::memory_order_acquire);
+        if(header->buffer_size==0 || (size_t)header->buffer_size+PERSISTENT_HEADER_SIZE!=file_size ||
+           header->bottom_index > header->top_index || header->top_index >= header->buffer_size ||
+           read > write || write-read > (unsigned long long)(header->top_index-header->bottom_index)+1)
+        {
+            success = CyclicBuffer::BUFFER_INCOMPATIBLE;
+            return;
+        }
+        reattached = true;
+    }
+
+    bottom_index = header->bottom_index;
+    top_index = header->top_index;
+    read_position = header->read_position.load(std::memory_order_relaxed);
+    write_position = header->write_position.load(std::memory_order_relaxed);
+    read_ptr = bottom_index+(unsigned int)(read_position%GetBufferSize());
+    write_ptr = bottom_index+(unsigned int)(write_position%GetBufferSize());
+#else
+    (void)path;
+    (void)buf_size;
+    (void)reset;
+    success = CyclicBuffer::BUFFER_FILE_ERROR;
+#endif
+}
+
+PersistentCyclicBuffer::~PersistentCyclicBuffer()
+{
+#if defined(PERSISTENT_POSIX)
+    if(header!=NULL)
+    {
+        if(sync_interval!=0)
+            Sync(sync_synchronous);
+        munmap(header, mapping_size);
+    }
+    if(file>=0)
+        close(file);
+#endif
+}
+
+unsigned int PersistentCyclicBuffer::AdvanceIndex(unsigned int index, size_t length) const
+{
+    size_t offset = (index-bottom_index+length)%GetBufferSize();
+    return bottom_index+(unsigned int)offset;
+}
+
+void PersistentCyclicBuffer::GetSegments(unsigned int index, size_t length, CyclicBuffer::buffer_segments &segments)
+{
+    size_t to_top = (top_index-index)+1;
+    segments.first = buffer!=NULL ? &buffer[index] : NULL;
+    if(length<=to_top)
+    {
+        segments.first_length = length;
+        segments.second = NULL;
+        segments.second_length = 0;
+    }
+    else
+    {
+        segments.first_length = to_top;
+        segments.second = &buffer[bottom_index];
+        segments.second_length = length-to_top;
+    }
+}
+
+void PersistentCyclicBuffer::AdvanceRead(size_t length)
+{
+    read_position += length;
+    read_ptr = AdvanceIndex(read_ptr, length);
+    header->read_position.store(read_position, std::memory_order_release);
+}
+
+size_t PersistentCyclicBuffer::PushN(const unsigned char * data, size_t length)
+{
+    if(header==NULL || length==0)
+        return 0;
+
+    size_t free_space = FreeSpace();
+
+    if(length > free_space)
+    {
+        // block is never stored partially
+        if(overflow_policy!=CyclicBuffer::BUFFER_OVERWRITE_OLDEST)
+            return 0;
+
+        // only the newest bytes fitting into buffer are stored, the rest is dropped
+        size_t size = GetBufferSize();
+        if(length > size)
+        {
+            dropped_bytes += length-size;
+            data += length-size;
+            length = size;
+        }
+        // read position is published before old data are overwritten
+        size_t overwritten = length-free_space;
+        dropped_bytes += overwritten;
+        AdvanceRead(overwritten);
+    }
+
+    CyclicBuffer::buffer_segments segments;
+    GetSegments(write_ptr, length, segments);
+    memcpy(segments.first, data, segments.first_length);
+    if(segments.second_length!=0)
+        memcpy(segments.second, data+segments.first_length, segments.second_length);
+
+    // data are stored before position that publishes them
+    write_position += length;
+    write_ptr = AdvanceIndex(write_ptr, length);
+    header->write_position.store(write_position, std::memory_order_release);
+
+    if(sync_interval!=0)
+    {
+        unsynced_bytes += length;
+        if(unsynced_bytes >= sync_interval)
+            Sync(sync_synchronous);
+    }
+
+    return length;
+}
+
+size_t PersistentCyclicBuffer::PopN(unsigned char * data, size_t length)
+{
+    CyclicBuffer::buffer_segments segments;
+    length = PeekRead(segments, length);
+    if(length==0)
+        return 0;
+
+    memcpy(data, segments.first, segments.first_length);
+    if(segments.second_length!=0)
+        memcpy(data+segments.first_length, segments.second, segments.second_length);
+
+    AdvanceRead(length);
+    return length;
+}
+
+size_t PersistentCyclicBuffer::PeekRead(CyclicBuffer::buffer_segments &segments, size_t max_length)
+{
+    size_t length = Available();
+    if(length > max_length)
+        length = max_length;
+
+    GetSegments(read_ptr, length, segments);
+    return length;
+}
+
+size_t PersistentCyclicBuffer::ConsumeRead(size_t length)
+{
+    if(length>Available())
+        length = Available();
+
+    if(length!=0)
+        AdvanceRead(length);
+    return length;
+}
+
+CyclicBuffer::buffer_error PersistentCyclicBuffer::Sync(bool synchronous)
+{
+    unsynced_bytes = 0;
+#if defined(PERSISTENT_POSIX)
+    if(header!=NULL && msync(header, mapping_size, synchronous ? MS_SYNC : MS_ASYNC)==0)
+        return CyclicBuffer::BUFFER_OK;
+#else
+    (void)synchronous;
+#endif
+    return CyclicBuffer::BUFFER_FILE_ERROR;
+}
@@ -0,0 +1,212 @@
+/*
+ * Author:      Peter Mikula
+ * Date:        10. 10. 2015
+ * Version:     0.1.1
+ *
+ */
+
+//! Cyclic buffer stored in memory-mapped file, surviving crash of the process.
+/*!
+  Buffer memory and its indexes are placed in a file mapped into memory, so
+  data received right before the crash of receiver application stay in the
+  file (in page cache of operating system) and restarted application attaches
+  to them and continues reading where it stopped. The file starts with versioned
+  header holding borders of the buffer and free-running read and write positions
+  ('read_ptr' and 'write_ptr' are derived from them). Pushing and popping only
+  copy data and store positions into the mapped header, there is no system call
+  in the hot path. To survive also crash of the operating system or power loss,
+  the file can be flushed by 'msync' after every configured number of pushed bytes.
+
+  Data are always written before the position that publishes them, and with
+  'BUFFER_OVERWRITE_OLDEST' policy the read position is moved before old data are
+  overwritten, so the header never describes bytes that are not valid.
+  The buffer is used by one thread (like 'CyclicBuffer' without 'BUFFER_BLOCK'
+  policy). It is availible on POSIX systems only, elsewhere the constructor fails
+  with 'BUFFER_FILE_ERROR'.
+
+  This is a separate class rather than a file backend of 'CyclicBuffer': 'CyclicBuffer'
+  keeps its pointers in object members and may reallocate, resize or mirror its memory,
+  while here the positions must live in the mapped header and the file layout is fixed
+  when the file is created.
+  */
+
+#ifndef PERSISTENTCYCLICBUFFER_H
+#define PERSISTENTCYCLICBUFFER_H
+
+#include <atomic>
+#include <cstddef>
+
+#include "cyclicbuffer.h"
+
+//! Identification of persistent buffer file ("CBUF").
+#define PERSISTENT_MAGIC 0x46554243u
+
+//! Version of the file header layout.
+#define PERSISTENT_VERSION 1u
+
+//! Size reserved for the header at the start of the file (one page).
+#define PERSISTENT_HEADER_SIZE 4096u
+
+class PersistentCyclicBuffer
+{
+
+public:
+
+    //! Constructor opens or creates the buffer file and maps it into memory.
+    /*!
+     * \brief If the file exists and contains valid buffer, the buffer is attached with all
+     * unread data and its original size ('buf_size' is ignored). Otherwise new empty buffer
+     * of 'buf_size' bytes is created.
+     * \param path Path of the buffer file.
+     * \param buf_size Size of buffer in bytes, used when new file is created.
+     * \param success BUFFER_OK, BUFFER_FILE_ERROR if file can not be opened or mapped,
+     * BUFFER_INCOMPATIBLE if existing file is not a valid buffer of this version (see 'CyclicBuffer::buffer_error').
+     * \param reset If true, existing content is discarded and new empty buffer is created.
+     */
+    PersistentCyclicBuffer(const char * path, unsigned int buf_size, int &success, bool reset = false);
+
+    //! Destructor flushes the file if synchronization is enabled and unmaps it. The file is kept.
+    ~PersistentCyclicBuffer(void);
+
+    //! Function returns true if the constructor attached to data of earlier process.
+    bool IsReattached(void) const { return reattached; }
+
+    //! Function pushes one value into buffer.
+    /*!
+     * \return BUFFER_OK, or BUFFER_FULL if buffer is full and 'BUFFER_REJECT' policy is selected.
+     */
+    CyclicBuffer::buffer_error Push(unsigned char ch) { return PushN(&ch, 1)==1 ? CyclicBuffer::BUFFER_OK : CyclicBuffer::BUFFER_FULL; }
+
+    //! Function pushes block of values into buffer, applying overflow policy.
+    /*!
+     * \return Number of bytes accepted (see 'CyclicBuffer::PushN').
+     */
+    size_t PushN(const unsigned char * data, size_t length);
+
+    //! Function retrieves one value.
+    /*!
+     * \return True if value was retrieved, false if there is nothing to read.
+     */
+    bool Pop(unsigned char &ch) { return PopN(&ch, 1)==1; }
+
+    //! Function retrieves block of values.
+    /*!
+     * \return Number of bytes really retrieved.
+     */
+    size_t PopN(unsigned char * data, size_t length);
+
+    //! Function returns unread data in place (see 'CyclicBuffer::PeekRead').
+    size_t PeekRead(CyclicBuffer::buffer_segments &segments, size_t max_length = (size_t)-1);
+
+    //! Function releases bytes returned by 'PeekRead'.
+    size_t ConsumeRead(size_t length);
+
+    //! Function selects reaction on push into full buffer ('BUFFER_BLOCK' is not supported and behaves as 'BUFFER_REJECT').
+    void SetOverflowPolicy(CyclicBuffer::buffer_overflow_policy policy) { overflow_policy = policy; }
+
+    //! Function enables flushing of the file after every 'interval' pushed bytes.
+    /*!
+     * \param interval Number of bytes pushed between two flushes (0 disables flushing).
+     * \param synchronous If true, 'msync' waits until data are written to disk, otherwise it only schedules writing.
+     */
+    void SetSyncInterval(size_t interval, bool synchronous = false) { sync_interval = interval; sync_synchronous = synchronous; }
+
+    //! Function flushes the file now.
+    /*!
+     * \return BUFFER_OK, or BUFFER_FILE_ERROR if 'msync' failed.
+     */
+    CyclicBuffer::buffer_error Sync(bool synchronous = true);
+
+    //! Function returns number of bytes waiting for reading.
+    unsigned int Available(void) const { return (unsigned int)(write_position-read_position); }
+
+    //! Function returns number of bytes that can be pushed without overwriting unread data.
+    unsigned int FreeSpace(void) const { return GetBufferSize()-Available(); }
+
+    //! Function returns true if there is nothing to read.
+    bool IsEmpty(void) const { return write_position==read_position; }
+
+    //! Function returns the buffer size in bytes.
+    unsigned int GetBufferSize(void) const { return (top_index-bottom_index)+1; }
+
+    //! Function returns index of the next byte to be read.
+    unsigned int GetPopIndex(void) const { return read_ptr; }
+
+    //! Function returns index of the next byte to be written.
+    unsigned int GetPushIndex(void) const { return write_ptr; }
+
+    //! Function returns the smallest index of buffer memory in use.
+    unsigned int GetBottomIndex(void) const { return bottom_index; }
+
+    //! Function returns the highest index of buffer memory in use.
+    unsigned int GetTopIndex(void) const { return top_index; }
+
+    //! Function returns the number of unread bytes lost by 'BUFFER_OVERWRITE_OLDEST' policy.
+    unsigned long long GetDroppedBytes(void) const { return dropped_bytes; }
+
+private:
+
+    //! Layout of the file header (followed by buffer memory at 'PERSISTENT_HEADER_SIZE').
+    struct persistent_header {
+        unsigned int magic; /*!< 'PERSISTENT_MAGIC'. */
+        unsigned int version; /*!< 'PERSISTENT_VERSION'. */
+        unsigned int header_size; /*!< Offset of buffer memory in the file. */
+        unsigned int buffer_size; /*!< Size of buffer memory block. */
+        unsigned int bottom_index; /*!< Lowest index of buffer memory in use. */
+        unsigned int top_index; /*!< Highest index of buffer memory in use. */
+        std::atomic<unsigned long long> read_position; /*!< Free-running count of bytes read (or overwritten). */
+        std::atomic<unsigned long long> write_position; /*!< Free-running count of bytes written. */
+    };
+
+    //! Function fills segments for 'length' bytes starting at buffer index 'index'.
+    void GetSegments(unsigned int index, size_t length, CyclicBuffer::buffer_segments &segments);
+
+    //! Function returns buffer index 'length' bytes after 'index'.
+    unsigned int AdvanceIndex(unsigned int index, size_t length) const;
+
+    //! Function moves read position by 'length' bytes and publishes it in the header.
+    void AdvanceRead(size_t length);
+
+    //! File descriptor of the buffer file.
+    int file;
+
+    //! Start of the mapping (the header).
+    persistent_header * header;
+
+    //! Buffer memory in the mapping.
+    unsigned char * buffer;
+
+    //! Size of the whole mapping.
+    size_t mapping_size;
+
+    //! True if existing buffer was attached.
+    bool reattached;
+
+    //! Copies of header fields used in the hot path.
+    unsigned int bottom_index;
+    unsigned int top_index;
+    unsigned long long read_position;
+    unsigned long long write_position;
+
+    //! Indexes corresponding to 'read_position' and 'write_position'.
+    unsigned int read_ptr;
+    unsigned int write_ptr;
+
+    //! Reaction on push into full buffer.
+    CyclicBuffer::buffer_overflow_policy overflow_policy;
+
+    //! Number of unread bytes overwritten because of full buffer.
+    unsigned long long dropped_bytes;
+
+    //! Number of pushed bytes between flushes (0 disables flushing).
+    size_t sync_interval;
+
+    //! True if flushes wait for disk.
+    bool sync_synchronous;
+
+    //! Bytes pushed since the last flush.
+    size_t unsynced_bytes;
+
+};
+
+#endif // PERSISTENTCYCLICBUFFER_H
@@ -0,0 +1,171 @@
+#include "recordcyclicbuffer.h"
+
+#include <cstring>
+#include <new>
+
+RecordCyclicBuffer::RecordCyclicBuffer(unsigned int buf_size, int &success)
+    : buffer(NULL), buffer_size(0), index_mask(0), read_ptr(0), cached_write_ptr(0), write_ptr(0), cached_read_ptr(0),
+      prepared_ptr(0), prepared_length(0)
+{
+    // smallest block holds two records of one aligned word
+    if(buf_size < 4*RECORD_ALIGNMENT || buf_size > 0x80000000u)
+    {
+        success = CyclicBuffer::BUFFER_INVALID_SIZE;
+        return;
+    }
+
+    unsigned int size = 1;
+    while(size < buf_size)
+        size <<= 1;
+
+    buffer = new (std::nothrow) unsigned char[size];
+    if(buffer==NULL)
+    {
+        success = CyclicBuffer::BUFFER_ALLOCATION_ERROR;
+        return;
+    }
+
+    memset(buffer, 0, size);
+    buffer_size = size;
+    index_mask = size-1;
+    success = CyclicBuffer::BUFFER_OK;
+}
+
+RecordCyclicBuffer::~RecordCyclicBuffer()
+{
+    delete [] buffer;
+}
+
+unsigned char * RecordCyclicBuffer::PrepareRecord(unsigned int length)
+{
+    if(buffer==NULL || length > GetMaxRecordLength())
+        return NULL;
+
+    unsigned int w = write_ptr.load(std::memory_order_relaxed);
+    unsigned int space = RecordSpace(length);
+
+    // record does not wrap, the rest of memory block is skipped
+    unsigned int to_end = buffer_size-(w & index_mask);
+    unsigned int padding = space > to_end ? to_end : 0;
+
+    if(w+padding+space-cached_read_ptr > buffer_size)
+    {
+        // buffer looks full, check whether consumer has moved meanwhile
+        cached_read_ptr = read_ptr.load(std::memory_order_acquire);
+        if(w+padding+space-cached_read_ptr > buffer_size)
+            return NULL;
+    }
+
+    // padding is published together with the record
+    if(padding)
+        Header(w) = RECORD_PADDING;
+
+    prepared_ptr = w+padding;
+    prepared_length = length;
+    return buffer+(prepared_ptr & index_mask)+RECORD_ALIGNMENT;
+}
+
+void RecordCyclicBuffer::CommitRecord(unsigned int length)
+{
+    if(length > prepared_length)
+        length = prepared_length;
+
+    Header(prepared_ptr) = length;
+    write_ptr.store(prepared_ptr+RecordSpace(length), std::memory_order_release);
+}
+
+CyclicBuffer::buffer_error RecordCyclicBuffer::PushRecord(const unsigned char *data, unsigned int length)
+{
+    if(length > GetMaxRecordLength())
+        return CyclicBuffer::BUFFER_INCORRECT_SIZE;
+
+    unsigned char * record = PrepareRecord(length);
+    if(record==NULL)
+        return CyclicBuffer::BUFFER_FULL;
+
+    memcpy(record, data, length);
+    CommitRecord(length);
+    return CyclicBuffer::BUFFER_OK;
+}
+
+unsigned int RecordCyclicBuffer::NextRecord(unsigned int r, unsigned int w, record_view &record)
+{
+    if(r==w)
+        return r;
+
+    unsigned int length = Header(r);
+    if(length==RECORD_PADDING)
+    {
+        // padding is never the last item, the record follows at the beginning of memory block
+        r += buffer_size-(r & index_mask);
+        length = Header(r);
+    }
+
+    record.data = buffer+(r & index_mask)+RECORD_ALIGNMENT;
+    record.length = length;
+    return r+RecordSpace(length);
+}
+
+bool RecordCyclicBuffer::PeekRecord(record_view &record)
+{
+    unsigned int r = read_ptr.load(std::memory_order_relaxed);
+    if(r==cached_write_ptr)
+    {
+        // buffer looks empty, check whether producer has moved meanwhile
+        cached_write_ptr = write_ptr.load(std::memory_order_acquire);
+        if(r==cached_write_ptr)
+            return false;
+    }
+
+    NextRecord(r, cached_write_ptr, record);
+    return true;
+}
+
+bool RecordCyclicBuffer::PopRecord(unsigned char *data, unsigned int max_length, unsigned int &length)
+{
+    record_view record;
+    if(!PeekRecord(record))
+    {
+        length = 0;
+        return false;
+    }
+
+    length = record.length;
+    if(record.length > max_length)
+        return false;
+
+    memcpy(data, record.data, record.length);
+    ConsumeRecords(1);
+    return true;
+}
+
+unsigned int RecordCyclicBuffer::PeekRecords(record_view *records, unsigned int max_records)
+{
+    unsigned int r = read_ptr.load(std::memory_order_relaxed);
+    cached_write_ptr = write_ptr.load(std::memory_order_acquire);
+
+    unsigned int count = 0;
+    while(count < max_records && r!=cached_write_ptr)
+        r = NextRecord(r, cached_write_ptr, records[count++]);
+    return count;
+}
+
+unsigned int RecordCyclicBuffer::ConsumeRecords(unsigned int count)
+{
+    unsigned int r = read_ptr.load(std::memory_order_relaxed);
+    if(r==cached_write_ptr)
+        cached_write_ptr = write_ptr.load(std::memory_order_acquire);
+
+    // headers of records known to consumer are walked again, read position is stored once
+    unsigned int released = 0;
+    record_view record;
+    while(released < count && r!=cached_write_ptr)
+    {
+        r = NextRecord(r, cached_write_ptr, record);
+        released++;
+    }
+
+    if(released)
+        read_ptr.store(r, std::memory_order_release);
+    return released;
+}
@@ -0,0 +1,177 @@
+/*
+ * Author:      Peter Mikula
+ * Date:        10. 10. 2015
+ * Version:     0.1.1
+ *
+ */
+
+//! Lock-free cyclic buffer of variable-length records for one producer and one consumer thread.
+/*!
+  After framing, whole packets (e.g. UWB radar packets whose size depends on
+  the number of seen targets) are queued as records instead of bytes, so the
+  consumer gets every packet as one contiguous view and does not parse it again.
+
+  Every record starts with a header holding its length and is aligned to
+  'RECORD_ALIGNMENT' bytes. Record never wraps: if it does not fit before the
+  end of memory block, the rest of the block is skipped by a padding header
+  and the record is stored at the beginning. Positions are free-running
+  atomic counters as in 'SpscCyclicBuffer', so one thread may push and one
+  (other) thread may pop without locking. Consumer can peek a batch of
+  records and release them by one update of the read position.
+  */
+
+#ifndef RECORDCYCLICBUFFER_H
+#define RECORDCYCLICBUFFER_H
+
+#include <atomic>
+#include <cstddef>
+
+#include "cyclicbuffer.h"
+
+//! Size of cache line used to separate producer and consumer data.
+#define RECORD_CACHE_LINE_SIZE 64
+
+//! Alignment of records (and size of record header) in bytes.
+#define RECORD_ALIGNMENT 4
+
+class RecordCyclicBuffer
+{
+
+public:
+
+    //! One record returned to the consumer.
+    struct record_view {
+        const unsigned char * data; /*!< Pointer to contiguous record data inside the buffer. */
+        unsigned int length; /*!< Length of record in bytes. */
+    };
+
+    //! Constructor allocates memory block.
+    /*!
+     * \param buf_size Minimal size of memory block in bytes, rounded up to power of two.
+     * \param success BUFFER_OK, or error code if size is invalid or memory could not be allocated (see 'CyclicBuffer::buffer_error').
+     */
+    RecordCyclicBuffer(unsigned int buf_size, int &success);
+
+    //! Destructor frees memory block.
+    ~RecordCyclicBuffer(void);
+
+    //! Function copies one record into the buffer (producer thread only).
+    /*!
+     * \param data Record data.
+     * \param length Length of record, at most 'GetMaxRecordLength()' (empty records are allowed).
+     * \return BUFFER_OK, BUFFER_FULL if there is not enough space, or BUFFER_INCORRECT_SIZE if record is too long.
+     */
+    CyclicBuffer::buffer_error PushRecord(const unsigned char * data, unsigned int length);
+
+    //! Function reserves contiguous space for record of 'length' bytes (producer thread only).
+    /*!
+     * \brief Producer (e.g. packet framer) writes the record in place and publishes it by 'CommitRecord'.
+     * \return Pointer to record data, or NULL if record does not fit or is too long.
+     */
+    unsigned char * PrepareRecord(unsigned int length);
+
+    //! Function publishes record prepared by 'PrepareRecord' (producer thread only).
+    /*!
+     * \param length Final length of record, at most the length passed to 'PrepareRecord'.
+     */
+    void CommitRecord(unsigned int length);
+
+    //! Function returns the oldest record without releasing it (consumer thread only).
+    /*!
+     * \return True if record was returned, false if buffer is empty.
+     */
+    bool PeekRecord(record_view &record);
+
+    //! Function releases the oldest record (consumer thread only).
+    /*!
+     * \return True if record was released, false if buffer is empty.
+     */
+    bool ConsumeRecord(void) { return ConsumeRecords(1)==1; }
+
+    //! Function copies the oldest record and releases it (consumer thread only).
+    /*!
+     * \param data Memory where the record is copied.
+     * \param max_length Size of 'data' in bytes.
+     * \param length Length of the record (also when it does not fit into 'data').
+     * \return True if record was copied and released, false if buffer is empty or record does not fit.
+     */
+    bool PopRecord(unsigned char * data, unsigned int max_length, unsigned int &length);
+
+    //! Function returns up to 'max_records' oldest records without releasing them (consumer thread only).
+    /*!
+     * \brief Write position is loaded once for the whole batch.
+     * \return Number of records returned in 'records'.
+     */
+    unsigned int PeekRecords(record_view * records, unsigned int max_records);
+
+    //! Function releases up to 'count' oldest records with one update of read position (consumer thread only).
+    /*!
+     * \return Number of records really released.
+     */
+    unsigned int ConsumeRecords(unsigned int count);
+
+    //! Function returns true if there is no record to read.
+    bool IsEmpty(void) const { return write_ptr.load(std::memory_order_acquire)==read_ptr.load(std::memory_order_acquire); }
+
+    //! Function returns number of bytes occupied by records, headers and padding.
+    unsigned int GetUsedBytes(void) const { return write_ptr.load(std::memory_order_acquire)-read_ptr.load(std::memory_order_acquire); }
+
+    //! Function returns size of memory block in bytes.
+    unsigned int GetBufferSize(void) const { return buffer_size; }
+
+    //! Function returns the longest record that can be stored.
+    unsigned int GetMaxRecordLength(void) const { return buffer_size/2-RECORD_ALIGNMENT; }
+
+private:
+
+    //! Length in header marking padding up to the end of memory block.
+    static const unsigned int RECORD_PADDING = 0xFFFFFFFFu;
+
+    //! Function returns space occupied by record of 'length' bytes including header.
+    static unsigned int RecordSpace(unsigned int length) { return (length+2*RECORD_ALIGNMENT-1) & ~(unsigned int)(RECORD_ALIGNMENT-1); }
+
+    //! Function returns header of record at free-running position.
+    unsigned int & Header(unsigned int position) { return *reinterpret_cast<unsigned int*>(buffer+(position & index_mask)); }
+
+    //! Function reads record at position 'r' limited by 'w', skipping padding (consumer thread only).
+    /*!
+     * \return Position after the record, or 'r' if there is no record before 'w'.
+     */
+    unsigned int NextRecord(unsigned int r, unsigned int w, record_view &record);
+
+    //! Memory block (aligned by allocator).
+    unsigned char * buffer;
+
+    //! Size of memory block (power of two).
+    unsigned int buffer_size;
+
+    //! Mask converting free-running positions to buffer indexes.
+    unsigned int index_mask;
+
+    char padding_shared[RECORD_CACHE_LINE_SIZE];
+
+    //! Free-running position of the next record to be read. Written only by consumer.
+    std::atomic<unsigned int> read_ptr;
+
+    //! Consumer's last observed value of 'write_ptr'.
+    unsigned int cached_write_ptr;
+
+    char padding_consumer[RECORD_CACHE_LINE_SIZE];
+
+    //! Free-running position of the next record to be written. Written only by producer.
+    std::atomic<unsigned int> write_ptr;
+
+    //! Producer's last observed value of 'read_ptr'.
+    unsigned int cached_read_ptr;
+
+    //! Position of record reserved by 'PrepareRecord' (after padding, if any was needed).
+    unsigned int prepared_ptr;
+
+    //! Length reserved by 'PrepareRecord'.
+    unsigned int prepared_length;
+
+    char padding_producer[RECORD_CACHE_LINE_SIZE];
+
+};
+
+#endif // RECORDCYCLICBUFFER_H
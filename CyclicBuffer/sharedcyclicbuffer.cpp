@@ -0,0 +1,321 @@
+#include "sharedcyclicbuffer.h"
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SHARED_POSIX
+#endif
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#endif
+
+SharedCyclicBuffer::SharedCyclicBuffer(const char * name, unsigned int buf_size, shared_mode mode, int &success)
+    : header(NULL), buffer(NULL), mapping_size(0), buffer_size(0), index_mask(0), cached_write_ptr(0), cached_read_ptr(0)
+{
+    owned_name[0] = '\0';
+
+#if defined(SHARED_POSIX)
+    if(strlen(name) >= sizeof(owned_name))
+    {
+        success = CyclicBuffer::BUFFER_FILE_ERROR;
+        return;
+    }
+
+    unsigned int size = 1;
+    if(mode==SHARED_CREATE)
+    {
+        if(buf_size==0 || buf_size > 0x80000000u)
+        {
+            success = CyclicBuffer::BUFFER_INVALID_SIZE;
+            return;
+        }
+        while(size < buf_size)
+            size <<= 1;
+    }
+
+    // memory of the same name (stale one of crashed process or still mapped by other processes)
+    // is not truncated under its users, only its name is removed and new memory is created
+    if(mode==SHARED_CREATE)
+        shm_unlink(name);
+
+    int file = shm_open(name, mode==SHARED_CREATE ? (O_RDWR | O_CREAT | O_EXCL) : O_RDWR, 0600);
+    if(file<0)
+    {
+        success = CyclicBuffer::BUFFER_FILE_ERROR;
+        return;
+    }
+
+    size_t length;
+    if(mode==SHARED_CREATE)
+    {
+        length = SHARED_HEADER_SIZE+(size_t)size;
+        if(ftruncate(file, (off_t)length)!=0)
+        {
+            close(file);
+            shm_unlink(name);
+            success = CyclicBuffer::BUFFER_FILE_ERROR;
+            return;
+        }
+    }
+    else
+    {
+        struct stat info;
+        if(fstat(file, &info)!=0 || (size_t)info.st_size < SHARED_HEADER_SIZE)
+        {
+            close(file);
+            success = CyclicBuffer::BUFFER_INCOMPATIBLE;
+            return;
+        }
+        length = (size_t)info.st_size;
+    }
+
+    // mapping stays valid after the descriptor is closed
+    void * mapping = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    close(file);
+    if(mapping==MAP_FAILED)
+    {
+        if(mode==SHARED_CREATE)
+            shm_unlink(name);
+        success = CyclicBuffer::BUFFER_FILE_ERROR;
+        return;
+    }
+
+    header = static_cast<shared_header*>(mapping);
+    buffer = static_cast<unsigned char*>(mapping)+SHARED_HEADER_SIZE;
+    mapping_size = length;
+
+    if(mode==SHARED_CREATE)
+    {
+        header->version = SHARED_VERSION;
+        header->header_size = SHARED_HEADER_SIZE;
+        header->buffer_size = size;
+        header->read_ptr.store(0, std::memory_order_relaxed);
+        header->write_ptr.store(0, std::memory_order_relaxed);
+        header->consumer_sleeping.store(0, std::memory_order_relaxed);
+        // magic is written last, attaching process does not see half-initialized header
+        std::atomic_thread_fence(std::memory_order_release);
+        header->magic = SHARED_MAGIC;
+        strcpy(owned_name, name);
+    }
+    else
+    {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        size = header->buffer_size;
+        if(header->magic!=SHARED_MAGIC || header->version!=SHARED_VERSION || header->header_size!=SHARED_HEADER_SIZE ||
+           size==0 || (size & (size-1))!=0 || (size_t)size+SHARED_HEADER_SIZE!=length)
+        {
+            munmap(mapping, length);
+            header = NULL;
+            buffer = NULL;
+            success = CyclicBuffer::BUFFER_INCOMPATIBLE;
+            return;
+        }
+    }
+
+    buffer_size = size;
+    index_mask = size-1;
+    cached_read_ptr = header->read_ptr.load(std::memory_order_acquire);
+    cached_write_ptr = header->write_ptr.load(std::memory_order_acquire);
+    success = CyclicBuffer::BUFFER_OK;
+#else
+    (void)name;
+    (void)buf_size;
+    (void)mode;
+    success = CyclicBuffer::BUFFER_FILE_ERROR;
+#endif
+}
+
+SharedCyclicBuffer::~SharedCyclicBuffer()
+{
+#if defined(SHARED_POSIX)
+    if(header!=NULL)
+        munmap(header, mapping_size);
+    if(owned_name[0]!='\0')
+        shm_unlink(owned_name);
+#endif
+}
+
+unsigned int SharedCyclicBuffer::Available() const
+{
+    if(header==NULL)
+        return 0;
+    return header->write_ptr.load(std::memory_order_acquire)-header->read_ptr.load(std::memory_order_acquire);
+}
+
+unsigned int SharedCyclicBuffer::FreeSpace()
+{
+    if(header==NULL)
+        return 0;
+    cached_read_ptr = header->read_ptr.load(std::memory_order_acquire);
+    return buffer_size-(header->write_ptr.load(std::memory_order_relaxed)-cached_read_ptr);
+}
+
+size_t SharedCyclicBuffer::PushN(const unsigned char *data, size_t length)
+{
+    if(header==NULL)
+        return 0;
+
+    unsigned int w = header->write_ptr.load(std::memory_order_relaxed);
+    unsigned int free_space = buffer_size-(w-cached_read_ptr);
+
+    if(length > free_space)
+    {
+        // buffer looks full, check whether consumer has moved meanwhile
+        cached_read_ptr = header->read_ptr.load(std::memory_order_acquire);
+        free_space = buffer_size-(w-cached_read_ptr);
+        if(length > free_space)
+            length = free_space;
+    }
+
+    if(!length)
+        return 0;
+
+    unsigned int index = w & index_mask;
+    size_t first = buffer_size-index;
+    if(first > length)
+        first = length;
+
+    memcpy(buffer+index, data, first);
+    if(first < length)
+        memcpy(buffer, data+first, length-first);
+
+    header->write_ptr.store(w+(unsigned int)length, std::memory_order_release);
+    WakeConsumer();
+    return length;
+}
+
+void SharedCyclicBuffer::WakeConsumer()
+{
+    // pairs with the fence in 'WaitForData': either producer sees the sleeping flag,
+    // or consumer sees the new write position before it goes to sleep
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(header->consumer_sleeping.load(std::memory_order_relaxed)==0)
+        return;
+
+    header->consumer_sleeping.store(0, std::memory_order_relaxed);
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<int*>(&header->consumer_sleeping), FUTEX_WAKE, 1, NULL, NULL, 0);
+#endif
+}
+
+size_t SharedCyclicBuffer::PeekRead(CyclicBuffer::buffer_segments &segments, size_t max_length)
+{
+    segments.first = segments.second = NULL;
+    segments.first_length = segments.second_length = 0;
+    if(header==NULL)
+        return 0;
+
+    unsigned int r = header->read_ptr.load(std::memory_order_relaxed);
+    size_t length = cached_write_ptr-r;
+
+    if(length < max_length && length < buffer_size)
+    {
+        // buffer looks drained, check whether producer has moved meanwhile
+        cached_write_ptr = header->write_ptr.load(std::memory_order_acquire);
+        length = cached_write_ptr-r;
+    }
+
+    if(length > max_length)
+        length = max_length;
+    if(!length)
+        return 0;
+
+    unsigned int index = r & index_mask;
+    size_t first = buffer_size-index;
+    if(first > length)
+        first = length;
+
+    segments.first = buffer+index;
+    segments.first_length = first;
+    if(first < length)
+    {
+        segments.second = buffer;
+        segments.second_length = length-first;
+    }
+    return length;
+}
+
+size_t SharedCyclicBuffer::ConsumeRead(size_t length)
+{
+    if(header==NULL)
+        return 0;
+
+    unsigned int r = header->read_ptr.load(std::memory_order_relaxed);
+    if(length > cached_write_ptr-r)
+        length = cached_write_ptr-r;
+
+    header->read_ptr.store(r+(unsigned int)length, std::memory_order_release);
+    return length;
+}
+
+size_t SharedCyclicBuffer::PopN(unsigned char *data, size_t length)
+{
+    CyclicBuffer::buffer_segments segments;
+    length = PeekRead(segments, length);
+    if(!length)
+        return 0;
+
+    memcpy(data, segments.first, segments.first_length);
+    if(segments.second_length)
+        memcpy(data+segments.first_length, segments.second, segments.second_length);
+
+    return ConsumeRead(length);
+}
+
+CyclicBuffer::buffer_error SharedCyclicBuffer::WaitForData(size_t min_length, unsigned int timeout_ms)
+{
+    if(header==NULL)
+        return CyclicBuffer::BUFFER_TIMEOUT;
+    if(min_length > buffer_size)
+        min_length = buffer_size;
+
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now()+std::chrono::milliseconds(timeout_ms);
+    unsigned int r = header->read_ptr.load(std::memory_order_relaxed);
+
+    for(;;)
+    {
+        cached_write_ptr = header->write_ptr.load(std::memory_order_acquire);
+        if(cached_write_ptr-r >= min_length)
+            return CyclicBuffer::BUFFER_OK;
+
+        long long remaining_ns = 0;
+        if(timeout_ms)
+        {
+            remaining_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline-std::chrono::steady_clock::now()).count();
+            if(remaining_ns <= 0)
+            {
+                header->consumer_sleeping.store(0, std::memory_order_relaxed);
+                return CyclicBuffer::BUFFER_TIMEOUT;
+            }
+        }
+
+        // announce sleeping, then check again (see 'WakeConsumer')
+        header->consumer_sleeping.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        cached_write_ptr = header->write_ptr.load(std::memory_order_acquire);
+        if(cached_write_ptr-r >= min_length)
+        {
+            header->consumer_sleeping.store(0, std::memory_order_relaxed);
+            return CyclicBuffer::BUFFER_OK;
+        }
+
+#if defined(__linux__)
+        // futex returns at once if producer has already cleared the flag
+        struct timespec timeout;
+        timeout.tv_sec = (time_t)(remaining_ns/1000000000);
+        timeout.tv_nsec = (long)(remaining_ns%1000000000);
+        syscall(SYS_futex, reinterpret_cast<int*>(&header->consumer_sleeping), FUTEX_WAIT, 1, timeout_ms ? &timeout : NULL, NULL, 0);
+#else
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#endif
+    }
+}
@@ -0,0 +1,183 @@
+/*
+ * Author:      Peter Mikula
+ * Date:        10. 10. 2015
+ * Version:     0.1.1
+ *
+ */
+
+//! Lock-free cyclic buffer in POSIX shared memory for one producer process and one consumer process.
+/*!
+  The serial link reader can run in its own process, isolated from the
+  application parsing the data, without a pipe or socket between them. One
+  process creates the buffer under a name ('shm_open'), the other one attaches
+  to it by the same name. Both map the same memory, so pushed bytes are copied
+  only once (consumer can read them in place by 'PeekRead').
+
+  Synchronization is the same as in 'SpscCyclicBuffer': free-running positions
+  are process-shared atomics on separate cache lines, each side keeps a cached
+  copy of the other side's position. Consumer can sleep in 'WaitForData', it
+  is woken up by the producer through futex (on Linux) only if it really
+  sleeps, so pushing into a buffer with a busy consumer makes no system call.
+  Exactly one thread in one process may push and exactly one may pop.
+  */
+
+#ifndef SHAREDCYCLICBUFFER_H
+#define SHAREDCYCLICBUFFER_H
+
+#include <atomic>
+#include <cstddef>
+
+#include "cyclicbuffer.h"
+
+//! Size of cache line used to separate producer and consumer data.
+#define SHARED_CACHE_LINE_SIZE 64
+
+//! Identification of shared buffer memory ("CBSH").
+#define SHARED_MAGIC 0x48534243u
+
+//! Version of the shared memory layout.
+#define SHARED_VERSION 1u
+
+//! Size reserved for the header at the start of shared memory (one page).
+#define SHARED_HEADER_SIZE 4096u
+
+class SharedCyclicBuffer
+{
+
+public:
+
+    //! Way the constructor obtains the shared memory.
+    enum shared_mode {
+        SHARED_CREATE = 0, /*!< New shared memory is created, name of existing one is removed (processes that mapped it keep using the old memory). */
+        SHARED_ATTACH = 1 /*!< Shared memory created by other process is attached. */
+    };
+
+    //! Constructor creates or attaches the shared memory and maps it.
+    /*!
+     * \brief Created buffer size is rounded up to power of two. Process that created the
+     * buffer removes its name in destructor, mapping of attached process stays valid.
+     * \param name Name of shared memory, starting with '/' (see 'shm_open').
+     * \param buf_size Minimal size of buffer in bytes, ignored with 'SHARED_ATTACH'.
+     * \param mode 'SHARED_CREATE' or 'SHARED_ATTACH'.
+     * \param success BUFFER_OK, BUFFER_INVALID_SIZE, BUFFER_FILE_ERROR if memory can not be created,
+     * opened or mapped, BUFFER_INCOMPATIBLE if attached memory is not initialized buffer of this version
+     * (see 'CyclicBuffer::buffer_error').
+     */
+    SharedCyclicBuffer(const char * name, unsigned int buf_size, shared_mode mode, int &success);
+
+    //! Destructor unmaps the shared memory (and removes its name if it was created by this object).
+    ~SharedCyclicBuffer(void);
+
+    //! Function is about to push new value to the buffer (producer only).
+    /*!
+     * \return True if value was written, false if buffer is full.
+     */
+    bool Push(unsigned char ch) { return PushN(&ch, 1)==1; }
+
+    //! Function is about to retrieve the value from the buffer (consumer only).
+    /*!
+     * \return True if value was retrieved, false if there is nothing to read.
+     */
+    bool Pop(unsigned char &ch) { return PopN(&ch, 1)==1; }
+
+    //! Function is about to push block of values to the buffer (producer only).
+    /*!
+     * \brief Unread data are never overwritten. Sleeping consumer is woken up.
+     * \return Number of bytes really written into buffer.
+     */
+    size_t PushN(const unsigned char * data, size_t length);
+
+    //! Function is about to retrieve block of values from the buffer (consumer only).
+    /*!
+     * \return Number of bytes really retrieved from buffer.
+     */
+    size_t PopN(unsigned char * data, size_t length);
+
+    //! Function returns unread data in place in shared memory (consumer only).
+    /*!
+     * \param segments Filled with at most two regions of unread data.
+     * \param max_length Maximal number of bytes returned.
+     * \return Number of bytes returned in 'segments'.
+     */
+    size_t PeekRead(CyclicBuffer::buffer_segments &segments, size_t max_length = (size_t)-1);
+
+    //! Function releases bytes returned by 'PeekRead' (consumer only).
+    /*!
+     * \return Number of bytes really released.
+     */
+    size_t ConsumeRead(size_t length);
+
+    //! Function waits until at least 'min_length' bytes are availible for reading (consumer only).
+    /*!
+     * \param min_length Number of bytes to wait for (limited to buffer size).
+     * \param timeout_ms Maximal time to wait in milliseconds (0 waits forever).
+     * \return BUFFER_OK if data are availible, BUFFER_TIMEOUT otherwise.
+     */
+    CyclicBuffer::buffer_error WaitForData(size_t min_length = 1, unsigned int timeout_ms = 0);
+
+    //! Function returns number of bytes waiting for reading.
+    unsigned int Available(void) const;
+
+    //! Function returns number of bytes that can be pushed (producer only).
+    unsigned int FreeSpace(void);
+
+    //! Function returns true if there is nothing to read.
+    bool IsEmpty(void) const { return Available()==0; }
+
+    //! Function returns the size of buffer in bytes.
+    unsigned int GetBufferSize(void) const { return buffer_size; }
+
+private:
+
+    //! Layout of shared memory header (followed by buffer memory at 'SHARED_HEADER_SIZE').
+    struct shared_header {
+        unsigned int magic; /*!< 'SHARED_MAGIC', written last by creator. */
+        unsigned int version; /*!< 'SHARED_VERSION'. */
+        unsigned int header_size; /*!< Offset of buffer memory. */
+        unsigned int buffer_size; /*!< Size of buffer memory (power of two). */
+        char padding_shared[SHARED_CACHE_LINE_SIZE];
+        std::atomic<unsigned int> read_ptr; /*!< Free-running read position, written by consumer. */
+        char padding_consumer[SHARED_CACHE_LINE_SIZE];
+        std::atomic<unsigned int> write_ptr; /*!< Free-running write position, written by producer. */
+        char padding_producer[SHARED_CACHE_LINE_SIZE];
+        std::atomic<int> consumer_sleeping; /*!< Futex word, nonzero while consumer is going to sleep. */
+        char padding_futex[SHARED_CACHE_LINE_SIZE];
+    };
+
+    // atomics shared by processes must not be implemented with process-local locks
+    static_assert(ATOMIC_INT_LOCK_FREE==2, "shared memory header requires always lock-free std::atomic<int>");
+
+    //! Function wakes up consumer if it sleeps (producer only).
+    void WakeConsumer(void);
+
+    //! Mapped shared memory (the header).
+    shared_header * header;
+
+    //! Buffer memory in the mapping.
+    unsigned char * buffer;
+
+    //! Size of the whole mapping.
+    size_t mapping_size;
+
+    //! Size of buffer and mask converting positions to indexes.
+    unsigned int buffer_size;
+    unsigned int index_mask;
+
+    //! Name of shared memory removed by destructor, empty if memory was attached.
+    char owned_name[256];
+
+    char padding_local[SHARED_CACHE_LINE_SIZE];
+
+    //! Consumer's last observed value of 'write_ptr'.
+    unsigned int cached_write_ptr;
+
+    char padding_consumer[SHARED_CACHE_LINE_SIZE];
+
+    //! Producer's last observed value of 'read_ptr'.
+    unsigned int cached_read_ptr;
+
+    char padding_producer[SHARED_CACHE_LINE_SIZE];
+
+};
+
+#endif // SHAREDCYCLICBUFFER_H
@@ -0,0 +1,278 @@
+#include "spsccyclicbuffer.h"
+#include "buffernotifier.h"
+
+#include <cstring>
+#include <new>
+
+SpscCyclicBuffer::SpscCyclicBuffer(unsigned int buf_size, int & success)
+    : read_ptr(0), cached_write_ptr(0), consumer_storage(NULL), write_ptr(0), cached_read_ptr(0), producer_storage(NULL), producer_start(0), notifier(NULL)
+{
+    storage_generation * storage = AllocateGeneration(buf_size, success);
+    if(storage==NULL)
+        return;
+
+    // buffer starts filled by zeros
+    memset(storage->buffer, 0, storage->buffer_size);
+    consumer_storage = producer_storage = storage;
+}
+
+SpscCyclicBuffer::~SpscCyclicBuffer()
+{
+    // sealed blocks not drained by consumer are still chained behind its block
+    storage_generation * storage = consumer_storage;
+    while(storage!=NULL)
+    {
+        storage_generation * next = storage->next.load(std::memory_order_relaxed);
+        ReleaseGeneration(storage);
+        storage = next;
+    }
+}
+
+SpscCyclicBuffer::storage_generation * SpscCyclicBuffer::AllocateGeneration(unsigned int buf_size, int &success)
+{
+    // positions are free-running, their difference must fit into unsigned int
+    if(buf_size==0 || buf_size > 0x80000000u)
+    {
+        success = CyclicBuffer::BUFFER_INVALID_SIZE;
+        return NULL;
+    }
+
+    // round size up to power of two
+    unsigned int size = 1;
+    while(size < buf_size)
+        size <<= 1;
+
+    storage_generation * storage = new (std::nothrow) storage_generation;
+    if(storage==NULL)
+    {
+        success = CyclicBuffer::BUFFER_ALLOCATION_ERROR;
+        return NULL;
+    }
+
+    storage->buffer = new (std::nothrow) unsigned char[size];
+    if(storage->buffer==NULL)
+    {
+        delete storage;
+        success = CyclicBuffer::BUFFER_ALLOCATION_ERROR;
+        return NULL;
+    }
+
+    storage->buffer_size = size;
+    storage->index_mask = size-1;
+    storage->end = 0;
+    storage->next.store(NULL, std::memory_order_relaxed);
+
+    success = CyclicBuffer::BUFFER_OK;
+    return storage;
+}
+
+void SpscCyclicBuffer::ReleaseGeneration(storage_generation * storage)
+{
+    delete [] storage->buffer;
+    delete storage;
+}
+
+CyclicBuffer::buffer_error SpscCyclicBuffer::Resize(unsigned int buf_size)
+{
+    // new block is never read before it is written, so it is not cleared
+    int success;
+    storage_generation * storage = AllocateGeneration(buf_size, success);
+    if(storage==NULL)
+        return (CyclicBuffer::buffer_error)success;
+
+    unsigned int w = write_ptr.load(std::memory_order_relaxed);
+
+    // seal the current block, from now on it belongs to consumer
+    producer_storage->end = w;
+    producer_storage->next.store(storage, std::memory_order_release);
+
+    producer_storage = storage;
+    producer_start = w;
+    cached_read_ptr = w;
+
+    return CyclicBuffer::BUFFER_OK;
+}
+
+unsigned int SpscCyclicBuffer::FreeSpace()
+{
+    RefreshReadPtr();
+    return producer_storage->buffer_size-(write_ptr.load(std::memory_order_relaxed)-cached_read_ptr);
+}
+
+void SpscCyclicBuffer::RefreshReadPtr()
+{
+    unsigned int r = read_ptr.load(std::memory_order_acquire);
+
+    // data read from sealed blocks do not free space in producer's block
+    cached_read_ptr = ((int)(r-producer_start) > 0) ? r : producer_start;
+}
+
+void SpscCyclicBuffer::RefreshWritePtr(unsigned int r)
+{
+    for(;;)
+    {
+        // 'next' is loaded after 'write_ptr', so positions behind a seal are never missed
+        unsigned int w = write_ptr.load(std::memory_order_acquire);
+        storage_generation * next = consumer_storage->next.load(std::memory_order_acquire);
+
+        if(next==NULL)
+        {
+            cached_write_ptr = w;
+            return;
+        }
+
+        if(r!=consumer_storage->end)
+        {
+            // drain the sealed block first
+            cached_write_ptr = consumer_storage->end;
+            return;
+        }
+
+        // sealed block is drained and producer does not use it anymore
+        ReleaseGeneration(consumer_storage);
+        consumer_storage = next;
+    }
+}
+
+void SpscCyclicBuffer::NotifyPushed(unsigned int w, size_t length)
+{
+    storage_generation * storage = producer_storage;
+    CyclicBuffer::buffer_segments segments;
+    unsigned int index = w & storage->index_mask;
+    size_t first = storage->buffer_size-index;
+    if(first > length)
+        first = length;
+
+    segments.first = storage->buffer+index;
+    segments.first_length = first;
+    segments.second = storage->buffer;
+    segments.second_length = length-first;
+
+    // occupancy seen by producer may be higher than real, spurious signal is harmless
+    notifier->Check(segments, (w+(unsigned int)length)-cached_read_ptr);
+}
+
+void SpscCyclicBuffer::AcknowledgeNotification()
+{
+    if(notifier==NULL)
+        return;
+
+    notifier->Rearm();
+
+    // only the consumer's block is checked, data in newer blocks signal when they are pushed
+    unsigned int r = read_ptr.load(std::memory_order_relaxed);
+    RefreshWritePtr(r);
+    storage_generation * storage = consumer_storage;
+    size_t length = cached_write_ptr-r;
+
+    CyclicBuffer::buffer_segments segments;
+    unsigned int index = r & storage->index_mask;
+    size_t first = storage->buffer_size-index;
+    if(first > length)
+        first = length;
+
+    segments.first = storage->buffer+index;
+    segments.first_length = first;
+    segments.second = storage->buffer;
+    segments.second_length = length-first;
+    notifier->Check(segments, length);
+}
+
+bool SpscCyclicBuffer::Push(unsigned char ch)
+{
+    unsigned int w = write_ptr.load(std::memory_order_relaxed);
+
+    if(w-cached_read_ptr == producer_storage->buffer_size)
+    {
+        // buffer looks full, check whether consumer has moved meanwhile
+        RefreshReadPtr();
+        if(w-cached_read_ptr == producer_storage->buffer_size)
+            return false;
+    }
+
+    producer_storage->buffer[w & producer_storage->index_mask] = ch;
+    write_ptr.store(w+1, std::memory_order_release);
+    if(notifier!=NULL)
+        NotifyPushed(w, 1);
+    return true;
+}
+
+bool SpscCyclicBuffer::Pop(unsigned char &ch)
+{
+    unsigned int r = read_ptr.load(std::memory_order_relaxed);
+
+    if(r == cached_write_ptr)
+    {
+        // buffer looks empty, check whether producer has moved meanwhile
+        RefreshWritePtr(r);
+        if(r == cached_write_ptr)
+            return false;
+    }
+
+    ch = consumer_storage->buffer[r & consumer_storage->index_mask];
+    read_ptr.store(r+1, std::memory_order_release);
+    return true;
+}
+
+size_t SpscCyclicBuffer::PushN(const unsigned char * data, size_t length)
+{
+    storage_generation * storage = producer_storage;
+    unsigned int w = write_ptr.load(std::memory_order_relaxed);
+    unsigned int free_space = storage->buffer_size-(w-cached_read_ptr);
+
+    if(length > free_space)
+    {
+        RefreshReadPtr();
+        free_space = storage->buffer_size-(w-cached_read_ptr);
+        if(length > free_space)
+            length = free_space;
+    }
+
+    if(!length)
+        return 0;
+
+    // first segment ends at the end of memory block, the rest continues from its beginning
+    unsigned int index = w & storage->index_mask;
+    size_t first = storage->buffer_size-index;
+    if(first > length)
+        first = length;
+
+    memcpy(storage->buffer+index, data, first);
+    if(first < length)
+        memcpy(storage->buffer, data+first, length-first);
+
+    write_ptr.store(w+(unsigned int)length, std::memory_order_release);
+    if(notifier!=NULL)
+        NotifyPushed(w, length);
+    return length;
+}
+
+size_t SpscCyclicBuffer::PopN(unsigned char * data, size_t length)
+{
+    unsigned int r = read_ptr.load(std::memory_order_relaxed);
+    unsigned int unread = cached_write_ptr-r;
+
+    if(length > unread)
+    {
+        RefreshWritePtr(r);
+        unread = cached_write_ptr-r;
+        if(length > unread)
+            length = unread;
+    }
+
+    if(!length)
+        return 0;
+
+    storage_generation * storage = consumer_storage;
+    unsigned int index = r & storage->index_mask;
+    size_t first = storage->buffer_size-index;
+    if(first > length)
+        first = length;
+
+    memcpy(data, storage->buffer+index, first);
+    if(first < length)
+        memcpy(data+first, storage->buffer, length-first);
+
+    read_ptr.store(r+(unsigned int)length, std::memory_order_release);
+    return length;
+}
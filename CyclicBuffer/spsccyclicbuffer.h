@@ -0,0 +1,194 @@
+/*
+ * Author:      Peter Mikula
+ * Date:        10. 10. 2015
+ * Version:     0.1.1
+ *
+ */
+
+//! Lock-free cyclic buffer for one producer thread and one consumer thread.
+/*!
+  Typical receiver application has one thread draining the serial link
+  (RS232, FTDI, ...) and another thread parsing packets. This class allows
+  these two threads to share the buffer without any mutex. Read and write
+  positions are atomic free-running counters published with release ordering
+  and observed with acquire ordering. Producer and consumer state are placed on
+  separate cache lines so the threads do not invalidate each other's cache
+  when only their own position changes. Exactly one thread may call push
+  functions and exactly one (other) thread may call pop functions.
+
+  The buffer can be resized by the producer during traffic without stopping
+  it. Memory blocks form generations: producer seals the current block at its
+  write position and continues writing into the new one immediately, nothing
+  is copied. Consumer drains the sealed block, then switches to the new block
+  and frees the old one (RCU-like handoff, the producer never touches a sealed
+  block again).
+  */
+
+#ifndef SPSCCYCLICBUFFER_H
+#define SPSCCYCLICBUFFER_H
+
+#include <atomic>
+#include <cstddef>
+
+#include "cyclicbuffer.h"
+
+class BufferNotifier;
+
+//! Size of cache line used to separate producer and consumer data.
+#define SPSC_CACHE_LINE_SIZE 64
+
+class SpscCyclicBuffer
+{
+
+public:
+
+    //! Construcor of buffer class. Ensures basic initialization and memory allocation.
+    /*!
+     * \brief The constructor will initialize both positions to zero and allocates
+     * required memory. Requested size is rounded up to the nearest power of two, so
+     * wrapping of positions can be done by masking.
+     * \param buf_size an integer number representing the minimal buffer size in bytes.
+     * \param success if memory was allocated successfully, the return value is 0, otherwise the error code (see 'CyclicBuffer::buffer_error').
+     */
+    SpscCyclicBuffer(unsigned int buf_size, int &success);
+
+    //! Destructor of buffer class. Frees allocated memory.
+    ~SpscCyclicBuffer(void);
+
+    //! Function is about to push new value to the buffer (producer thread only).
+    /*!
+     * \brief Unread data are never overwritten.
+     * \param ch New value to be written into buffer.
+     * \return True if value was written, false if buffer is full.
+     */
+    bool Push(unsigned char ch);
+
+    //! Function is about to retrieve the value from the buffer (consumer thread only).
+    /*!
+     * \param ch Reference where retrieved value is stored.
+     * \return True if value was retrieved, false if there is nothing to read.
+     */
+    bool Pop(unsigned char &ch);
+
+    //! Function is about to push block of values to the buffer (producer thread only).
+    /*!
+     * \brief Data are copied with at most two memory copies and published to the consumer at once.
+     * \param data Pointer to the values to be written into buffer.
+     * \param length Number of bytes requested to be written.
+     * \return Number of bytes really written into buffer.
+     */
+    size_t PushN(const unsigned char * data, size_t length);
+
+    //! Function is about to retrieve block of values from the buffer (consumer thread only).
+    /*!
+     * \param data Pointer to the memory where retrieved values will be stored.
+     * \param length Maximal number of bytes to be retrieved.
+     * \return Number of bytes really retrieved from buffer.
+     */
+    size_t PopN(unsigned char * data, size_t length);
+
+    //! Function replaces memory block by a block of new size (producer thread only).
+    /*!
+     * \brief Producer continues writing to the new block at once, unread data stay in the old
+     * block until consumer reads them, so consumer receives all bytes in order. Until then
+     * 'Available' may be greater than the new buffer size.
+     * \param buf_size Minimal new buffer size in bytes, rounded up to power of two.
+     * \return BUFFER_OK, or error code if size is invalid or memory could not be allocated.
+     */
+    CyclicBuffer::buffer_error Resize(unsigned int buf_size);
+
+    //! Function attaches readiness notifier signalled by pushes (before the buffer is shared, NULL detaches it).
+    /*!
+     * \param buffer_notifier Notifier whose descriptor becomes readable when buffer is ready (see 'BufferNotifier').
+     */
+    void SetNotifier(BufferNotifier * buffer_notifier) { notifier = buffer_notifier; }
+
+    //! Function acknowledges notification after consumer has read the data (consumer thread only).
+    /*!
+     * \brief Descriptor of the notifier is cleared and notifier is armed again. If unread data
+     * still satisfy its condition, descriptor becomes readable at once.
+     */
+    void AcknowledgeNotification(void);
+
+    //! Function returns number of bytes waiting for reading.
+    /*!
+     * \brief If called from other than consumer thread, the value is only a snapshot.
+     */
+    unsigned int Available(void) const { return write_ptr.load(std::memory_order_acquire)-read_ptr.load(std::memory_order_acquire); }
+
+    //! Function returns number of bytes that can be pushed without overwriting unread data (producer thread only).
+    unsigned int FreeSpace(void);
+
+    //! Function returns true if there is nothing to read.
+    bool IsEmpty(void) const { return Available()==0; }
+
+    //! Function returns the total bytes availible in memory for the buffer (producer thread only).
+    unsigned int GetBufferSize(void) const { return producer_storage->buffer_size; }
+
+private:
+
+    //! One generation of buffer memory block.
+    struct storage_generation {
+        unsigned char * buffer; /*!< Pointer to the buffer memory block. */
+        unsigned int buffer_size; /*!< Size of buffer memory block (always power of two). */
+        unsigned int index_mask; /*!< Mask converting free-running positions to buffer indexes. */
+        unsigned int end; /*!< Position where producer sealed the block, valid once 'next' is set. */
+        std::atomic<storage_generation*> next; /*!< Block used after this one, published by producer. */
+    };
+
+    //! Function allocates new generation of memory block, size is rounded up to power of two.
+    static storage_generation * AllocateGeneration(unsigned int buf_size, int &success);
+
+    //! Function releases generation of memory block.
+    static void ReleaseGeneration(storage_generation * storage);
+
+    //! Function reloads 'write_ptr' and limits it to the end of the consumer's block (consumer thread only).
+    /*!
+     * \brief If the consumer's block is sealed and drained, consumer switches to the next block and frees it.
+     */
+    void RefreshWritePtr(unsigned int r);
+
+    //! Function reloads 'read_ptr', never before the start of the producer's block (producer thread only).
+    void RefreshReadPtr(void);
+
+    //! Function passes 'length' bytes pushed at position 'w' to the notifier (producer thread only).
+    void NotifyPushed(unsigned int w, size_t length);
+
+    char padding_shared[SPSC_CACHE_LINE_SIZE];
+
+    //! Free-running position of next byte to be read. Written only by consumer.
+    std::atomic<unsigned int> read_ptr;
+
+    //! Consumer's last observed value of 'write_ptr'.
+    /*!
+      Consumer reloads the atomic 'write_ptr' (and so touches producer's cache line)
+      only when this cached value says there is not enough data. It never points
+      behind the end of the consumer's block.
+     */
+    unsigned int cached_write_ptr;
+
+    //! Memory block read by consumer.
+    storage_generation * consumer_storage;
+
+    char padding_consumer[SPSC_CACHE_LINE_SIZE];
+
+    //! Free-running position of next byte to be written. Written only by producer.
+    std::atomic<unsigned int> write_ptr;
+
+    //! Producer's last observed value of 'read_ptr', or start of producer's block if it is greater.
+    unsigned int cached_read_ptr;
+
+    //! Memory block written by producer.
+    storage_generation * producer_storage;
+
+    //! Free-running position where producer started writing into its block.
+    unsigned int producer_start;
+
+    //! Readiness notifier or NULL.
+    BufferNotifier * notifier;
+
+    char padding_producer[SPSC_CACHE_LINE_SIZE];
+
+};
+
+#endif // SPSCCYCLICBUFFER_H
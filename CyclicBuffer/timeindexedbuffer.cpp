@@ -0,0 +1,142 @@
+#include "timeindexedbuffer.h"
+
+#include <new>
+
+TimeIndexedBuffer::TimeIndexedBuffer(unsigned int buf_size, unsigned int max_packets, int &success)
+    : buffer(buf_size, success), index(NULL), index_mask(0), index_head(0), index_tail(0), write_position(0), last_timestamp(0)
+{
+    if(success!=CyclicBuffer::BUFFER_OK)
+        return;
+
+    if(max_packets==0 || max_packets > 0x80000000u)
+    {
+        success = CyclicBuffer::BUFFER_INVALID_SIZE;
+        return;
+    }
+
+    unsigned int size = 1;
+    while(size < max_packets)
+        size <<= 1;
+
+    index = new (std::nothrow) time_entry[size];
+    if(index==NULL)
+    {
+        success = CyclicBuffer::BUFFER_ALLOCATION_ERROR;
+        return;
+    }
+    index_mask = size-1;
+}
+
+TimeIndexedBuffer::~TimeIndexedBuffer()
+{
+    delete [] index;
+}
+
+CyclicBuffer::buffer_error TimeIndexedBuffer::PushPacket(unsigned long long timestamp, const unsigned char *data, size_t length)
+{
+    if(index==NULL || length==0 || length > buffer.GetBufferSize())
+        return CyclicBuffer::BUFFER_INCORRECT_SIZE;
+
+    if(timestamp < last_timestamp)
+        return CyclicBuffer::BUFFER_TIMESTAMP_ORDER;
+
+    // packet is never stored partially
+    if(buffer.GetOverflowPolicy()!=CyclicBuffer::BUFFER_OVERWRITE_OLDEST && buffer.FreeSpace() < length)
+        return CyclicBuffer::BUFFER_FULL;
+
+    buffer.PushN(data, length);
+
+    // full index loses its oldest entry
+    if(index_tail-index_head > index_mask)
+        index_head++;
+
+    time_entry &entry = Entry(index_tail++);
+    entry.timestamp = timestamp;
+    entry.position = write_position;
+
+    write_position += length;
+    last_timestamp = timestamp;
+    return CyclicBuffer::BUFFER_OK;
+}
+
+void TimeIndexedBuffer::Prune()
+{
+    // packets are ordered by position, so entries are dropped from the oldest one
+    unsigned long long read_position = GetReadPosition();
+    while(index_head!=index_tail && Entry(index_head).position < read_position)
+        index_head++;
+}
+
+unsigned int TimeIndexedBuffer::Seek(unsigned long long timestamp)
+{
+    Prune();
+
+    // the first entry with timestamp >= 'timestamp' (timestamps never decrease)
+    unsigned int low = index_head, count = index_tail-index_head;
+    while(count > 0)
+    {
+        unsigned int half = count/2;
+        if(Entry(low+half).timestamp < timestamp)
+        {
+            low += half+1;
+            count -= half+1;
+        }
+        else
+            count = half;
+    }
+    return low;
+}
+
+bool TimeIndexedBuffer::GetPacket(unsigned int entry, time_packet &packet)
+{
+    Prune();
+    if(entry-index_head >= index_tail-index_head)
+        return false;
+
+    const time_entry &item = Entry(entry);
+    packet.timestamp = item.timestamp;
+    packet.position = item.position;
+    packet.length = (size_t)((entry+1!=index_tail ? Entry(entry+1).position : write_position)-item.position);
+
+    // packet is a slice of unread data
+    CyclicBuffer::buffer_segments unread;
+    buffer.PeekRead(unread);
+    size_t offset = (size_t)(item.position-GetReadPosition());
+
+    if(offset < unread.first_length)
+    {
+        packet.data.first = unread.first+offset;
+        packet.data.first_length = unread.first_length-offset;
+        if(packet.data.first_length >= packet.length)
+        {
+            packet.data.first_length = packet.length;
+            packet.data.second = NULL;
+            packet.data.second_length = 0;
+        }
+        else
+        {
+            packet.data.second = unread.second;
+            packet.data.second_length = packet.length-packet.data.first_length;
+        }
+    }
+    else
+    {
+        packet.data.first = unread.second+(offset-unread.first_length);
+        packet.data.first_length = packet.length;
+        packet.data.second = NULL;
+        packet.data.second_length = 0;
+    }
+    return true;
+}
+
+unsigned int TimeIndexedBuffer::GetWindow(unsigned long long from, unsigned long long to, time_packet *packets, unsigned int max_packets)
+{
+    unsigned int count = 0;
+    for(unsigned int entry=Seek(from); entry!=index_tail && count < max_packets; entry++)
+    {
+        if(Entry(entry).timestamp > to)
+            break;
+        GetPacket(entry, packets[count++]);
+    }
+    return count;
+}
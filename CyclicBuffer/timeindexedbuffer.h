@@ -0,0 +1,145 @@
+/*
+ * Author:      Peter Mikula
+ * Date:        10. 10. 2015
+ * Version:     0.1.1
+ *
+ */
+
+//! Cyclic buffer of packets indexed by measurement timestamp.
+/*!
+  Tracker queries like "all packets of the last 200 ms" or "all packets since
+  timestamp T" would otherwise walk the whole buffer and decode time field of
+  every packet. This class keeps a compact ring of (timestamp, stream position)
+  entries next to the 'CyclicBuffer' holding packet bytes. Entries are appended
+  by 'PushPacket' and pruned lazily once their packet has been read or overwritten,
+  so the index always describes packets still in the buffer. Timestamps must not
+  decrease, therefore seeking is a binary search over the index, and packets of
+  a time window are returned in place (at most two regions each), without copying.
+
+  All pushes have to go through 'PushPacket'. Consumer may read bytes directly
+  from 'GetBuffer()', the index follows its read position. Indexes and borders
+  of the buffer must not be changed while it is indexed.
+  */
+
+#ifndef TIMEINDEXEDBUFFER_H
+#define TIMEINDEXEDBUFFER_H
+
+#include <cstddef>
+
+#include "cyclicbuffer.h"
+
+class TimeIndexedBuffer
+{
+
+public:
+
+    //! Packet returned by index queries.
+    struct time_packet {
+        unsigned long long timestamp; /*!< Timestamp given to 'PushPacket'. */
+        unsigned long long position; /*!< Stream position of the first byte of packet. */
+        size_t length; /*!< Length of packet in bytes. */
+        CyclicBuffer::buffer_segments data; /*!< Packet bytes in place in the buffer (valid until next push or pop). */
+    };
+
+    //! Constructor allocates the buffer and the index.
+    /*!
+     * \param buf_size Size of packet buffer in bytes.
+     * \param max_packets Minimal number of index entries, rounded up to power of two. If the index
+     * is full, the oldest entry is dropped (its packet stays in buffer but can not be found by time).
+     * \param success BUFFER_OK or error code (see 'CyclicBuffer::buffer_error').
+     */
+    TimeIndexedBuffer(unsigned int buf_size, unsigned int max_packets, int &success);
+
+    //! Destructor frees the index.
+    ~TimeIndexedBuffer(void);
+
+    //! Function pushes packet and appends its index entry.
+    /*!
+     * \brief Overflow policy of the buffer is applied to whole packet: with 'BUFFER_OVERWRITE_OLDEST'
+     * older packets are overwritten, otherwise the packet is stored entirely or not at all.
+     * \param timestamp Measurement time of packet (any unit), not less than timestamp of previous packet.
+     * \param data Packet bytes.
+     * \param length Length of packet, at most the buffer size.
+     * \return BUFFER_OK, BUFFER_FULL, BUFFER_INCORRECT_SIZE if packet is empty or longer than buffer,
+     * or BUFFER_TIMESTAMP_ORDER if timestamp is older than the last one.
+     */
+    CyclicBuffer::buffer_error PushPacket(unsigned long long timestamp, const unsigned char * data, size_t length);
+
+    //! Function returns entry number of the first packet with timestamp not less than 'timestamp'.
+    /*!
+     * \brief Binary search over entries of unread packets. Entry numbers are free-running, valid
+     * entries are from 'GetFirstEntry()' to 'GetEndEntry()' (exclusive).
+     * \return Entry number, 'GetEndEntry()' if all packets are older.
+     */
+    unsigned int Seek(unsigned long long timestamp);
+
+    //! Function returns packet of the entry number.
+    /*!
+     * \return True if entry is valid (its packet is still unread), false otherwise.
+     */
+    bool GetPacket(unsigned int entry, time_packet &packet);
+
+    //! Function returns packets with timestamps in range <from, to> (both inclusive).
+    /*!
+     * \param packets Array filled with packets in order of timestamps.
+     * \param max_packets Size of 'packets' array.
+     * \return Number of packets returned.
+     */
+    unsigned int GetWindow(unsigned long long from, unsigned long long to, time_packet * packets, unsigned int max_packets);
+
+    //! Function returns entry number of the oldest unread packet.
+    unsigned int GetFirstEntry(void) { Prune(); return index_head; }
+
+    //! Function returns entry number following the newest packet.
+    unsigned int GetEndEntry(void) { return index_tail; }
+
+    //! Function returns number of indexed packets.
+    unsigned int GetPacketCount(void) { Prune(); return index_tail-index_head; }
+
+    //! Function returns the buffer holding packet bytes (consumer reads it directly).
+    CyclicBuffer & GetBuffer(void) { return buffer; }
+
+    //! Function returns stream position following the newest byte.
+    unsigned long long GetWritePosition(void) { return write_position; }
+
+    //! Function returns stream position of the oldest unread byte.
+    unsigned long long GetReadPosition(void) { return write_position-buffer.Available(); }
+
+private:
+
+    //! One entry of the index.
+    struct time_entry {
+        unsigned long long timestamp; /*!< Timestamp of packet. */
+        unsigned long long position; /*!< Stream position of the first byte of packet. */
+    };
+
+    //! Function drops entries of packets that were read or overwritten.
+    void Prune(void);
+
+    //! Function returns entry by its free-running number.
+    time_entry & Entry(unsigned int entry) { return index[entry & index_mask]; }
+
+    //! Buffer holding packet bytes.
+    CyclicBuffer buffer;
+
+    //! Ring of index entries.
+    time_entry * index;
+
+    //! Mask converting entry numbers to 'index' offsets.
+    unsigned int index_mask;
+
+    //! Entry number of the oldest entry.
+    unsigned int index_head;
+
+    //! Entry number following the newest entry.
+    unsigned int index_tail;
+
+    //! Total number of bytes pushed (stream position of the next byte).
+    unsigned long long write_position;
+
+    //! Timestamp of the newest packet.
+    unsigned long long last_timestamp;
+
+};
+
+#endif // TIMEINDEXEDBUFFER_H
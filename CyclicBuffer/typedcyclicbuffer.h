@@ -0,0 +1,284 @@
+/*
+ * Author:      Peter Mikula
+ * Date:        10. 10. 2015
+ * Version:     0.1.1
+ *
+ */
+
+//! Cyclic buffer template for values of any type.
+/*!
+  While 'CyclicBuffer' stores raw bytes coming from the serial link, decoded
+  data (e.g. target records containing radar ID, timestamp and coordinates)
+  need to be buffered as well. This template stores values of type T.
+  If 'Capacity' is given, storage is placed inline (no allocation) and when
+  it is power of two, positions wrap by masking instead of compare-and-branch.
+  If 'Capacity' is 0 (default), size is given at runtime to the constructor.
+  Values are constructed in place and destroyed when popped, so types with
+  non-trivial constructors and destructors are handled correctly. Unread values
+  are never overwritten, push into full buffer is refused.
+  */
+
+#ifndef TYPEDCYCLICBUFFER_H
+#define TYPEDCYCLICBUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "cyclicbuffer.h"
+
+//! Storage of 'TypedCyclicBuffer' with fixed capacity placed inline.
+template <typename T, unsigned int Capacity>
+class TypedCyclicStorage
+{
+
+public:
+
+    //! True if positions can be wrapped by masking.
+    static const bool power_of_two = (Capacity & (Capacity-1))==0;
+
+    TypedCyclicStorage(void) {}
+
+    T * Slots(void) { return reinterpret_cast<T *>(slots); }
+
+    unsigned int Size(void) const { return Capacity; }
+
+    //! Function returns index following 'index'. Condition is resolved at compile time.
+    unsigned int Next(unsigned int index) const
+    {
+        if(power_of_two)
+            return (index+1) & (Capacity-1);
+        return (index+1==Capacity) ? 0 : index+1;
+    }
+
+    //! Function returns index 'offset' slots after 'index' ('offset' is less than capacity).
+    unsigned int Advance(unsigned int index, unsigned int offset) const
+    {
+        if(power_of_two)
+            return (index+offset) & (Capacity-1);
+        index += offset;
+        return (index >= Capacity) ? index-Capacity : index;
+    }
+
+private:
+
+    typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type slots[Capacity];
+
+    TypedCyclicStorage(const TypedCyclicStorage &);
+    TypedCyclicStorage & operator=(const TypedCyclicStorage &);
+
+};
+
+//! Storage of 'TypedCyclicBuffer' with capacity given at runtime.
+template <typename T>
+class TypedCyclicStorage<T, 0>
+{
+
+public:
+
+    TypedCyclicStorage(void) : memory(NULL), slots(NULL), size(0), mask(0) {}
+
+    ~TypedCyclicStorage(void) { ::operator delete(memory); }
+
+    //! Function allocates memory for 'buf_size' values (not constructed).
+    bool Allocate(unsigned int buf_size)
+    {
+        // '::operator new' guarantees only fundamental alignment, over-aligned T is aligned manually
+        const size_t alignment = std::alignment_of<T>::value;
+        const size_t extra = alignment > std::alignment_of<std::max_align_t>::value ? alignment-1 : 0;
+
+        // size in bytes must not overflow
+        if((size_t)buf_size > ((size_t)-1-extra)/sizeof(T))
+            return false;
+
+        memory = ::operator new(sizeof(T)*(size_t)buf_size+extra, std::nothrow);
+        if(memory==NULL)
+            return false;
+        slots = reinterpret_cast<T *>((reinterpret_cast<std::uintptr_t>(memory)+extra) & ~(std::uintptr_t)(alignment-1));
+        size = buf_size;
+        mask = ((buf_size & (buf_size-1))==0) ? buf_size-1 : 0;
+        return true;
+    }
+
+    T * Slots(void) { return slots; }
+
+    unsigned int Size(void) const { return size; }
+
+    unsigned int Next(unsigned int index) const
+    {
+        if(mask)
+            return (index+1) & mask;
+        return (index+1==size) ? 0 : index+1;
+    }
+
+    unsigned int Advance(unsigned int index, unsigned int offset) const
+    {
+        if(mask)
+            return (index+offset) & mask;
+        index += offset;
+        return (index >= size) ? index-size : index;
+    }
+
+private:
+
+    //! Allocated memory, 'slots' may start later in it to be aligned.
+    void * memory;
+
+    T * slots;
+    unsigned int size;
+
+    //! Mask for wrapping positions, 0 if size is not power of two.
+    unsigned int mask;
+
+    TypedCyclicStorage(const TypedCyclicStorage &);
+    TypedCyclicStorage & operator=(const TypedCyclicStorage &);
+
+};
+
+template <typename T, unsigned int Capacity = 0>
+class TypedCyclicBuffer
+{
+
+public:
+
+    //! Constructor of buffer with fixed capacity (inline storage).
+    TypedCyclicBuffer(void) : read_ptr(0), write_ptr(0), used_slots(0)
+    {
+        static_assert(Capacity!=0, "runtime-sized TypedCyclicBuffer needs size in constructor");
+    }
+
+    //! Constructor of runtime-sized buffer. Ensures memory allocation.
+    /*!
+     * \param buf_size Number of values the buffer can hold.
+     * \param success if memory was allocated successfully, the return value is 0, otherwise the error code (see 'CyclicBuffer::buffer_error').
+     * Size in bytes not representable by 'size_t' is reported as allocation error.
+     */
+    TypedCyclicBuffer(unsigned int buf_size, int &success) : read_ptr(0), write_ptr(0), used_slots(0)
+    {
+        static_assert(Capacity==0, "fixed capacity TypedCyclicBuffer can not be sized at runtime");
+
+        if(buf_size==0)
+            success = CyclicBuffer::BUFFER_INVALID_SIZE;
+        else if(!storage.Allocate(buf_size))
+            success = CyclicBuffer::BUFFER_ALLOCATION_ERROR;
+        else
+            success = CyclicBuffer::BUFFER_OK;
+    }
+
+    //! Destructor destroys all unread values.
+    ~TypedCyclicBuffer(void) { Clear(); }
+
+    //! Function constructs new value in place at the write position.
+    /*!
+     * \param args Arguments passed to the constructor of T.
+     * \return True if value was stored, false if buffer is full.
+     */
+    template <typename... Args>
+    bool Emplace(Args&&... args)
+    {
+        if(used_slots==storage.Size())
+            return false;
+
+        new (storage.Slots()+write_ptr) T(std::forward<Args>(args)...);
+        write_ptr = storage.Next(write_ptr);
+        used_slots++;
+        return true;
+    }
+
+    //! Function pushes copy of value to the buffer. Returns false if buffer is full.
+    bool Push(const T &value) { return Emplace(value); }
+
+    //! Function moves value to the buffer. Returns false if buffer is full.
+    bool Push(T &&value) { return Emplace(std::move(value)); }
+
+    //! Function moves the oldest value out of the buffer and destroys it in the buffer.
+    /*!
+     * \param value Reference where retrieved value is moved.
+     * \return True if value was retrieved, false if there is nothing to read.
+     */
+    bool Pop(T &value)
+    {
+        if(!used_slots)
+            return false;
+
+        T * slot = storage.Slots()+read_ptr;
+        value = std::move(*slot);
+        slot->~T();
+        read_ptr = storage.Next(read_ptr);
+        used_slots--;
+        return true;
+    }
+
+    //! Function pushes up to 'length' values. Returns number of values stored.
+    size_t PushN(const T * values, size_t length)
+    {
+        size_t i = 0;
+        while(i < length && Emplace(values[i]))
+            i++;
+        return i;
+    }
+
+    //! Function pops up to 'length' values. Returns number of values retrieved.
+    size_t PopN(T * values, size_t length)
+    {
+        size_t i = 0;
+        while(i < length && Pop(values[i]))
+            i++;
+        return i;
+    }
+
+    //! Function returns pointer to the oldest unread value (NULL if buffer is empty).
+    T * Front(void) { return used_slots ? storage.Slots()+read_ptr : NULL; }
+
+    //! Function returns pointer to unread value at 'offset' from the oldest one (NULL if out of range).
+    T * At(unsigned int offset) { return offset < used_slots ? storage.Slots()+storage.Advance(read_ptr, offset) : NULL; }
+
+    //! Function destroys all unread values.
+    void Clear(void)
+    {
+        while(used_slots)
+        {
+            storage.Slots()[read_ptr].~T();
+            read_ptr = storage.Next(read_ptr);
+            used_slots--;
+        }
+        read_ptr = write_ptr = 0;
+    }
+
+    //! Function returns the number of values waiting for reading.
+    unsigned int Available(void) const { return used_slots; }
+
+    //! Function returns the number of values that can be pushed.
+    unsigned int FreeSpace(void) const { return storage.Size()-used_slots; }
+
+    //! Function returns true if there is nothing to read.
+    bool IsEmpty(void) const { return used_slots==0; }
+
+    //! Function returns true if next push will be refused.
+    bool IsFull(void) const { return used_slots==storage.Size(); }
+
+    //! Function returns the number of values the buffer can hold.
+    unsigned int GetBufferSize(void) const { return storage.Size(); }
+
+private:
+
+    //! Memory for values, either inline or allocated.
+    TypedCyclicStorage<T, Capacity> storage;
+
+    //! Index of the oldest unread value.
+    unsigned int read_ptr;
+
+    //! Index of slot where next value will be constructed.
+    unsigned int write_ptr;
+
+    //! Number of constructed (unread) values.
+    unsigned int used_slots;
+
+    TypedCyclicBuffer(const TypedCyclicBuffer &);
+    TypedCyclicBuffer & operator=(const TypedCyclicBuffer &);
+
+};
+
+#endif // TYPEDCYCLICBUFFER_H